@@ -0,0 +1,243 @@
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace {
+
+	const size_t numSlots = 64;  // Threads beyond this share slots, which stays correct as the counts are atomic
+	const size_t numPhases = 64; // Phases active at once which can have a peak, one bit each of a mask
+
+	/** \brief The counts of one thread, on its own cache line. */
+	struct alignas(64) Slot {
+		std::atomic<unsigned long long> allocations;
+		std::atomic<unsigned long long> frees;
+		std::atomic<unsigned long long> bytesAllocated;
+		std::atomic<unsigned long long> bytesFreed;
+	};
+
+#ifdef RAYTRACER_ALLOC_STATS
+	/** \brief Kept in front of every block, so that it can be freed, and so that only counted blocks are subtracted. */
+	struct Header {
+		size_t offset;       // Bytes from the start of the malloc block to the user's block
+		size_t countedBytes; // Size of the block if its allocation was counted, otherwise 0
+	};
+#endif
+
+	// These are all constant initialised, so they can be used by allocations made before main()
+	std::atomic<bool> counting(false);
+	std::atomic<long long> live(0);
+	std::atomic<unsigned long long> claimedPhases(0); // Slots of peaks owned by a Phase
+	std::atomic<unsigned long long> activePhases(0);  // Slots of peaks being raised by allocations
+	std::atomic<long long> peaks[numPhases];
+	Slot slots[numSlots];
+
+#ifdef RAYTRACER_ALLOC_STATS
+	std::atomic<size_t> nextSlot(0);
+	thread_local Slot* threadSlot = nullptr;
+
+	Slot& ownSlot() {
+		if (!threadSlot) {
+			threadSlot = &slots[nextSlot.fetch_add(1, std::memory_order_relaxed) % numSlots];
+		}
+		return *threadSlot;
+	}
+
+	Header* headerOf(void* block) {
+		return static_cast<Header*>(block) - 1;
+	}
+
+	void recordAllocation(void* block, size_t bytes) {
+		if (!counting.load(std::memory_order_relaxed)) return;
+		headerOf(block)->countedBytes = bytes;
+		Slot& slot = ownSlot();
+		slot.allocations.fetch_add(1, std::memory_order_relaxed);
+		slot.bytesAllocated.fetch_add(bytes, std::memory_order_relaxed);
+		const long long now = live.fetch_add((long long)bytes, std::memory_order_relaxed) + (long long)bytes;
+		// Raise the peak of every active Phase
+		unsigned long long active = activePhases.load(std::memory_order_acquire);
+		for (size_t phase = 0; active; ++phase, active >>= 1) {
+			if (!(active & 1)) continue;
+			std::atomic<long long>& peak = peaks[phase];
+			long long highest = peak.load(std::memory_order_relaxed);
+			while (now > highest && !peak.compare_exchange_weak(highest, now, std::memory_order_relaxed)) {
+			}
+		}
+	}
+
+	void recordFree(void* block) {
+		const size_t bytes = headerOf(block)->countedBytes;
+		if (bytes == 0) return;
+		Slot& slot = ownSlot();
+		slot.frees.fetch_add(1, std::memory_order_relaxed);
+		slot.bytesFreed.fetch_add(bytes, std::memory_order_relaxed);
+		live.fetch_sub((long long)bytes, std::memory_order_relaxed);
+	}
+
+	void* allocateAligned(size_t size, size_t alignment) {
+		// The header goes just before the user's block, in space which keeps the block aligned
+		const size_t align = std::max(alignof(std::max_align_t), std::max(alignof(Header), alignment));
+		const size_t headerSpace = (sizeof(Header) + align - 1) / align * align;
+		if (size > SIZE_MAX - headerSpace) return nullptr;
+		void* base = nullptr;
+		if (align == alignof(std::max_align_t)) {
+			base = std::malloc(headerSpace + size);
+		} else if (posix_memalign(&base, align, headerSpace + size) != 0) {
+			base = nullptr;
+		}
+		if (!base) return nullptr;
+		void* block = static_cast<char*>(base) + headerSpace;
+		*headerOf(block) = Header{headerSpace, 0};
+		recordAllocation(block, size ? size : 1);
+		return block;
+	}
+
+	/** \brief Allocate as \c operator \c new must: calling the new handler until the allocation succeeds, or throwing if there is none. */
+	void* allocateOrThrow(size_t size, size_t alignment) {
+		for (;;) {
+			void* block = allocateAligned(size, alignment);
+			if (block) return block;
+			const std::new_handler handler = std::get_new_handler();
+			if (!handler) throw std::bad_alloc();
+			handler();
+		}
+	}
+
+	/** \brief Allocate as the \c std::nothrow forms of \c operator \c new must, returning \c nullptr rather than throwing. */
+	void* allocateOrNull(size_t size, size_t alignment) noexcept {
+		try {
+			return allocateOrThrow(size, alignment);
+		} catch (...) {
+			return nullptr;
+		}
+	}
+
+	void release(void* block) {
+		if (!block) return;
+		recordFree(block);
+		std::free(static_cast<char*>(block) - headerOf(block)->offset);
+	}
+#endif
+
+	/** \brief The totals of every thread's counts. */
+	AllocationTracker::Counts totals() {
+		AllocationTracker::Counts counts{0, 0, 0, 0, 0};
+		for (const Slot& slot : slots) {
+			counts.allocations += slot.allocations.load(std::memory_order_relaxed);
+			counts.frees += slot.frees.load(std::memory_order_relaxed);
+			counts.bytesAllocated += slot.bytesAllocated.load(std::memory_order_relaxed);
+			counts.bytesFreed += slot.bytesFreed.load(std::memory_order_relaxed);
+		}
+		return counts;
+	}
+
+}
+
+void AllocationTracker::Counts::writeJson(std::ostream& out, double units, const char* unit) const {
+	out << "{\"allocations\": " << allocations << ", \"frees\": " << frees << ", \"bytes_allocated\": " << bytesAllocated
+	    << ", \"bytes_freed\": " << bytesFreed << ", \"peak_live_bytes\": " << peakBytes;
+	if (units > 0) {
+		out << ", \"per_" << unit << "\": {\"allocations\": " << allocations / units << ", \"bytes_allocated\": " << bytesAllocated / units << "}";
+	}
+	out << "}";
+}
+
+AllocationTracker::Phase::Phase() : start_(totals()), startLive_(live.load(std::memory_order_relaxed)), peakSlot_(-1) {
+	// Claim the lowest free slot for the peak, if there is one
+	unsigned long long claimed = claimedPhases.load(std::memory_order_relaxed);
+	while (~claimed) {
+		int slot = 0;
+		while (claimed & (1ull << slot)) ++slot;
+		if (claimedPhases.compare_exchange_weak(claimed, claimed | (1ull << slot), std::memory_order_relaxed)) {
+			peakSlot_ = slot;
+			peaks[slot].store(startLive_, std::memory_order_relaxed);
+			activePhases.fetch_or(1ull << slot, std::memory_order_release);
+			break;
+		}
+	}
+}
+
+AllocationTracker::Phase::~Phase() {
+	if (peakSlot_ < 0) return;
+	activePhases.fetch_and(~(1ull << peakSlot_), std::memory_order_relaxed);
+	claimedPhases.fetch_and(~(1ull << peakSlot_), std::memory_order_release);
+}
+
+AllocationTracker::Counts AllocationTracker::Phase::counts() const {
+	Counts counts = totals();
+	counts.allocations -= start_.allocations;
+	counts.frees -= start_.frees;
+	counts.bytesAllocated -= start_.bytesAllocated;
+	counts.bytesFreed -= start_.bytesFreed;
+	counts.peakBytes = peakSlot_ < 0 ? -1 : peaks[peakSlot_].load(std::memory_order_relaxed) - startLive_;
+	return counts;
+}
+
+void AllocationTracker::enable() {
+#ifdef RAYTRACER_ALLOC_STATS
+	counting.store(true);
+#endif
+}
+
+bool AllocationTracker::enabled() {
+	return counting.load(std::memory_order_relaxed);
+}
+
+long long AllocationTracker::liveBytes() {
+	return live.load(std::memory_order_relaxed);
+}
+
+#ifdef RAYTRACER_ALLOC_STATS
+
+// Replacements for every form of the global operator new and operator delete
+
+void* operator new(size_t size) {
+	return allocateOrThrow(size, 0);
+}
+
+void* operator new[](size_t size) {
+	return allocateOrThrow(size, 0);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	return allocateOrNull(size, 0);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return allocateOrNull(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+	return allocateOrThrow(size, size_t(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+	return allocateOrThrow(size, size_t(alignment));
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return allocateOrNull(size, size_t(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return allocateOrNull(size, size_t(alignment));
+}
+
+void operator delete(void* block) noexcept { release(block); }
+void operator delete[](void* block) noexcept { release(block); }
+void operator delete(void* block, size_t) noexcept { release(block); }
+void operator delete[](void* block, size_t) noexcept { release(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept { release(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept { release(block); }
+void operator delete(void* block, std::align_val_t) noexcept { release(block); }
+void operator delete[](void* block, std::align_val_t) noexcept { release(block); }
+void operator delete(void* block, size_t, std::align_val_t) noexcept { release(block); }
+void operator delete[](void* block, size_t, std::align_val_t) noexcept { release(block); }
+void operator delete(void* block, std::align_val_t, const std::nothrow_t&) noexcept { release(block); }
+void operator delete[](void* block, std::align_val_t, const std::nothrow_t&) noexcept { release(block); }
+
+#endif
@@ -0,0 +1,102 @@
+#pragma once
+
+#ifndef ALLOCATION_TRACKER_H_INCLUDED
+#define ALLOCATION_TRACKER_H_INCLUDED
+
+#include "NonCopyable.h"
+
+#include <ostream>
+
+/** \file
+ * \brief AllocationTracker class header file.
+ */
+
+/**
+ * \brief Counts the heap allocations made through \c operator \c new and \c delete.
+ *
+ * In builds configured with <tt>-DRAYTRACER_ALLOC_STATS=ON</tt>, AllocationTracker.cpp
+ * replaces the global \c operator \c new and \c operator \c delete (all of their forms)
+ * with versions that call \c malloc and \c free. Other builds keep the standard ones,
+ * enable() does nothing, and every count is zero. Each block has a small header in front
+ * of it, which records whether its allocation was counted, so frees of blocks allocated
+ * before enable() are not subtracted. Until enable() is called the hooks do nothing else,
+ * so their cost is the header and one relaxed atomic load.
+ *
+ * Once enabled, each allocation and free is counted in a slot belonging to the calling
+ * thread, so threads do not contend for the counts. Only the number of bytes live, needed
+ * for the peaks, is shared by all threads. Sizes are the sizes asked for, without the
+ * header or the allocator's rounding.
+ *
+ * A Phase measures the allocations between its construction and a call to counts().
+ * The counts are of the whole process, so Phases on different threads at once each
+ * include the other's allocations, but each Phase keeps its own peak, so Phases can
+ * be nested or overlap.
+ */
+class AllocationTracker {
+
+public:
+
+	/** \brief Allocations made over some time. */
+	struct Counts {
+		unsigned long long allocations;    //!< Number of blocks allocated.
+		unsigned long long frees;          //!< Number of blocks freed.
+		unsigned long long bytesAllocated; //!< Total size of the blocks allocated.
+		unsigned long long bytesFreed;     //!< Total size of the blocks freed.
+		long long peakBytes;               //!< Most bytes live at once, above the number live at the start, or -1 if not known.
+
+		/** \brief Write the counts as a JSON object.
+		 *
+		 * \param out The stream to write to.
+		 * \param units The amount of work done, for per-unit averages, or 0 for none.
+		 * \param unit The name of one unit of work, such as "ray".
+		 */
+		void writeJson(std::ostream& out, double units, const char* unit) const;
+	};
+
+	/**
+	 * \brief Measures the allocations made from its construction on.
+	 */
+	class Phase : private NonCopyable {
+
+	public:
+
+		/** \brief Phase constructor, which starts measuring, and starts a new peak.
+		 *
+		 * Up to 64 Phases can keep a peak at once. Any more still count allocations,
+		 * but report a peakBytes of -1.
+		 */
+		Phase();
+
+		/** \brief Phase destructor, which stops keeping its peak. */
+		~Phase();
+
+		/** \brief The allocations made so far in the phase.
+		 *
+		 * \return The counts since construction.
+		 */
+		Counts counts() const;
+
+	private:
+
+		Counts start_;         //!< Totals at the start of the phase.
+		long long startLive_;  //!< Bytes live at the start of the phase.
+		int peakSlot_;         //!< Slot holding the peak of the phase, or -1 if none was free.
+	};
+
+	/** \brief Start counting allocations, if the hooks are built in. */
+	static void enable();
+
+	/** \brief Whether allocations are being counted.
+	 *
+	 * \return true after enable() has been called in a build with the hooks.
+	 */
+	static bool enabled();
+
+	/** \brief The bytes currently live.
+	 *
+	 * \return Bytes allocated since enable() and not yet freed.
+	 */
+	static long long liveBytes();
+};
+
+#endif // ALLOCATION_TRACKER_H_INCLUDED
@@ -20,7 +20,7 @@ AmbientLightSource& AmbientLightSource::operator=(const AmbientLightSource& ligh
 	return *this;
 }
 
-Colour AmbientLightSource::getIlluminationAt(const Point& point) const {
+PackedColour AmbientLightSource::getIlluminationAt(const Point& point) const {
 	return colour_;
 }
 
@@ -30,4 +30,9 @@ double AmbientLightSource::getDistanceToLight(const Point& point) const {
 
 Direction AmbientLightSource::getLightDirection(const Point& point) const {
 	return Direction();
-}
\ No newline at end of file
+}
+
+bool AmbientLightSource::mayBeShadowedBy(const BoundingBox& /*caster*/, const BoundingBox& /*receiver*/) const {
+	// Ambient light comes from everywhere, and is never blocked
+	return false;
+}
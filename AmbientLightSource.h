@@ -50,7 +50,7 @@ public:
 	* \param point The Point at which light is measured.
 	* \return The illumination that reaches the Point.
 	*/
-	Colour getIlluminationAt(const Point& point) const;
+	PackedColour getIlluminationAt(const Point& point) const;
 
 	/**
 	 * \brief Distance factor for shadows from this light source.
@@ -74,6 +74,15 @@ public:
 	 */
 	Direction getLightDirection(const Point& point) const;
 
+	/** \brief Check whether an Object might shadow another from this light.
+	 *
+	 * \param caster Bounds of the Object which might cast a shadow.
+	 * \param receiver Bounds of the Object which might be in shadow.
+	 * \return false if no point in receiver can be shadowed by caster, true otherwise.
+	 * \sa LightSource::mayBeShadowedBy()
+	 */
+	bool mayBeShadowedBy(const BoundingBox& caster, const BoundingBox& receiver) const;
+
 };
 
 #endif // AMBIENT_LIGHT_SOURCE_H_INCLUDED
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "BatchRenderer.h"
+
+#include "ImageDisplay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+	typedef std::chrono::steady_clock Clock;
+
+	/** \brief Milliseconds between two times. */
+	double millisecondsBetween(Clock::time_point start, Clock::time_point end) {
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+}
+
+BatchRenderer::BatchRenderer(unsigned int numThreads, unsigned int concurrentJobs, const SceneSetup& setup, 
+                             const std::vector<int>& cpus) :
+	pool_(numThreads, cpus), concurrentJobs_(std::max(1u, concurrentJobs)), setup_(setup) {
+
+}
+
+BatchRenderer::~BatchRenderer() {
+
+}
+
+BatchRenderer::Result BatchRenderer::runJob(const SceneJob& job, ImageDisplay& display) {
+	Result result{false, "", "", 0, 0, 0, 0};
+	const Clock::time_point start = Clock::now();
+
+	Scene scene;
+	if (!job.load(scene, setup_, "", result.error)) return result;
+	if (!job.setting("OUTPUT").empty()) scene.filename = job.setting("OUTPUT");
+	const Clock::time_point read = Clock::now();
+
+	// Every view is rendered and saved in turn, reusing the one ImageDisplay, and they share any time budget
+	const std::vector<Scene::View> views = scene.getViews();
+	const Clock::time_point deadline = read + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(scene.timeBudgetMs));
+	double renderMs = 0, saveMs = 0;
+	for (size_t ix = 0; ix < views.size(); ++ix) {
+		const Clock::time_point viewStart = Clock::now();
+		display.resize(scene.renderWidth, scene.renderHeight);
+		if (scene.timeBudgetMs > 0) {
+			scene.renderUntil(*views[ix].camera, display, pool_, viewStart + (deadline - viewStart) / (long long)(views.size() - ix));
+		} else {
+			scene.renderImage(*views[ix].camera, display, pool_);
+		}
+		const Clock::time_point rendered = Clock::now();
+
+		result.output += (ix == 0 ? "" : ";") + views[ix].filename;
+		if (!display.save(views[ix].filename, &pool_)) {
+			result.error = "could not save " + views[ix].filename;
+			return result;
+		}
+		renderMs += millisecondsBetween(viewStart, rendered);
+		saveMs += millisecondsBetween(rendered, Clock::now());
+	}
+
+	result.ok = true;
+	result.pixels = (unsigned long long)scene.renderWidth * scene.renderHeight * views.size();
+	result.readMs = millisecondsBetween(start, read);
+	result.renderMs = renderMs;
+	result.saveMs = saveMs;
+	return result;
+}
+
+size_t BatchRenderer::run(const std::string& manifest, const std::string& reportFile) {
+	const std::vector<SceneJob> jobs = SceneJob::readList(manifest, "batch manifest", std::vector<std::string>(1, "OUTPUT"));
+	std::cout << "Rendering " << jobs.size() << " job" << (jobs.size() == 1 ? "" : "s") << " from " << manifest
+	          << ", " << concurrentJobs_ << " at a time on " << pool_.size() << " thread" << (pool_.size() == 1 ? "" : "s") << std::endl;
+
+	const Clock::time_point start = Clock::now();
+	std::vector<Result> results(jobs.size());
+	std::atomic<size_t> nextJob(0);
+	std::mutex outputMutex;
+
+	// Each slot takes jobs one at a time and renders them on the shared pool, reusing its framebuffer
+	auto slot = [&]() {
+		ImageDisplay display("Render", 0, 0);
+		for (size_t ix = nextJob++; ix < jobs.size(); ix = nextJob++) {
+			results[ix] = runJob(jobs[ix], display);
+			std::lock_guard<std::mutex> lock(outputMutex);
+			if (results[ix].ok) {
+				std::cout << "[" << ix + 1 << "/" << jobs.size() << "] " << results[ix].output << ": "
+				          << results[ix].readMs + results[ix].renderMs + results[ix].saveMs << "ms" << std::endl;
+			} else {
+				std::cout << "[" << ix + 1 << "/" << jobs.size() << "] line " << jobs[ix].line << " failed: "
+				          << results[ix].error << std::endl;
+			}
+		}
+	};
+	std::vector<std::thread> slots;
+	for (unsigned int i = 1; i < std::min<size_t>(concurrentJobs_, jobs.size()); ++i) {
+		slots.emplace_back(slot);
+	}
+	slot();
+	for (auto& thread : slots) {
+		thread.join();
+	}
+	const double totalMs = millisecondsBetween(start, Clock::now());
+
+	// Throughput report
+	size_t failed = 0;
+	unsigned long long pixels = 0;
+	std::vector<double> jobMs;
+	for (const Result& result : results) {
+		if (!result.ok) {
+			++failed;
+			continue;
+		}
+		pixels += result.pixels;
+		jobMs.push_back(result.readMs + result.renderMs + result.saveMs);
+	}
+	std::sort(jobMs.begin(), jobMs.end());
+	const double seconds = totalMs / 1000;
+	std::cout << std::endl;
+	std::cout << "Batch: " << jobMs.size() << " of " << jobs.size() << " jobs rendered (" << failed << " failed) in " << seconds << "s" << std::endl;
+	if (!jobMs.empty() && seconds > 0) {
+		std::cout << "Throughput: " << jobMs.size() / seconds << " jobs/s, " << pixels / seconds / 1e6 << " Mpixels/s" << std::endl;
+		std::cout << "Per job: median " << jobMs[jobMs.size() / 2] << "ms, min " << jobMs.front() << "ms, max " << jobMs.back() << "ms" << std::endl;
+	}
+
+	if (!reportFile.empty()) {
+		std::ofstream report(reportFile);
+		report << "job,line,output,status,pixels,read_ms,render_ms,save_ms" << std::endl;
+		for (size_t ix = 0; ix < jobs.size(); ++ix) {
+			const Result& result = results[ix];
+			report << ix + 1 << "," << jobs[ix].line << "," << result.output << "," << (result.ok ? "ok" : "failed") << ","
+			       << result.pixels << "," << result.readMs << "," << result.renderMs << "," << result.saveMs << std::endl;
+		}
+	}
+	return failed;
+}
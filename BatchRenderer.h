@@ -0,0 +1,101 @@
+#pragma once
+
+#ifndef BATCH_RENDERER_H_INCLUDED
+#define BATCH_RENDERER_H_INCLUDED
+
+#include "NonCopyable.h"
+#include "Scene.h"
+#include "SceneJob.h"
+#include "ThreadPool.h"
+
+#include <string>
+#include <vector>
+
+/** \file
+ * \brief BatchRenderer class header file.
+ */
+
+/**
+ * \brief Renders many independent scenes in one process.
+ *
+ * Each job in a batch is read into its own Scene, rendered, and saved. The jobs share
+ * one ThreadPool, and each concurrent job slot reuses its ImageDisplay from one job
+ * to the next, so the cost of starting threads and allocating framebuffers is paid
+ * once per batch rather than once per image.
+ *
+ * Jobs are listed in a manifest file, one per line, read as SceneJobs. Each line lists one
+ * or more scene files (combined into one Scene, as on the command line), followed by any overrides:
+\verbatim
+# Scene files                  Overrides
+snowman.txt                    output=snowman.png
+base.txt red.txt               output=red.png size=400x300 samples=4
+base.txt blue.txt              output=blue.png raydepth=1
+\endverbatim
+ * Allowed overrides are:
+ * - <tt>output=[file]</tt>: Set the Scene's \c filename (otherwise the scene files' setting is used).
+ * - <tt>size=[width]x[height]</tt>: Set the Scene's \c renderWidth and \c renderHeight.
+ * - <tt>samples=[count]</tt>: Set the Scene's \c samplesPerPixel.
+ * - <tt>raydepth=[depth]</tt>: Set the Scene's \c maxRayDepth.
+ *
+ * A job whose scene files add named Cameras renders every view, as Scene::render() does,
+ * and saves each to its own file (\c output=x.png gives \c x.png for the default Camera and
+ * \c x_[name].png for each named one, unless the Camera gives its own file). The views
+ * share any time budget.
+ *
+ * Blank lines, and anything after a \c #, are ignored. Errors in a job's scene files
+ * are reported and that job is skipped, but the rest of the batch still runs.
+ */
+class BatchRenderer : private NonCopyable {
+
+public:
+
+	/** \brief BatchRenderer constructor.
+	 *
+	 * \param numThreads The number of threads to render with, or 0 for one per hardware thread.
+	 * \param concurrentJobs The number of jobs to render at the same time.
+	 * \param setup Function to apply default settings to each Scene.
+	 * \param cpus CPUs to pin the threads to (see Scene::threadCpus()), or empty to leave them unpinned.
+	 */
+	BatchRenderer(unsigned int numThreads, unsigned int concurrentJobs, const SceneSetup& setup, 
+	              const std::vector<int>& cpus = std::vector<int>());
+
+	/** \brief BatchRenderer destructor. */
+	~BatchRenderer();
+
+	/** \brief Render every job in a manifest, and print a throughput report.
+	 *
+	 * If the manifest cannot be read, or has errors, the program is terminated.
+	 *
+	 * \param manifest The name of the manifest file.
+	 * \param reportFile If not empty, a CSV file to write per-job timings to.
+	 * \return The number of jobs which failed.
+	 */
+	size_t run(const std::string& manifest, const std::string& reportFile);
+
+private:
+
+	/** \brief The outcome of one job. */
+	struct Result {
+		bool ok;              //!< Whether the image was rendered and saved.
+		std::string error;    //!< What went wrong, if the job failed.
+		std::string output;   //!< The files the images were saved to, separated by semicolons if there were several views.
+		unsigned long long pixels; //!< Number of pixels rendered, over all of the views.
+		double readMs;        //!< Time to read the scene files.
+		double renderMs;      //!< Time to render the image.
+		double saveMs;        //!< Time to save the image.
+	};
+
+	/** \brief Read, render, and save one job.
+	 *
+	 * \param job The job to run.
+	 * \param display The ImageDisplay to render into, which is resized as needed.
+	 * \return The outcome of the job.
+	 */
+	Result runJob(const SceneJob& job, ImageDisplay& display);
+
+	ThreadPool pool_;             //!< Threads shared by all of the jobs.
+	unsigned int concurrentJobs_; //!< Number of jobs to render at the same time.
+	SceneSetup setup_;            //!< Default settings for each Scene.
+};
+
+#endif // BATCH_RENDERER_H_INCLUDED
@@ -0,0 +1,124 @@
+#include "BoundingBox.h"
+
+#include "utility.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+BoundingBox::BoundingBox() : 
+lower(infinity, infinity, infinity), upper(-infinity, -infinity, -infinity) {
+
+}
+
+BoundingBox::BoundingBox(const Point& lower, const Point& upper) :
+lower(lower), upper(upper) {
+
+}
+
+void BoundingBox::include(const Point& point) {
+	for (size_t i = 0; i < 3; ++i) {
+		lower(i) = std::min(lower(i), point(i));
+		upper(i) = std::max(upper(i), point(i));
+	}
+}
+
+bool BoundingBox::isEmpty() const {
+	return lower(0) > upper(0) || lower(1) > upper(1) || lower(2) > upper(2);
+}
+
+Point BoundingBox::corner(int ix) const {
+	return Point((ix & 1) ? upper(0) : lower(0),
+	             (ix & 2) ? upper(1) : lower(1),
+	             (ix & 4) ? upper(2) : lower(2));
+}
+
+namespace {
+
+	/** \brief Separating axis test between a box and the convex hull of some points.
+	 *
+	 * The hull may be swept to infinity in one direction. Axes tested are the box's own
+	 * axes and the cross products of each edge direction with them. If the projections
+	 * onto any axis do not overlap, the shapes do not intersect.
+	 */
+	bool hullMayOverlap(const BoundingBox& box, const std::vector<std::array<double, 3>>& hull, 
+	                    const std::vector<std::array<double, 3>>& edges, const double* sweep) {
+		double centre[3], half[3];
+		double scale = 1;
+		for (int i = 0; i < 3; ++i) {
+			centre[i] = 0.5*(box.lower(i) + box.upper(i));
+			half[i] = 0.5*(box.upper(i) - box.lower(i));
+			scale = std::max(scale, std::max(std::abs(box.lower(i)), std::abs(box.upper(i))));
+		}
+		for (const auto& point : hull) {
+			for (int i = 0; i < 3; ++i) scale = std::max(scale, std::abs(point[i]));
+		}
+		// Allow for rounding in the intersection points found by Object::intersect()
+		const double tolerance = 1e-6 * scale;
+
+		auto separates = [&](const double axis[3]) {
+			double length = std::sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+			if (length < 1e-12) return false;
+			double boxCentre = 0, boxRadius = 0;
+			for (int i = 0; i < 3; ++i) {
+				boxCentre += axis[i]*centre[i];
+				boxRadius += std::abs(axis[i])*half[i];
+			}
+			double hullMin = infinity, hullMax = -infinity;
+			for (const auto& point : hull) {
+				double d = axis[0]*point[0] + axis[1]*point[1] + axis[2]*point[2];
+				hullMin = std::min(hullMin, d);
+				hullMax = std::max(hullMax, d);
+			}
+			if (sweep) {
+				double s = axis[0]*sweep[0] + axis[1]*sweep[1] + axis[2]*sweep[2];
+				if (s > 0) hullMax = infinity;
+				if (s < 0) hullMin = -infinity;
+			}
+			const double pad = tolerance * length;
+			return hullMax + pad < boxCentre - boxRadius || boxCentre + boxRadius < hullMin - pad;
+		};
+
+		for (int k = 0; k < 3; ++k) {
+			double axis[3] = {0, 0, 0};
+			axis[k] = 1;
+			if (separates(axis)) return false;
+		}
+		for (const auto& edge : edges) {
+			for (int k = 0; k < 3; ++k) {
+				// edge x e_k
+				double axis[3] = {0, 0, 0};
+				axis[(k + 1) % 3] = edge[(k + 2) % 3];
+				axis[(k + 2) % 3] = -edge[(k + 1) % 3];
+				if (separates(axis)) return false;
+			}
+		}
+		return true;
+	}
+
+}
+
+bool BoundingBox::mayBlock(const BoundingBox& receiver, const Point& light) const {
+	if (isEmpty() || receiver.isEmpty()) return false;
+	std::vector<std::array<double, 3>> hull, edges;
+	hull.push_back({light(0), light(1), light(2)});
+	for (int i = 0; i < 8; ++i) {
+		const Point c = receiver.corner(i);
+		hull.push_back({c(0), c(1), c(2)});
+		edges.push_back({light(0) - c(0), light(1) - c(1), light(2) - c(2)});
+	}
+	return hullMayOverlap(*this, hull, edges, nullptr);
+}
+
+bool BoundingBox::mayBlock(const BoundingBox& receiver, const Direction& towardsLight) const {
+	if (isEmpty() || receiver.isEmpty()) return false;
+	std::vector<std::array<double, 3>> hull;
+	for (int i = 0; i < 8; ++i) {
+		const Point c = receiver.corner(i);
+		hull.push_back({c(0), c(1), c(2)});
+	}
+	const double sweep[3] = {towardsLight(0), towardsLight(1), towardsLight(2)};
+	std::vector<std::array<double, 3>> edges(1, {sweep[0], sweep[1], sweep[2]});
+	return hullMayOverlap(*this, hull, edges, sweep);
+}
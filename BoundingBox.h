@@ -0,0 +1,89 @@
+#pragma once
+
+#ifndef BOUNDING_BOX_H_INCLUDED
+#define BOUNDING_BOX_H_INCLUDED
+
+#include "Direction.h"
+#include "Point.h"
+
+/**
+ * \file
+ * \brief BoundingBox class header file.
+ */
+
+/**
+ * \brief Axis-aligned bounding box.
+ *
+ * A BoundingBox is the smallest box, with sides parallel to the co-ordinate axes,
+ * which contains a set of Points. It starts off empty, and grows as Points are 
+ * added with include(). BoundingBoxes are used to quickly decide that a Ray can
+ * not possibly hit an Object, without calling its intersect() method.
+ */
+class BoundingBox {
+
+public:
+
+	/** \brief BoundingBox default constructor. 
+	 *
+	 * Creates an empty BoundingBox, which contains no Points.
+	 */
+	BoundingBox();
+
+	/** \brief BoundingBox corner constructor.
+	 *
+	 * \param lower The corner of the box with the smallest co-ordinates.
+	 * \param upper The corner of the box with the largest co-ordinates.
+	 */
+	BoundingBox(const Point& lower, const Point& upper);
+
+	/** \brief Grow the BoundingBox to contain a Point.
+	 *
+	 * \param point The Point to include in the BoundingBox.
+	 */
+	void include(const Point& point);
+
+	/** \brief Check whether the BoundingBox contains no Points.
+	 *
+	 * \return true if no Points have been included, false otherwise.
+	 */
+	bool isEmpty() const;
+
+	/** \brief Get one of the eight corners of the BoundingBox.
+	 *
+	 * Bit 0 of the index selects the upper X co-ordinate, bit 1 the upper 
+	 * Y co-ordinate, and bit 2 the upper Z co-ordinate.
+	 *
+	 * \param ix The index of the corner, from 0 to 7.
+	 * \return The requested corner.
+	 */
+	Point corner(int ix) const;
+
+	/** \brief Check whether \c this box might block light from a point reaching another box.
+	 *
+	 * This tests \c this box against every line segment from a point in the receiver 
+	 * to the light. It is conservative: if it returns false, no such segment passes 
+	 * through \c this box, but a true result does not guarantee that one does.
+	 *
+	 * \param receiver The box containing the lit points.
+	 * \param light The location of the light.
+	 * \return false if \c this box cannot cast a shadow on the receiver, true otherwise.
+	 */
+	bool mayBlock(const BoundingBox& receiver, const Point& light) const;
+
+	/** \brief Check whether \c this box might block light from a direction reaching another box.
+	 *
+	 * This is the same as mayBlock(const BoundingBox&, const Point&) const, but for a light
+	 * infinitely far away, so the segments become rays heading in the given Direction.
+	 *
+	 * \param receiver The box containing the lit points.
+	 * \param towardsLight The Direction from the receiver towards the light.
+	 * \return false if \c this box cannot cast a shadow on the receiver, true otherwise.
+	 */
+	bool mayBlock(const BoundingBox& receiver, const Direction& towardsLight) const;
+
+	Point lower; //!< The corner with the smallest X-, Y-, and Z-co-ordinates.
+	Point upper; //!< The corner with the largest X-, Y-, and Z-co-ordinates.
+
+};
+
+#endif // BOUNDING_BOX_H_INCLUDED
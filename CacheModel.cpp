@@ -0,0 +1,30 @@
+#include "CacheModel.h"
+
+#include <algorithm>
+
+CacheModel::CacheModel(size_t sizeBytes, size_t ways, size_t lineBytes) :
+	ways_(std::max<size_t>(1, ways)), lineBytes_(std::max<size_t>(1, lineBytes)), 
+	numSets_(std::max<size_t>(1, sizeBytes / (ways_ * lineBytes_))), 
+	tags_(numSets_ * ways_, ~uint64_t(0)), used_(numSets_ * ways_, 0), clock_(0), accesses_(0), misses_(0) {
+
+}
+
+void CacheModel::access(uint64_t address, size_t bytes) {
+	const uint64_t first = address / lineBytes_;
+	const uint64_t last = (address + std::max<size_t>(1, bytes) - 1) / lineBytes_;
+	for (uint64_t line = first; line <= last; ++line) {
+		++accesses_;
+		const size_t set = size_t(line % numSets_);
+		uint64_t* tags = &tags_[set * ways_];
+		uint64_t* used = &used_[set * ways_];
+		size_t way = 0;
+		while (way < ways_ && tags[way] != line) ++way;
+		if (way == ways_) {
+			// Miss, so replace the least recently used line
+			++misses_;
+			way = size_t(std::min_element(used, used + ways_) - used);
+			tags[way] = line;
+		}
+		used[way] = ++clock_;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#ifndef CACHE_MODEL_H_INCLUDED
+#define CACHE_MODEL_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** \file
+ * \brief CacheModel class header file.
+ */
+
+/**
+ * \brief A simulated set-associative cache with least-recently-used replacement.
+ *
+ * Memory accesses are fed to the model as addresses, and it counts how many of 
+ * them would miss in a cache of the given size. This gives a repeatable measure of 
+ * the locality of an access pattern, which (unlike hardware counters) does not
+ * depend on the machine, other programs, or the operating system's permission to
+ * read the counters.
+ */
+class CacheModel {
+
+public:
+
+	/** \brief CacheModel constructor.
+	 *
+	 * \param sizeBytes The total size of the cache.
+	 * \param ways The number of lines in each set.
+	 * \param lineBytes The size of each cache line.
+	 */
+	CacheModel(size_t sizeBytes, size_t ways, size_t lineBytes = 64);
+
+	/** \brief Access a range of memory.
+	 *
+	 * Each cache line that the range touches counts as one access.
+	 *
+	 * \param address The address of the first byte.
+	 * \param bytes The number of bytes.
+	 */
+	void access(uint64_t address, size_t bytes);
+
+	/** \brief The number of cache lines accessed so far. */
+	unsigned long long accesses() const { return accesses_; }
+
+	/** \brief The number of accesses so far which missed. */
+	unsigned long long misses() const { return misses_; }
+
+private:
+
+	size_t ways_;                 //!< Lines per set.
+	size_t lineBytes_;            //!< Bytes per line.
+	size_t numSets_;              //!< Number of sets.
+	std::vector<uint64_t> tags_;  //!< Line address held in each way of each set, or ~0 if empty.
+	std::vector<uint64_t> used_;  //!< When each way of each set was last accessed.
+	uint64_t clock_;              //!< Counts accesses, to order the uses.
+	unsigned long long accesses_; //!< Number of lines accessed.
+	unsigned long long misses_;   //!< Number of lines which missed.
+};
+
+#endif // CACHE_MODEL_H_INCLUDED
@@ -18,4 +18,8 @@ Camera& Camera::operator=(const Camera& camera) {
 	}
 
 	return *this;
-}
\ No newline at end of file
+}
+
+bool Camera::projectBounds(const BoundingBox& /*bounds*/, double& /*minX*/, double& /*minY*/, double& /*maxX*/, double& /*maxY*/) const {
+	return false;
+}
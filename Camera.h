@@ -3,6 +3,7 @@
 #ifndef CAMERA_H_INCLUDED
 #define CAMERA_H_INCLUDED
 
+#include "BoundingBox.h"
 #include "Ray.h"
 #include "Transform.h"
 
@@ -47,6 +48,25 @@ public:
 	 */
 	virtual Ray castRay(double x, double y) const = 0;
 
+	/** \brief Find the region of the image plane where a BoundingBox can appear.
+	 *
+	 * This is the inverse of castRay(): any Ray from castRay(x, y) which hits something
+	 * inside the BoundingBox has (x, y) within the returned region. This lets the Scene
+	 * skip Objects which cannot be seen in part of the image. If nothing in the box can
+	 * be seen at all, the region is empty (minX > maxX).
+	 *
+	 * Not every Camera model makes this easy, so the default implementation returns false,
+	 * meaning that the box could appear anywhere.
+	 *
+	 * \param bounds The BoundingBox to project.
+	 * \param minX Set to the smallest x-value of the region.
+	 * \param minY Set to the smallest y-value of the region.
+	 * \param maxX Set to the largest x-value of the region.
+	 * \param maxY Set to the largest y-value of the region.
+	 * \return true if the region was found, false if it could be anywhere.
+	 */
+	virtual bool projectBounds(const BoundingBox& bounds, double& minX, double& minY, double& maxX, double& maxY) const;
+
 	Transform transform; //!< Transformation to apply to the Camera.
 
 protected:
@@ -0,0 +1,66 @@
+#include "CompiledScene.h"
+
+#include "Point.h"
+
+#include <cmath>
+
+namespace {
+
+	bool sameColour(const Colour& a, const Colour& b) {
+		return a.red == b.red && a.green == b.green && a.blue == b.blue;
+	}
+
+	bool sameMaterial(const Material& a, const Material& b) {
+		return sameColour(a.ambientColour, b.ambientColour) && sameColour(a.diffuseColour, b.diffuseColour) &&
+		       sameColour(a.specularColour, b.specularColour) && a.specularExponent == b.specularExponent &&
+		       sameColour(a.mirrorColour, b.mirrorColour);
+	}
+
+}
+
+CompiledScene::CompiledScene(const std::vector<std::shared_ptr<LightSource>>& lights, const std::vector<std::shared_ptr<Object>>& objects,
+                             HugePages hugePages) :
+	bounds_(objects.size(), WorldBounds(), LargeAllocator<WorldBounds>(hugePages)), ambientLights_(), directLights_(), materials_(), materialOf_(findMaterials(objects, materials_)),
+	shadowCasters_(lights, objects), materialClasses_(materials_, materialOf_), specularTables_(materials_, materialOf_) {
+
+	for (size_t ix = 0; ix < objects.size(); ++ix) {
+		const BoundingBox box = objects[ix]->getBounds();
+		for (size_t axis = 0; axis < 3; ++axis) {
+			// Pad by a little more than the rounding error in the intersection tests
+			const double pad = epsilon + 1e-9 * std::max(std::abs(box.lower(axis)), std::abs(box.upper(axis)));
+			bounds_[ix].lower[axis] = box.lower(axis) - pad;
+			bounds_[ix].upper[axis] = box.upper(axis) + pad;
+		}
+	}
+
+	// Ambient LightSources have a negative distance everywhere
+	for (unsigned int l = 0; l < lights.size(); ++l) {
+		if (lights[l]->getDistanceToLight(Point()) < 0) {
+			ambientLights_.push_back(l);
+		} else {
+			directLights_.push_back(l);
+		}
+	}
+}
+
+CompiledScene::~CompiledScene() {
+
+}
+
+std::vector<unsigned int> CompiledScene::findMaterials(const std::vector<std::shared_ptr<Object>>& objects, std::vector<Material>& materials) {
+	std::vector<unsigned int> materialOf;
+	for (const auto& object : objects) {
+		size_t material = 0;
+		while (material < materials.size() && !sameMaterial(materials[material], object->material)) ++material;
+		if (material == materials.size()) materials.push_back(object->material);
+		materialOf.push_back((unsigned int)material);
+	}
+	return materialOf;
+}
+
+std::string CompiledScene::summary() const {
+	return std::to_string(bounds_.size()) + " object" + (bounds_.size() == 1 ? "" : "s") + ", " +
+	       std::to_string(materials_.size()) + " distinct material" + (materials_.size() == 1 ? "" : "s") + ", " +
+	       std::to_string(ambientLights_.size()) + " ambient and " + std::to_string(directLights_.size()) + " direct light" + 
+	       (directLights_.size() == 1 ? "" : "s");
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#ifndef COMPILED_SCENE_H_INCLUDED
+#define COMPILED_SCENE_H_INCLUDED
+
+#include "FastMath.h"
+#include "HugePages.h"
+#include "LightSource.h"
+#include "Material.h"
+#include "MaterialClasses.h"
+#include "NonCopyable.h"
+#include "Object.h"
+#include "Ray.h"
+#include "ShadowCasters.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** \file
+ * \brief CompiledScene class header file.
+ */
+
+/**
+ * \brief Immutable snapshot of the derived data needed to render a Scene.
+ *
+ * A Scene is built up piece by piece (usually by a SceneReader), so anything that
+ * depends on all of its Objects and LightSources can only be worked out once it is
+ * complete. Scene::freeze() collects all of this into a CompiledScene:
+ * - the world-space BoundingBox of each Object, so Rays can skip Objects they cannot hit;
+ * - the LightSources split into ambient and direct lists, so shading need not ask
+ *   each LightSource whether it is ambient;
+ * - the distinct Materials, and which one each Object uses;
+ * - the ShadowCasters, MaterialClasses, and SpecularTables built from these.
+ *
+ * A CompiledScene holds only this derived data. The Objects themselves are not copied
+ * or flattened: each Ray is still intersected by calling the Object (through its own
+ * Transform), and ScreenFootprints are projected from the Objects, so these stay in the
+ * Scene, which must not be changed while it is being rendered.
+ *
+ * Nothing in a CompiledScene changes once it is built, so every render thread (and
+ * every view) can share it without locking. The per-Object arrays are aligned to 
+ * 64-byte cache lines, so the bounds of one Object never share a line with another,
+ * and may be backed by huge pages when they are large.
+ *
+ * On a machine with several NUMA nodes, a Scene may build one CompiledScene per node
+ * so that each render thread reads memory local to it (see Scene::numaPlacement).
+ */
+class CompiledScene : private NonCopyable {
+
+public:
+
+	/** \brief Compile a set of LightSources and Objects.
+	 *
+	 * \param lights The LightSources in the Scene. Light indices refer to this vector.
+	 * \param objects The Objects in the Scene. Object indices refer to this vector.
+	 * \param hugePages How to back the per-Object bounds.
+	 */
+	CompiledScene(const std::vector<std::shared_ptr<LightSource>>& lights, const std::vector<std::shared_ptr<Object>>& objects,
+	              HugePages hugePages = HugePages::None);
+
+	/** \brief CompiledScene destructor. */
+	~CompiledScene();
+
+	/** \brief Test whether a Ray can possibly hit an Object.
+	 *
+	 * This is a slab test of the Ray against the Object's world-space bounds, which
+	 * are padded slightly so that rounding never rejects a genuine hit.
+	 *
+	 * \param object The index of the Object.
+	 * \param ray The Ray to test.
+	 * \return false if the Ray (in the forward direction) misses the bounds, true otherwise.
+	 */
+	bool mayHit(unsigned int object, const Ray& ray) const {
+		const double start[3] = { ray.point(0), ray.point(1), ray.point(2) };
+		const double direction[3] = { ray.direction(0), ray.direction(1), ray.direction(2) };
+		return mayHit(object, start, direction);
+	}
+
+	/** \brief Check whether a Ray, given as plain arrays, can hit an Object's bounds.
+	 *
+	 * This is the same as mayHit(unsigned int, const Ray&) const, for Rays which are
+	 * not stored as Ray objects, such as those in a RayQueue.
+	 *
+	 * \param object The index of the Object.
+	 * \param rayStart The x, y, and z components of the Ray's start Point.
+	 * \param rayDirection The x, y, and z components of the Ray's Direction.
+	 * \return false if the Ray (in the forward direction) misses the bounds, true otherwise.
+	 */
+	bool mayHit(unsigned int object, const double rayStart[3], const double rayDirection[3]) const {
+		const WorldBounds& bounds = bounds_[object];
+		double nearest = 0;
+		double furthest = infinity;
+		for (size_t axis = 0; axis < 3; ++axis) {
+			const double start = rayStart[axis];
+			const double direction = rayDirection[axis];
+			if (direction == 0) {
+				// Parallel to this pair of faces, so the Ray must start between them
+				if (start < bounds.lower[axis] || start > bounds.upper[axis]) return false;
+				continue;
+			}
+			double t0 = (bounds.lower[axis] - start) / direction;
+			double t1 = (bounds.upper[axis] - start) / direction;
+			if (t0 > t1) std::swap(t0, t1);
+			if (t0 > nearest) nearest = t0;
+			if (t1 < furthest) furthest = t1;
+			if (nearest > furthest) return false;
+		}
+		return true;
+	}
+
+	/** \brief The number of Objects compiled. */
+	size_t numObjects() const { return bounds_.size(); }
+
+	/** \brief The indices of the ambient LightSources, in the order they were added. */
+	const std::vector<unsigned int>& ambientLights() const { return ambientLights_; }
+
+	/** \brief The indices of the direct (shadow casting) LightSources, in the order they were added. */
+	const std::vector<unsigned int>& directLights() const { return directLights_; }
+
+	/** \brief The distinct Materials used by the Objects. */
+	const std::vector<Material>& materials() const { return materials_; }
+
+	/** \brief The possible blockers of each LightSource. */
+	const ShadowCasters& shadowCasters() const { return shadowCasters_; }
+
+	/** \brief The shading terms of each Object's Material. */
+	const MaterialClasses& materialClasses() const { return materialClasses_; }
+
+	/** \brief The specular lookup tables for fastMath shading. */
+	const SpecularTables& specularTables() const { return specularTables_; }
+
+	/** \brief Describe the compiled Scene, for reporting.
+	 *
+	 * \return A summary such as "12 objects, 5 distinct materials, 1 ambient and 2 direct lights".
+	 */
+	std::string summary() const;
+
+private:
+
+	/** \brief The world-space bounds of one Object, padded to a whole cache line. */
+	struct alignas(64) WorldBounds {
+		double lower[3]; //!< Smallest X-, Y-, and Z-co-ordinates.
+		double upper[3]; //!< Largest X-, Y-, and Z-co-ordinates.
+	};
+
+	/** \brief Find the distinct Materials of a set of Objects.
+	 *
+	 * \param objects The Objects in the Scene.
+	 * \param materials Filled with the distinct Materials.
+	 * \return The index into materials of each Object's Material.
+	 */
+	static std::vector<unsigned int> findMaterials(const std::vector<std::shared_ptr<Object>>& objects, std::vector<Material>& materials);
+
+	std::vector<WorldBounds, LargeAllocator<WorldBounds>> bounds_; //!< World-space bounds of each Object.
+	std::vector<unsigned int> ambientLights_;  //!< Indices of the ambient LightSources.
+	std::vector<unsigned int> directLights_;   //!< Indices of the other LightSources.
+	std::vector<Material> materials_;          //!< The distinct Materials.
+	std::vector<unsigned int> materialOf_;     //!< Index into materials_ for each Object.
+	ShadowCasters shadowCasters_;              //!< Possible blockers of each LightSource.
+	MaterialClasses materialClasses_;          //!< Shading terms of each Object's Material.
+	SpecularTables specularTables_;            //!< Specular lookup tables for fastMath shading.
+};
+
+#endif // COMPILED_SCENE_H_INCLUDED
@@ -0,0 +1,158 @@
+#include "CostHeatmap.h"
+
+#include "ImageEncoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+	/** \brief A point on the false colour scale. */
+	struct ColourStop {
+		double position;      //!< Where the stop is on the scale, from 0 to 1.
+		unsigned char rgb[3]; //!< Its colour.
+	};
+
+	// Black through blue, red, and yellow to white, so that brightness increases with cost
+	const ColourStop colourScale[] = {
+		{ 0.0,  {   0,   0,   0 } },
+		{ 0.25, {  40,  20, 160 } },
+		{ 0.5,  { 200,  30,  60 } },
+		{ 0.75, { 250, 200,  20 } },
+		{ 1.0,  { 255, 255, 255 } }
+	};
+
+	/** \brief The false colour of a point on the scale, from 0 to 1. */
+	void falseColour(double t, unsigned char* rgb) {
+		t = std::max(0.0, std::min(1.0, t));
+		size_t stop = 1;
+		while (stop + 1 < sizeof(colourScale) / sizeof(colourScale[0]) && colourScale[stop].position < t) ++stop;
+		const ColourStop& low = colourScale[stop - 1];
+		const ColourStop& high = colourScale[stop];
+		const double blend = (t - low.position) / (high.position - low.position);
+		for (int channel = 0; channel < 3; ++channel) {
+			rgb[channel] = (unsigned char)std::lround(low.rgb[channel] + blend*(high.rgb[channel] - low.rgb[channel]));
+		}
+	}
+
+	/** \brief Write a cost with a few significant figures, but never in scientific notation. */
+	std::string formatCost(double value) {
+		std::ostringstream out;
+		if (value < 1000) {
+			out << std::setprecision(3) << value;
+		} else {
+			out << std::fixed << std::setprecision(0) << value;
+		}
+		return out.str();
+	}
+
+}
+
+CostHeatmap::CostHeatmap(CostMetric metric, unsigned int width, unsigned int height, unsigned int tileSize) :
+	metric_(metric), width_(width), height_(height), tileSize_(std::max(1u, tileSize)), costs_(size_t(width) * height, 0.0) {
+
+}
+
+CostHeatmap::~CostHeatmap() {
+
+}
+
+bool CostHeatmap::save(const std::string& filename, ThreadPool* pool) const {
+	// Scale to the 99th percentile of the pixels that cost anything
+	std::vector<double> nonZero;
+	for (double cost : costs_) {
+		if (cost > 0) nonZero.push_back(cost);
+	}
+	double scale = 0;
+	if (!nonZero.empty()) {
+		const size_t percentile = size_t(0.99 * double(nonZero.size() - 1));
+		std::nth_element(nonZero.begin(), nonZero.begin() + percentile, nonZero.end());
+		scale = nonZero[percentile];
+	}
+
+	std::vector<unsigned char> pixels(3 * costs_.size());
+	for (size_t pixel = 0; pixel < costs_.size(); ++pixel) {
+		falseColour(scale > 0 ? costs_[pixel] / scale : 0, &pixels[3 * pixel]);
+	}
+	std::vector<unsigned char> file;
+	if (!encodeImage(imageFormatForFile(filename), pixels.data(), width_, height_, file, pool)) return false;
+	std::ofstream fout(filename, std::ios::binary);
+	fout.write(reinterpret_cast<const char*>(file.data()), std::streamsize(file.size()));
+	return bool(fout);
+}
+
+bool CostHeatmap::saveTiles(const std::string& filename) const {
+	const std::vector<Tile> tiles = this->tiles();
+	double total = 0;
+	for (const Tile& tile : tiles) {
+		total += tile.cost;
+	}
+
+	std::ofstream fout(filename);
+	const std::string unit = unitName(metric_);
+	fout << "tile_x,tile_y,x,y,width,height,cost_" << unit << ",mean_" << unit << "_per_pixel,percent" << std::endl;
+	for (const Tile& tile : tiles) {
+		fout << tile.x / tileSize_ << "," << tile.y / tileSize_ << "," << tile.x << "," << tile.y << "," << tile.width << "," << tile.height << ","
+		     << tile.cost << "," << tile.cost / (double(tile.width) * tile.height) << "," << (total > 0 ? 100 * tile.cost / total : 0) << std::endl;
+	}
+	return bool(fout);
+}
+
+std::string CostHeatmap::summary() const {
+	const std::string unit = unitName(metric_);
+	std::vector<Tile> tiles = this->tiles();
+	double total = 0;
+	for (const Tile& tile : tiles) {
+		total += tile.cost;
+	}
+	const double mostCostly = costs_.empty() ? 0 : *std::max_element(costs_.begin(), costs_.end());
+
+	std::ostringstream out;
+	out << formatCost(total) << " " << unit << " in " << costs_.size() << " pixels, at most " << formatCost(mostCostly) << " " << unit << " per pixel";
+	if (total > 0) {
+		std::sort(tiles.begin(), tiles.end(), [](const Tile& a, const Tile& b) { return a.cost > b.cost; });
+		const size_t tenth = (tiles.size() + 9) / 10;
+		double tenthCost = 0;
+		for (size_t ix = 0; ix < tenth; ++ix) {
+			tenthCost += tiles[ix].cost;
+		}
+		out << std::fixed << std::setprecision(1) << "; the most costly tile (" << tiles[0].x / tileSize_ << ", " << tiles[0].y / tileSize_
+		    << ") has " << 100 * tiles[0].cost / total << "% of the total, and the most costly tenth of the tiles have "
+		    << 100 * tenthCost / total << "%";
+	}
+	return out.str();
+}
+
+std::string CostHeatmap::filenameFor(const std::string& filename, const std::string& suffix, const std::string& extension) {
+	const size_t slash = filename.find_last_of('/');
+	size_t dot = filename.find_last_of('.');
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) dot = filename.size();
+	return filename.substr(0, dot) + "." + suffix + (extension.empty() ? filename.substr(dot) : "." + extension);
+}
+
+const char* CostHeatmap::unitName(CostMetric metric) {
+	switch (metric) {
+		case CostMetric::Time: return "ns";
+		case CostMetric::Rays: return "rays";
+		default: return "none";
+	}
+}
+
+std::vector<CostHeatmap::Tile> CostHeatmap::tiles() const {
+	std::vector<Tile> tiles;
+	for (unsigned int y = 0; y < height_; y += tileSize_) {
+		for (unsigned int x = 0; x < width_; x += tileSize_) {
+			Tile tile{x, y, std::min(tileSize_, width_ - x), std::min(tileSize_, height_ - y), 0};
+			for (unsigned int v = y; v < y + tile.height; ++v) {
+				for (unsigned int u = x; u < x + tile.width; ++u) {
+					tile.cost += costs_[size_t(v)*width_ + u];
+				}
+			}
+			tiles.push_back(tile);
+		}
+	}
+	return tiles;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#ifndef COST_HEATMAP_H_INCLUDED
+#define COST_HEATMAP_H_INCLUDED
+
+#include "NonCopyable.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+/** \file
+ * \brief CostHeatmap class header file.
+ */
+
+/**
+ * \brief What a CostHeatmap measures for each pixel.
+ */
+enum class CostMetric {
+	None, //!< No heatmap is kept.
+	Time, //!< Time taken to compute the pixel, in nanoseconds.
+	Rays  //!< Rays traced for the pixel: primary, shadow, and reflected.
+};
+
+/**
+ * \brief The cost of rendering each pixel of an image, for finding where the time goes.
+ *
+ * Scene::renderTile() adds the cost of each pixel it computes. Tiles are rendered by
+ * one thread at a time, so no locking is needed. Pixels of empty tiles, which are
+ * filled with the background without tracing any Rays, cost nothing. When a pixel
+ * stands for a block of pixels (as in the preview passes of Scene::renderWithinBudget())
+ * its whole cost is added to the pixel at the corner of the block, and later passes
+ * add to the same pixels, so the heatmap shows the cost of every pass.
+ *
+ * The heatmap is saved as a false colour image, from black for the cheapest pixels
+ * through blue, red, and yellow to white for the most costly. The scale is set by the
+ * 99th percentile of the non-zero costs, so a few extreme pixels do not hide the rest.
+ * The total cost of each tile can also be saved as CSV.
+ */
+class CostHeatmap : private NonCopyable {
+
+public:
+
+	/** \brief CostHeatmap constructor. Every pixel starts with no cost.
+	 *
+	 * \param metric What to measure.
+	 * \param width The width of the image in pixels.
+	 * \param height The height of the image in pixels.
+	 * \param tileSize The width and height of the tiles totalled by saveTiles().
+	 */
+	CostHeatmap(CostMetric metric, unsigned int width, unsigned int height, unsigned int tileSize);
+
+	/** \brief CostHeatmap destructor. */
+	~CostHeatmap();
+
+	/** \brief What the heatmap measures.
+	 *
+	 * \return The metric given to the constructor.
+	 */
+	CostMetric metric() const { return metric_; }
+
+	/** \brief Add to the cost of a pixel.
+	 *
+	 * \param u The column of the pixel.
+	 * \param v The row of the pixel.
+	 * \param cost The cost to add, in the units of the metric.
+	 */
+	void add(unsigned int u, unsigned int v, double cost) { costs_[size_t(v)*width_ + u] += cost; }
+
+	/** \brief Save the heatmap as a false colour image.
+	 *
+	 * \param filename The file to save to. The format is chosen from its extension, as for ImageDisplay::save().
+	 * \param pool The ThreadPool to encode with, or \c nullptr to encode on the calling thread.
+	 * \return true if the file was written, false otherwise.
+	 */
+	bool save(const std::string& filename, ThreadPool* pool = nullptr) const;
+
+	/** \brief Save the total cost of each tile as CSV.
+	 *
+	 * There is one row per tile, in scanline order, with the tile's column and row, the
+	 * pixel co-ordinates and size of the tile, its total and mean cost per pixel, and its
+	 * percentage of the cost of the whole image.
+	 *
+	 * \param filename The file to write, which is replaced if it exists.
+	 * \return true if the file was written, false otherwise.
+	 */
+	bool saveTiles(const std::string& filename) const;
+
+	/** \brief Summarise where the cost is on one line.
+	 *
+	 * \return The total cost, the most costly pixel and tile, and the share of the cost in the most costly tenth of the tiles.
+	 */
+	std::string summary() const;
+
+	/** \brief The name of a file saved next to a render, such as \c render.heatmap.png for \c render.png.
+	 *
+	 * \param filename The file the image is saved to.
+	 * \param suffix What to add before the extension, such as "heatmap".
+	 * \param extension The extension of the new file, or empty to keep that of the image.
+	 * \return The new file name.
+	 */
+	static std::string filenameFor(const std::string& filename, const std::string& suffix, const std::string& extension = "");
+
+	/** \brief The unit of a CostMetric, as used in reports.
+	 *
+	 * \param metric The metric.
+	 * \return A short name, such as "ns".
+	 */
+	static const char* unitName(CostMetric metric);
+
+private:
+
+	/** \brief The total cost of one tile. */
+	struct Tile {
+		unsigned int x;      //!< Column of the tile's top left pixel.
+		unsigned int y;      //!< Row of the tile's top left pixel.
+		unsigned int width;  //!< Width of the tile in pixels.
+		unsigned int height; //!< Height of the tile in pixels.
+		double cost;         //!< Total cost of the tile's pixels.
+	};
+
+	/** \brief The total cost of every tile, in scanline order.
+	 *
+	 * \return One Tile per tile of the image.
+	 */
+	std::vector<Tile> tiles() const;
+
+	CostMetric metric_;         //!< What is measured.
+	unsigned int width_;        //!< Width of the image in pixels.
+	unsigned int height_;       //!< Height of the image in pixels.
+	unsigned int tileSize_;     //!< Width and height of each tile in pixels.
+	std::vector<double> costs_; //!< Cost of each pixel, row by row.
+};
+
+#endif // COST_HEATMAP_H_INCLUDED
@@ -0,0 +1,210 @@
+#include "Denoiser.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+	const float kernel[5] = { 1.0f/16, 1.0f/4, 3.0f/8, 1.0f/4, 1.0f/16 }; // B3-spline taps
+
+	/** \brief exp(x) for x <= 0, to about 1e-4 relative error, which is plenty for filter weights. */
+	inline float expApprox(float x) {
+		const float t = std::max(x, -80.0f) * 1.442695041f;
+		const float whole = std::floor(t);
+		const float f = t - whole;
+		const float p = 1.0f + f*(0.6931472f + f*(0.2402265f + f*(0.0555041f + f*(0.0096181f + f*0.0013334f))));
+		const int32_t bits = (int32_t(whole) + 127) << 23;
+		float scale;
+		std::memcpy(&scale, &bits, sizeof(float));
+		return p * scale;
+	}
+
+#if defined(__SSE2__)
+	/** \brief Four lanes of expApprox(), giving the same results. */
+	inline __m128 expApprox(__m128 x) {
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 t = _mm_mul_ps(_mm_max_ps(x, _mm_set1_ps(-80.0f)), _mm_set1_ps(1.442695041f));
+		const __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(t));
+		const __m128 whole = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmplt_ps(t, truncated), one));
+		const __m128 f = _mm_sub_ps(t, whole);
+		__m128 p = _mm_set1_ps(0.0013334f);
+		p = _mm_add_ps(_mm_set1_ps(0.0096181f), _mm_mul_ps(f, p));
+		p = _mm_add_ps(_mm_set1_ps(0.0555041f), _mm_mul_ps(f, p));
+		p = _mm_add_ps(_mm_set1_ps(0.2402265f), _mm_mul_ps(f, p));
+		p = _mm_add_ps(_mm_set1_ps(0.6931472f), _mm_mul_ps(f, p));
+		p = _mm_add_ps(one, _mm_mul_ps(f, p));
+		const __m128i bits = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(whole), _mm_set1_epi32(127)), 23);
+		return _mm_mul_ps(p, _mm_castsi128_ps(bits));
+	}
+#endif
+
+	/** \brief The image, and its features, with each channel in a separate plane. */
+	struct Planes {
+		std::vector<float> red, green, blue;        //!< Colour being filtered.
+		std::vector<float> normalX, normalY, normalZ; //!< Unit surface Normals.
+		std::vector<float> depth;                  //!< Depth of each pixel.
+		std::vector<float> inverseDepth;           //!< 1/depth, for relative depth differences.
+		std::vector<int32_t> object;               //!< Object seen by each pixel.
+	};
+
+	/** \brief Tolerances for one filter pass, as 1/sigma^2. */
+	struct Weights {
+		float colour, normal, depth;
+	};
+
+	/** \brief Filter a single pixel (any pixel, checking every tap is inside the image). */
+	void filterPixel(const Planes& in, std::vector<float>& red, std::vector<float>& green, std::vector<float>& blue,
+	                 size_t width, size_t height, size_t x, size_t y, size_t step, const Weights& weights) {
+		const size_t p = y*width + x;
+		float sumWeight = 0, sumRed = 0, sumGreen = 0, sumBlue = 0;
+		for (int dy = -2; dy <= 2; ++dy) {
+			const long long yy = (long long)y + dy*(long long)step;
+			if (yy < 0 || yy >= (long long)height) continue;
+			for (int dx = -2; dx <= 2; ++dx) {
+				const long long xx = (long long)x + dx*(long long)step;
+				if (xx < 0 || xx >= (long long)width) continue;
+				const size_t q = size_t(yy)*width + size_t(xx);
+				if (in.object[q] != in.object[p]) continue;
+				const float dr = in.red[q] - in.red[p], dg = in.green[q] - in.green[p], db = in.blue[q] - in.blue[p];
+				const float nx = in.normalX[q] - in.normalX[p], ny = in.normalY[q] - in.normalY[p], nz = in.normalZ[q] - in.normalZ[p];
+				const float dd = (in.depth[q] - in.depth[p]) * in.inverseDepth[p];
+				const float colourDiff = dr*dr + dg*dg + db*db;
+				const float normalDiff = nx*nx + ny*ny + nz*nz;
+				const float exponent = -(colourDiff*weights.colour + normalDiff*weights.normal + (dd*dd)*weights.depth);
+				const float weight = (kernel[dx + 2]*kernel[dy + 2]) * expApprox(exponent);
+				sumWeight += weight;
+				sumRed += weight * in.red[q];
+				sumGreen += weight * in.green[q];
+				sumBlue += weight * in.blue[q];
+			}
+		}
+		// The centre tap always has a positive weight
+		red[p] = sumRed / sumWeight;
+		green[p] = sumGreen / sumWeight;
+		blue[p] = sumBlue / sumWeight;
+	}
+
+#if defined(__SSE2__)
+	/** \brief Filter four neighbouring pixels, all of whose taps across are inside the image. */
+	void filterPixels4(const Planes& in, std::vector<float>& red, std::vector<float>& green, std::vector<float>& blue,
+	                   size_t width, size_t height, size_t x, size_t y, size_t step, const Weights& weights) {
+		const size_t p = y*width + x;
+		const __m128 red0 = _mm_loadu_ps(&in.red[p]), green0 = _mm_loadu_ps(&in.green[p]), blue0 = _mm_loadu_ps(&in.blue[p]);
+		const __m128 normalX0 = _mm_loadu_ps(&in.normalX[p]), normalY0 = _mm_loadu_ps(&in.normalY[p]), normalZ0 = _mm_loadu_ps(&in.normalZ[p]);
+		const __m128 depth0 = _mm_loadu_ps(&in.depth[p]), inverseDepth0 = _mm_loadu_ps(&in.inverseDepth[p]);
+		const __m128i object0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&in.object[p]));
+		const __m128 colourWeight = _mm_set1_ps(weights.colour), normalWeight = _mm_set1_ps(weights.normal), depthWeight = _mm_set1_ps(weights.depth);
+		const __m128 zero = _mm_setzero_ps();
+
+		__m128 sumWeight = zero, sumRed = zero, sumGreen = zero, sumBlue = zero;
+		for (int dy = -2; dy <= 2; ++dy) {
+			const long long yy = (long long)y + dy*(long long)step;
+			if (yy < 0 || yy >= (long long)height) continue;
+			for (int dx = -2; dx <= 2; ++dx) {
+				const size_t q = size_t(yy)*width + size_t((long long)x + dx*(long long)step);
+				const __m128 r = _mm_loadu_ps(&in.red[q]), g = _mm_loadu_ps(&in.green[q]), b = _mm_loadu_ps(&in.blue[q]);
+				const __m128 dr = _mm_sub_ps(r, red0), dg = _mm_sub_ps(g, green0), db = _mm_sub_ps(b, blue0);
+				const __m128 nx = _mm_sub_ps(_mm_loadu_ps(&in.normalX[q]), normalX0);
+				const __m128 ny = _mm_sub_ps(_mm_loadu_ps(&in.normalY[q]), normalY0);
+				const __m128 nz = _mm_sub_ps(_mm_loadu_ps(&in.normalZ[q]), normalZ0);
+				const __m128 dd = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&in.depth[q]), depth0), inverseDepth0);
+				const __m128 colourDiff = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+				const __m128 normalDiff = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+				const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(colourDiff, colourWeight), _mm_mul_ps(normalDiff, normalWeight)),
+				                              _mm_mul_ps(_mm_mul_ps(dd, dd), depthWeight));
+				const __m128 sameObject = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&in.object[q])), object0));
+				const __m128 weight = _mm_and_ps(sameObject,
+				                                 _mm_mul_ps(_mm_set1_ps(kernel[dx + 2]*kernel[dy + 2]), expApprox(_mm_sub_ps(zero, sum))));
+				sumWeight = _mm_add_ps(sumWeight, weight);
+				sumRed = _mm_add_ps(sumRed, _mm_mul_ps(weight, r));
+				sumGreen = _mm_add_ps(sumGreen, _mm_mul_ps(weight, g));
+				sumBlue = _mm_add_ps(sumBlue, _mm_mul_ps(weight, b));
+			}
+		}
+		_mm_storeu_ps(&red[p], _mm_div_ps(sumRed, sumWeight));
+		_mm_storeu_ps(&green[p], _mm_div_ps(sumGreen, sumWeight));
+		_mm_storeu_ps(&blue[p], _mm_div_ps(sumBlue, sumWeight));
+	}
+#endif
+
+}
+
+Denoiser::Denoiser(unsigned int iterations, float colourSigma, float normalSigma, float depthSigma) :
+	iterations_(iterations), colourSigma_(colourSigma), normalSigma_(normalSigma), depthSigma_(depthSigma) {
+
+}
+
+Denoiser::~Denoiser() {
+
+}
+
+void Denoiser::apply(const std::vector<float>& radiance, const std::vector<PixelFeatures>& features, size_t width, size_t height,
+                     std::vector<float>& filtered, ThreadPool* pool) const {
+	const size_t numPixels = width * height;
+	Planes planes;
+	planes.red.resize(numPixels);
+	planes.green.resize(numPixels);
+	planes.blue.resize(numPixels);
+	planes.normalX.resize(numPixels);
+	planes.normalY.resize(numPixels);
+	planes.normalZ.resize(numPixels);
+	planes.depth.resize(numPixels);
+	planes.inverseDepth.resize(numPixels);
+	planes.object.resize(numPixels);
+	for (size_t p = 0; p < numPixels; ++p) {
+		planes.red[p] = radiance[3*p];
+		planes.green[p] = radiance[3*p + 1];
+		planes.blue[p] = radiance[3*p + 2];
+		planes.normalX[p] = features[p].normal[0];
+		planes.normalY[p] = features[p].normal[1];
+		planes.normalZ[p] = features[p].normal[2];
+		planes.depth[p] = features[p].depth;
+		planes.inverseDepth[p] = 1.0f / std::max(features[p].depth, 1e-3f);
+		planes.object[p] = features[p].object;
+	}
+
+	std::vector<float> red(numPixels), green(numPixels), blue(numPixels);
+	float colourSigma = colourSigma_;
+	for (unsigned int iteration = 0; iteration < iterations_; ++iteration) {
+		const size_t step = size_t(1) << iteration;
+		const Weights weights = { 1 / (colourSigma*colourSigma), 1 / (normalSigma_*normalSigma_), 1 / (depthSigma_*depthSigma_) };
+		auto filterRow = [&](size_t y, unsigned int) {
+			size_t x = 0;
+#if defined(__SSE2__)
+			// Pixels near the left and right edges have taps outside the image, so are done one at a time
+			for (; x < width && x < 2*step; ++x) {
+				filterPixel(planes, red, green, blue, width, height, x, y, step, weights);
+			}
+			for (; x + 3 + 2*step < width; x += 4) {
+				filterPixels4(planes, red, green, blue, width, height, x, y, step, weights);
+			}
+#endif
+			for (; x < width; ++x) {
+				filterPixel(planes, red, green, blue, width, height, x, y, step, weights);
+			}
+		};
+		if (pool) {
+			pool->parallelFor(height, filterRow);
+		} else {
+			for (size_t y = 0; y < height; ++y) filterRow(y, 0);
+		}
+		planes.red.swap(red);
+		planes.green.swap(green);
+		planes.blue.swap(blue);
+		colourSigma *= 0.5f;
+	}
+
+	filtered.resize(3 * numPixels);
+	for (size_t p = 0; p < numPixels; ++p) {
+		filtered[3*p] = planes.red[p];
+		filtered[3*p + 1] = planes.green[p];
+		filtered[3*p + 2] = planes.blue[p];
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#ifndef DENOISER_H_INCLUDED
+#define DENOISER_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+/** \file
+ * \brief Denoiser class header file.
+ */
+
+/**
+ * \brief What the primary Ray through a pixel hit.
+ *
+ * These are gathered while rendering, and tell a Denoiser where the edges
+ * in an image are, so that it can smooth noise without blurring them.
+ */
+struct PixelFeatures {
+	float normal[3]; //!< Surface Normal at the hit (all 0 if nothing was hit).
+	float depth;     //!< Distance along the primary Ray to the hit (0 if nothing was hit).
+	int32_t object;  //!< Index of the Object hit, -1 for the background, or below -1 (and unique to the pixel) if its samples saw different things.
+};
+
+/**
+ * \brief Edge-avoiding a-trous wavelet filter for noisy renders.
+ *
+ * The filter (after Dammertz et al., "Edge-Avoiding A-Trous Wavelet Transform
+ * for fast Global Illumination Filtering", 2010) repeatedly blurs the float
+ * framebuffer with a 5x5 B-spline kernel whose taps are spread further apart on
+ * each iteration (1, 2, 4, ... pixels), so a few iterations cover a wide area at
+ * the cost of 25 taps per pixel each. Each tap is weighted by how alike the two
+ * pixels are in colour, surface Normal, and depth, and pixels showing different
+ * Objects are never mixed, so edges and silhouettes stay sharp while noise within
+ * a surface is smoothed away. Pixels straddling an edge are left as they are. The
+ * colour tolerance halves on each iteration, so later, wider, passes only even out
+ * small differences.
+ *
+ * Rows are shared between the threads of a ThreadPool, and each row is filtered
+ * four pixels at a time with SSE instructions where available.
+ */
+class Denoiser {
+
+public:
+
+	/** \brief Denoiser constructor.
+	 *
+	 * \param iterations Number of filter passes. The kernel covers (4 * 2^iterations - 3) pixels across.
+	 * \param colourSigma Colour difference at which a tap's weight falls to 1/e, on the first pass.
+	 * \param normalSigma Difference between unit Normals at which a tap's weight falls to 1/e.
+	 * \param depthSigma Relative depth difference at which a tap's weight falls to 1/e.
+	 */
+	explicit Denoiser(unsigned int iterations = 5, float colourSigma = 0.1f, float normalSigma = 0.3f, float depthSigma = 0.1f);
+
+	/** \brief Denoiser destructor. */
+	~Denoiser();
+
+	/** \brief Filter an image.
+	 *
+	 * \param radiance The linear colour of each pixel, row by row, three floats per pixel.
+	 * \param features The PixelFeatures of each pixel, row by row.
+	 * \param width The width of the image in pixels.
+	 * \param height The height of the image in pixels.
+	 * \param filtered Vector to hold the filtered image, in the same layout as \c radiance.
+	 * \param pool The ThreadPool to filter with, or \c nullptr to filter on the calling thread.
+	 */
+	void apply(const std::vector<float>& radiance, const std::vector<PixelFeatures>& features, size_t width, size_t height,
+	           std::vector<float>& filtered, ThreadPool* pool = nullptr) const;
+
+private:
+
+	unsigned int iterations_; //!< Number of filter passes.
+	float colourSigma_;       //!< Colour tolerance on the first pass.
+	float normalSigma_;       //!< Normal tolerance.
+	float depthSigma_;        //!< Relative depth tolerance.
+};
+
+#endif // DENOISER_H_INCLUDED
@@ -23,7 +23,7 @@ DirectionalLightSource& DirectionalLightSource::operator=(const DirectionalLight
 	return *this;
 }
 
-Colour DirectionalLightSource::getIlluminationAt(const Point& point) const {
+PackedColour DirectionalLightSource::getIlluminationAt(const Point& point) const {
 	return colour_;
 }
 
@@ -34,3 +34,7 @@ double DirectionalLightSource::getDistanceToLight(const Point& point) const {
 Direction DirectionalLightSource::getLightDirection(const Point& point) const {
 	return direction_;
 }
+
+bool DirectionalLightSource::mayBeShadowedBy(const BoundingBox& caster, const BoundingBox& receiver) const {
+	return caster.mayBlock(receiver, Direction(-direction_));
+}
@@ -54,7 +54,7 @@ public:
 	* \param point The Point at which light is measured.
 	* \return The illumination that reaches the Point from this DirectionalLightSource.
 	*/
-	Colour getIlluminationAt(const Point& point) const;
+	PackedColour getIlluminationAt(const Point& point) const;
 
 	/**
 	 * \brief Determine how far away the light source is from a given Point.
@@ -77,6 +77,15 @@ public:
 	 */
 	Direction getLightDirection(const Point& point) const;
 
+	/** \brief Check whether an Object might shadow another from this light.
+	 *
+	 * \param caster Bounds of the Object which might cast a shadow.
+	 * \param receiver Bounds of the Object which might be in shadow.
+	 * \return false if no point in receiver can be shadowed by caster, true otherwise.
+	 * \sa LightSource::mayBeShadowedBy()
+	 */
+	bool mayBeShadowedBy(const BoundingBox& caster, const BoundingBox& receiver) const;
+
 private:
 
 	Direction direction_; //!< The Direction that this light source sheds light in.
@@ -0,0 +1,53 @@
+#include "FastMath.h"
+
+#include <algorithm>
+
+namespace {
+
+	const size_t specularTableSize = 256; // Samples in each SpecularTable
+	const double specularCutoff = 0.25 / 255; // Values of x^n below this are taken as 0
+
+}
+
+SpecularTable::SpecularTable(double exponent) :
+	exponent_(exponent), start_(0), scale_(0), values_() {
+	if (exponent < 1) return;
+
+	// x^n reaches the cutoff at x = cutoff^(1/n)
+	const double start = std::pow(specularCutoff, 1 / exponent);
+	const double step = (1 - start) / (specularTableSize - 1);
+	values_.resize(specularTableSize);
+	for (size_t ix = 0; ix < specularTableSize; ++ix) {
+		values_[ix] = float(std::pow(std::min(1.0, start + ix*step), exponent));
+	}
+	start_ = float(start);
+	scale_ = float(1 / step);
+}
+
+double SpecularTable::maxError(size_t samples) const {
+	double worst = 0;
+	for (size_t i = 0; i <= samples; ++i) {
+		const double x = double(i) / samples;
+		worst = std::max(worst, std::abs(double((*this)(float(x))) - std::pow(double(float(x)), exponent_)));
+	}
+	return worst;
+}
+
+SpecularTables::SpecularTables(const std::vector<Material>& materials, const std::vector<unsigned int>& materialOf) :
+	tables_(), tableOfObject_() {
+	std::vector<unsigned int> tableOfMaterial;
+	for (const Material& material : materials) {
+		const double exponent = material.specularExponent;
+		size_t table = 0;
+		while (table < tables_.size() && tables_[table].exponent() != exponent) ++table;
+		if (table == tables_.size()) tables_.emplace_back(exponent);
+		tableOfMaterial.push_back((unsigned int)table);
+	}
+	for (unsigned int material : materialOf) {
+		tableOfObject_.push_back(tableOfMaterial[material]);
+	}
+}
+
+SpecularTables::~SpecularTables() {
+
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#ifndef FAST_MATH_H_INCLUDED
+#define FAST_MATH_H_INCLUDED
+
+#include "Material.h"
+#include "NonCopyable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+/** \file
+ * \brief Approximations used by the Scene's fastMath shading mode.
+ *
+ * Each approximation is accurate to well under one 8-bit level for Colours
+ * in the range [0,1]. Scene::verifyFastMath() checks this against the exact
+ * shading on a whole image.
+ */
+
+/**
+ * \brief Scale three vectors to unit length with one approximate reciprocal square root.
+ *
+ * The squared lengths are packed into one SSE register, and the hardware reciprocal
+ * square root estimate (good to 12 bits) is refined with a Newton-Raphson step, which
+ * gives a relative error of a few parts in 10 million. Without SSE, 1/sqrt() is used.
+ *
+ * \param vectors Three vectors of three components, each scaled in place.
+ */
+inline void normalizeThree(double vectors[3][3]) {
+	float squaredLengths[4];
+	for (int v = 0; v < 3; ++v) {
+		squaredLengths[v] = float(vectors[v][0]*vectors[v][0] + vectors[v][1]*vectors[v][1] + vectors[v][2]*vectors[v][2]);
+	}
+	squaredLengths[3] = 1.0f;
+	float scales[4];
+#if defined(__SSE__) || defined(_M_X64)
+	const __m128 x = _mm_loadu_ps(squaredLengths);
+	const __m128 estimate = _mm_rsqrt_ps(x);
+	// y' = y * (1.5 - 0.5 * x * y * y)
+	const __m128 refined = _mm_mul_ps(estimate, _mm_sub_ps(_mm_set1_ps(1.5f),
+	                                  _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), x), _mm_mul_ps(estimate, estimate))));
+	_mm_storeu_ps(scales, refined);
+#else
+	for (int v = 0; v < 4; ++v) scales[v] = 1.0f / std::sqrt(squaredLengths[v]);
+#endif
+	for (int v = 0; v < 3; ++v) {
+		for (int i = 0; i < 3; ++i) {
+			vectors[v][i] *= scales[v];
+		}
+	}
+}
+
+/**
+ * \brief Lookup table for the specular term \f$x^n\f$ of one specularExponent.
+ *
+ * Values of \f$x^n\f$ below a quarter of an 8-bit level are taken as 0. Above that
+ * the curve is sampled at evenly spaced points and interpolated linearly. Since the
+ * sampled range narrows as the exponent grows, the interpolation error (about
+ * \f$5/N^2\f$ for \f$N\f$ samples) does not depend on the exponent. Exponents
+ * below 1, whose curves are too steep near 0 to interpolate, use std::pow().
+ */
+class SpecularTable {
+
+public:
+
+	/** \brief SpecularTable constructor.
+	 *
+	 * \param exponent The specular exponent to tabulate.
+	 */
+	explicit SpecularTable(double exponent);
+
+	/** \brief The exponent that the table was built for.
+	 *
+	 * \return The specular exponent.
+	 */
+	double exponent() const { return exponent_; }
+
+	/** \brief Approximate \f$x^n\f$.
+	 *
+	 * \param x A value from 0 to 1 (the cosine of the angle to the reflected light).
+	 * \return Approximately x to the power of the exponent.
+	 */
+	float operator()(float x) const {
+		if (values_.empty()) return float(std::pow(x, exponent_));
+		const float position = (x - start_) * scale_;
+		if (!(position > 0)) return 0.0f;
+		const float last = float(values_.size() - 1);
+		const float clamped = position < last ? position : last;
+		const size_t ix = std::min(size_t(clamped), values_.size() - 2);
+		const float fraction = clamped - float(ix);
+		return values_[ix] + fraction * (values_[ix + 1] - values_[ix]);
+	}
+
+	/** \brief Measure the largest difference from std::pow() by dense sampling.
+	 *
+	 * \param samples The number of evenly spaced values of x from 0 to 1 to test.
+	 * \return The largest absolute error found.
+	 */
+	double maxError(size_t samples) const;
+
+private:
+
+	double exponent_;           //!< The specular exponent.
+	float start_;               //!< Smallest x in the table. Below this the result is 0.
+	float scale_;               //!< Table entries per unit of x.
+	std::vector<float> values_; //!< x to the power of the exponent at each sample, or empty to use std::pow().
+};
+
+/**
+ * \brief The SpecularTable for each Object in a Scene.
+ *
+ * One table is built for each distinct specularExponent, and shared by all the
+ * Objects with that exponent.
+ */
+class SpecularTables : private NonCopyable {
+
+public:
+
+	/** \brief Build the tables for a set of Objects.
+	 *
+	 * \param materials The distinct Materials in the Scene.
+	 * \param materialOf The index into materials of each Object's Material. Object indices refer to this vector.
+	 */
+	SpecularTables(const std::vector<Material>& materials, const std::vector<unsigned int>& materialOf);
+
+	/** \brief SpecularTables destructor. */
+	~SpecularTables();
+
+	/** \brief The table for an Object's Material.
+	 *
+	 * \param object The index of the Object.
+	 * \return The SpecularTable for its specularExponent.
+	 */
+	const SpecularTable& forObject(unsigned int object) const {
+		return tables_[tableOfObject_[object]];
+	}
+
+	/** \brief The distinct tables.
+	 *
+	 * \return One SpecularTable for each distinct specularExponent.
+	 */
+	const std::vector<SpecularTable>& tables() const {
+		return tables_;
+	}
+
+private:
+
+	std::vector<SpecularTable> tables_;       //!< One table per distinct exponent.
+	std::vector<unsigned int> tableOfObject_; //!< Index into tables_ for each Object.
+};
+
+#endif // FAST_MATH_H_INCLUDED
@@ -0,0 +1,61 @@
+#include "HugePages.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+	const size_t hugePageSize = size_t(2) << 20;
+	const size_t cacheLine = 64;
+
+	size_t roundUp(size_t bytes, size_t unit) {
+		return (bytes + unit - 1) / unit * unit;
+	}
+
+	bool useMapping(size_t bytes, HugePages mode) {
+#ifdef __linux__
+		return mode != HugePages::None && bytes >= hugePageSize;
+#else
+		return false;
+#endif
+	}
+
+}
+
+void* allocateLarge(size_t bytes, HugePages mode) {
+	if (bytes == 0) bytes = 1;
+#ifdef __linux__
+	if (useMapping(bytes, mode)) {
+		const size_t length = roundUp(bytes, hugePageSize);
+		void* block = MAP_FAILED;
+#ifdef MAP_HUGETLB
+		if (mode == HugePages::Explicit) {
+			block = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		}
+#endif
+		if (block == MAP_FAILED) {
+			// No reserved huge pages, so fall back to transparent ones
+			block = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (block == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+			madvise(block, length, MADV_HUGEPAGE);
+#endif
+		}
+		return block;
+	}
+#endif
+	return ::operator new(roundUp(bytes, cacheLine), std::align_val_t(cacheLine));
+}
+
+void freeLarge(void* block, size_t bytes, HugePages mode) {
+	if (!block) return;
+	if (bytes == 0) bytes = 1;
+#ifdef __linux__
+	if (useMapping(bytes, mode)) {
+		munmap(block, roundUp(bytes, hugePageSize));
+		return;
+	}
+#endif
+	::operator delete(block, std::align_val_t(cacheLine));
+}
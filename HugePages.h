@@ -0,0 +1,110 @@
+#pragma once
+
+#ifndef HUGE_PAGES_H_INCLUDED
+#define HUGE_PAGES_H_INCLUDED
+
+#include <cstddef>
+#include <new>
+
+/** \file
+ * \brief Huge page allocation header file.
+ */
+
+/** \brief Whether large arrays are backed by huge pages. */
+enum class HugePages {
+	None,        //!< Ordinary pages.
+	Transparent, //!< Ordinary memory, marked as suitable for transparent huge pages.
+	Explicit     //!< Memory from the reserved huge page pool, or Transparent if none is available.
+};
+
+/** \brief Allocate memory for a large array.
+ *
+ * Every block is aligned to a 64-byte cache line. Blocks of at least one huge page
+ * (2MB) are mapped directly from the operating system and, depending on the mode,
+ * backed by huge pages, which need far fewer TLB entries than ordinary 4kB pages.
+ * Smaller blocks, and all blocks on systems without huge pages, come from the heap.
+ *
+ * \param bytes The size of the block.
+ * \param mode How to back the block.
+ * \return The new block. std::bad_alloc is thrown if it cannot be allocated.
+ */
+void* allocateLarge(size_t bytes, HugePages mode);
+
+/** \brief Free memory from allocateLarge().
+ *
+ * \param block The block to free.
+ * \param bytes The size it was allocated with.
+ * \param mode The mode it was allocated with.
+ */
+void freeLarge(void* block, size_t bytes, HugePages mode);
+
+/**
+ * \brief Standard library allocator which uses allocateLarge().
+ *
+ * The HugePages mode is part of the allocator, so a container frees its memory
+ * the same way it was allocated.
+ *
+ * \tparam T The type of object to allocate.
+ */
+template <typename T>
+class LargeAllocator {
+
+public:
+
+	typedef T value_type; //!< The type of object allocated.
+
+	/** \brief LargeAllocator constructor.
+	 *
+	 * \param mode How to back the memory.
+	 */
+	explicit LargeAllocator(HugePages mode = HugePages::None) : mode(mode) {
+
+	}
+
+	/** \brief Converting constructor, as required by the standard library.
+	 *
+	 * \param other The allocator to copy the mode from.
+	 */
+	template <typename U>
+	LargeAllocator(const LargeAllocator<U>& other) : mode(other.mode) {
+
+	}
+
+	/** \brief Allocate space for some objects.
+	 *
+	 * \param count The number of objects.
+	 * \return The new (uninitialized) space.
+	 */
+	T* allocate(size_t count) {
+		return static_cast<T*>(allocateLarge(count * sizeof(T), mode));
+	}
+
+	/** \brief Free space from allocate().
+	 *
+	 * \param objects The space to free.
+	 * \param count The number of objects it was allocated for.
+	 */
+	void deallocate(T* objects, size_t count) {
+		freeLarge(objects, count * sizeof(T), mode);
+	}
+
+	HugePages mode; //!< How the memory is backed.
+};
+
+/** \brief LargeAllocators are interchangeable if they have the same mode.
+ * \relates LargeAllocator
+ */
+template <typename T, typename U>
+bool operator==(const LargeAllocator<T>& lhs, const LargeAllocator<U>& rhs) {
+	return lhs.mode == rhs.mode;
+}
+
+/** \brief LargeAllocators are interchangeable if they have the same mode.
+ * \relates LargeAllocator
+ */
+template <typename T, typename U>
+bool operator!=(const LargeAllocator<T>& lhs, const LargeAllocator<U>& rhs) {
+	return lhs.mode != rhs.mode;
+}
+
+#endif // HUGE_PAGES_H_INCLUDED
@@ -1,10 +1,23 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "ImageDisplay.h"
 
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+
+namespace {
+
+	const size_t runLength = 64; // Pixels tone mapped at once when scattering a row into MortonTiles
+
+}
 
 ImageDisplay::ImageDisplay(const std::string& windowName, unsigned int width, unsigned int height) :
-	image_(3 * width*height, 0), width_(width), height_(height), lastRowWritten_(0)
+	image_(3 * width*height, 0), radiance_(3 * size_t(width)*height, 0.0f), rowMajorImage_(), rowMajorRadiance_(), features_(), 
+	mapper_(new ToneMapper(ToneMapping())), width_(width), height_(height), layout_(FramebufferLayout::RowMajor), tilesX_((size_t(width) + 15) / 16)
 {
 
 }
@@ -12,19 +25,221 @@ ImageDisplay::ImageDisplay(const std::string& windowName, unsigned int width, un
 ImageDisplay::~ImageDisplay() {
 }
 
+void ImageDisplay::resize(unsigned int width, unsigned int height) {
+	size_t pixels = size_t(width)*height;
+	tilesX_ = (size_t(width) + 15) / 16;
+	if (layout_ == FramebufferLayout::MortonTiles) {
+		// Partial tiles at the right and bottom edges are stored in full
+		pixels = tilesX_ * ((size_t(height) + 15) / 16) * 256;
+	}
+	image_.assign(3 * pixels, 0);
+	radiance_.assign(3 * pixels, 0.0f);
+	features_.clear();
+	width_ = width;
+	height_ = height;
+}
+
+void ImageDisplay::setLayout(FramebufferLayout layout) {
+	layout_ = layout;
+	resize((unsigned int)width_, (unsigned int)height_);
+}
+
 void ImageDisplay::set(int x, int y, const Colour& colour) {
-	image_[3*width_*y + 3*x + 0] = (unsigned char)(255 * colour.red);
-	image_[3*width_*y + 3*x + 1] = (unsigned char)(255 * colour.green);
-	image_[3*width_*y + 3*x + 2] = (unsigned char)(255 * colour.blue);
-	lastRowWritten_ = y;
+	setRow(x, y, &colour, 1);
+}
+
+void ImageDisplay::setRow(int x, int y, const Colour* colours, size_t count) {
+	if (layout_ == FramebufferLayout::MortonTiles) {
+		float radiance[3*runLength];
+		for (size_t start = 0; start < count; start += runLength) {
+			const size_t run = std::min(runLength, count - start);
+			for (size_t i = 0; i < run; ++i) {
+				radiance[3*i + 0] = float(colours[start + i].red);
+				radiance[3*i + 1] = float(colours[start + i].green);
+				radiance[3*i + 2] = float(colours[start + i].blue);
+			}
+			setRow(int(x + start), y, radiance, run);
+		}
+		return;
+	}
+	const size_t ix = 3*(width_*y + x);
+	float* radiance = &radiance_[ix];
+	for (size_t i = 0; i < count; ++i) {
+		radiance[3*i + 0] = float(colours[i].red);
+		radiance[3*i + 1] = float(colours[i].green);
+		radiance[3*i + 2] = float(colours[i].blue);
+	}
+	mapper_->apply(radiance, &image_[ix], 3*count, x, y);
+}
+
+void ImageDisplay::setRow(int x, int y, const float* radiance, size_t count) {
+	if (layout_ == FramebufferLayout::MortonTiles) {
+		// Tone map the row as it is, then scatter it into the tiles
+		unsigned char pixels[3*runLength];
+		for (size_t start = 0; start < count; start += runLength) {
+			const size_t run = std::min(runLength, count - start);
+			mapper_->apply(radiance + 3*start, pixels, 3*run, x + start, y);
+			for (size_t i = 0; i < run; ++i) {
+				const size_t ix = 3*pixelIndex(x + start + i, y);
+				std::copy(radiance + 3*(start + i), radiance + 3*(start + i + 1), &radiance_[ix]);
+				std::copy(pixels + 3*i, pixels + 3*(i + 1), &image_[ix]);
+			}
+		}
+		return;
+	}
+	const size_t ix = 3*(width_*y + x);
+	std::copy(radiance, radiance + 3*count, &radiance_[ix]);
+	mapper_->apply(&radiance_[ix], &image_[ix], 3*count, x, y);
+}
+
+void ImageDisplay::setTile(int x, int y, size_t width, size_t height, const Colour* colours) {
+	for (size_t row = 0; row < height; ++row) {
+		setRow(x, int(y + row), colours + row*width, width);
+	}
+}
+
+void ImageDisplay::setTile(int x, int y, size_t width, size_t height, const float* radiance) {
+	for (size_t row = 0; row < height; ++row) {
+		setRow(x, int(y + row), radiance + 3*row*width, width);
+	}
+}
+
+void ImageDisplay::setToneMapping(const ToneMapping& toneMapping) {
+	mapper_.reset(new ToneMapper(toneMapping));
+}
+
+void ImageDisplay::enableFeatures() {
+	const PixelFeatures background = { { 0, 0, 0 }, 0, -1 };
+	features_.assign(width_*height_, background);
+}
+
+void ImageDisplay::setFeatures(int x, int y, const PixelFeatures& features) {
+	features_[width_*y + x] = features;
+}
+
+void ImageDisplay::denoise(const Denoiser& denoiser, ThreadPool* pool) {
+	if (features_.empty()) return;
+	TRACE_SCOPE("image", "denoise");
+	std::vector<float> filtered;
+	if (layout_ == FramebufferLayout::MortonTiles) {
+		toRowMajor(radiance_, rowMajorRadiance_);
+		denoiser.apply(rowMajorRadiance_, features_, width_, height_, filtered, pool);
+		fromRowMajor(filtered, radiance_);
+		return;
+	}
+	denoiser.apply(radiance_, features_, width_, height_, filtered, pool);
+	radiance_.swap(filtered);
+}
+
+void ImageDisplay::toneMap(const ToneMapping& toneMapping, ThreadPool* pool) {
+	TRACE_SCOPE("image", "tone map");
+	const ToneMapper mapper(toneMapping);
+	const size_t rowValues = 3 * width_;
+	const size_t rowsPerBand = std::max<size_t>(1, 65536 / std::max<size_t>(1, rowValues));
+	const size_t numBands = (height_ + rowsPerBand - 1) / rowsPerBand;
+	auto mapBand = [&](size_t band, unsigned int) {
+		// Rows are mapped one at a time, so that dithering knows where each pixel is
+		std::vector<float> rowRadiance;
+		std::vector<unsigned char> rowPixels;
+		for (size_t y = band * rowsPerBand; y < std::min(height_, (band + 1) * rowsPerBand); ++y) {
+			if (layout_ == FramebufferLayout::RowMajor) {
+				mapper.apply(&radiance_[y * rowValues], &image_[y * rowValues], rowValues, 0, y);
+				continue;
+			}
+			rowRadiance.resize(rowValues);
+			rowPixels.resize(rowValues);
+			for (size_t x = 0; x < width_; ++x) {
+				std::copy(&radiance_[3*pixelIndex(x, y)], &radiance_[3*pixelIndex(x, y)] + 3, &rowRadiance[3*x]);
+			}
+			mapper.apply(rowRadiance.data(), rowPixels.data(), rowValues, 0, y);
+			for (size_t x = 0; x < width_; ++x) {
+				std::copy(&rowPixels[3*x], &rowPixels[3*x] + 3, &image_[3*pixelIndex(x, y)]);
+			}
+		}
+	};
+	if (pool) {
+		pool->parallelFor(numBands, mapBand);
+	} else {
+		for (size_t band = 0; band < numBands; ++band) mapBand(band, 0);
+	}
+}
+
+bool ImageDisplay::loadPFM(const std::string& filename) {
+	std::ifstream fin(filename, std::ios::binary);
+	if (!fin) return false;
+	const std::vector<unsigned char> file((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+	std::vector<float> radiance;
+	size_t width, height;
+	if (!decodePFM(file, radiance, width, height)) return false;
+	resize((unsigned int)width, (unsigned int)height);
+	if (layout_ == FramebufferLayout::MortonTiles) {
+		fromRowMajor(radiance, radiance_);
+	} else {
+		radiance_.swap(radiance);
+	}
+	toneMap(ToneMapping());
+	return true;
+}
+
+bool ImageDisplay::save(const std::string& filename, ThreadPool* pool) const {
+	TRACE_SCOPE("image", "ImageDisplay::save");
+	const ImageFormat format = imageFormatForFile(filename);
+	const std::string error = imageSizeError(format, width_, height_);
+	if (!error.empty()) {
+		std::cerr << "Could not save image to " << filename << ": " << error << std::endl;
+		return false;
+	}
+	std::vector<unsigned char> file;
+	encode(format, file, pool);
+	TRACE_SCOPE("image", "write file");
+	std::ofstream fout(filename, std::ios::binary);
+	fout.write(reinterpret_cast<const char*>(file.data()), std::streamsize(file.size()));
+	if (!fout) {
+		std::cerr << "Could not save image to " << filename << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool ImageDisplay::encode(ImageFormat format, std::vector<unsigned char>& file, ThreadPool* pool) const {
+	TRACE_SCOPE("image", "encode");
+	if (format == ImageFormat::PFM) {
+		return encodePFM(getRadiance().data(), width_, height_, file);
+	}
+	return encodeImage(format, getPixels().data(), width_, height_, file, pool);
+}
+
+const std::vector<unsigned char>& ImageDisplay::getPixels() const {
+	if (layout_ == FramebufferLayout::RowMajor) return image_;
+	toRowMajor(image_, rowMajorImage_);
+	return rowMajorImage_;
+}
+
+const std::vector<float>& ImageDisplay::getRadiance() const {
+	if (layout_ == FramebufferLayout::RowMajor) return radiance_;
+	toRowMajor(radiance_, rowMajorRadiance_);
+	return rowMajorRadiance_;
 }
 
-void ImageDisplay::refresh() {
-	std::cout << "Rendered row " << lastRowWritten_ << " of " << height_ << "\r";
+template <typename T>
+void ImageDisplay::toRowMajor(const std::vector<T>& stored, std::vector<T>& rowMajor) const {
+	rowMajor.resize(3 * width_*height_);
+	for (size_t y = 0; y < height_; ++y) {
+		for (size_t x = 0; x < width_; ++x) {
+			const size_t ix = 3*pixelIndex(x, y);
+			std::copy(&stored[ix], &stored[ix] + 3, &rowMajor[3*(width_*y + x)]);
+		}
+	}
 }
 
-void ImageDisplay::save(const std::string& filename) const {
-	stbi_write_png(filename.c_str(), int(width_), int(height_), 3, &image_[0], 3 * int(width_));
+template <typename T>
+void ImageDisplay::fromRowMajor(const std::vector<T>& rowMajor, std::vector<T>& stored) const {
+	for (size_t y = 0; y < height_; ++y) {
+		for (size_t x = 0; x < width_; ++x) {
+			const size_t ix = 3*pixelIndex(x, y);
+			std::copy(&rowMajor[3*(width_*y + x)], &rowMajor[3*(width_*y + x)] + 3, &stored[ix]);
+		}
+	}
 }
 
 void ImageDisplay::pause(double seconds) {
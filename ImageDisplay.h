@@ -4,9 +4,14 @@
 #define IMAGE_DISPLAY_H_INCLUDED
 
 #include "Colour.h"
+#include "Denoiser.h"
+#include "ImageEncoder.h"
 #include "NonCopyable.h"
+#include "TileOrder.h"
+#include "ToneMapping.h"
 
 #include "stb_image_write.h"
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -15,6 +20,14 @@
  * \brief Display class header file.
  */
 
+/**
+ * \brief How the pixels of an ImageDisplay are arranged in memory.
+ */
+enum class FramebufferLayout {
+	RowMajor,   //!< Row by row, as the pixels are saved.
+	MortonTiles //!< In 16x16 tiles, row by row, with the pixels of each tile in Morton order.
+};
+
 /**
  * \brief Class to display and save images.
  *
@@ -23,6 +36,15 @@
  * functions that provides an abstraction that gives just enough functionality
  * for the Ray Tracer.
  *
+ * As well as the 8-bit image, an ImageDisplay keeps the linear Colour of every pixel
+ * in a float framebuffer. This can be saved as a PFM file, or tone mapped again with
+ * different settings, without rendering the image again.
+ *
+ * Both images are normally stored row by row. With FramebufferLayout::MortonTiles
+ * they are stored in tiles which match the tiles a Scene renders, so each tile is
+ * written to one contiguous block, and nearby pixels in both directions share cache 
+ * lines. The pixels are only rearranged row by row when they are read or saved.
+ *
  * Note that ImageDisplay is NonCopyable, so does not have a copy constructor or
  * assingment operator available. You can, however, create multiple displays.
  */
@@ -51,6 +73,44 @@ public:
 	 */
 	~ImageDisplay();
 
+	/**
+	 * \brief Change the size of the image.
+	 *
+	 * The image is cleared to black. The storage for the image is kept, so 
+	 * resizing to the same size or smaller does not allocate any memory.
+	 *
+	 * \param width The new width, in pixels, of the image.
+	 * \param height The new height, in pixels, of the image.
+	 */
+	void resize(unsigned int width, unsigned int height);
+
+	/**
+	 * \brief Change how the pixels are arranged in memory.
+	 *
+	 * The image is cleared to black, as by resize().
+	 *
+	 * \param layout The new FramebufferLayout.
+	 */
+	void setLayout(FramebufferLayout layout);
+
+	/**
+	 * \brief How the pixels are arranged in memory.
+	 *
+	 * \return The current FramebufferLayout.
+	 */
+	FramebufferLayout layout() const { return layout_; }
+
+	/** \brief Where a pixel is stored, in the current FramebufferLayout.
+	 *
+	 * \param x The x co-ordinate of the pixel.
+	 * \param y The y co-ordinate of the pixel.
+	 * \return The index of the pixel (so its values start at 3 times this).
+	 */
+	size_t pixelIndex(size_t x, size_t y) const {
+		if (layout_ == FramebufferLayout::RowMajor) return width_*y + x;
+		return ((y >> 4)*tilesX_ + (x >> 4))*256 + mortonCode(uint16_t(x & 15), uint16_t(y & 15));
+	}
+
 	/**
 	 * \brief Set a pixel value.
 	 *
@@ -58,8 +118,12 @@ public:
 	 * in the top-left corner, with the x-axis running left to right and the 
 	 * y-axis running top to bottom.
 	 *
-	 * Note that this updates the <em>internal</em> image, but not the display
-	 * shown in the window. To update the window call refresh().
+	 * The Colour is stored as it is in the float framebuffer, and tone mapped for the
+	 * 8-bit image with the settings given to setToneMapping() (by default it is simply
+	 * clamped to [0,1] and quantized). Call toneMap() to make the 8-bit image from the 
+	 * float framebuffer with other settings.
+	 *
+	 * Setting many pixels with setRow() or setTile() is quicker.
 	 *
 	 * \param x The x co-ordinate of the pixel to set.
 	 * \param y The y co-ordinate of the pixel to set.
@@ -68,24 +132,177 @@ public:
 	void set(int x, int y, const Colour& colour);
 
 	/**
-	 * \brief Update the window displaying the image.
-	 * 
-	 * The window displaying the image is not automatically updated when the 
-	 * image changes for efficiency reasons. Calling refresh() causes the 
-	 * current image to be displayed.
+	 * \brief Set a run of pixels in one row.
+	 *
+	 * The pixels are stored and tone mapped as by set(), but the whole run is tone mapped
+	 * at once, so the conversion is vectorized and the per-pixel overheads of set() are avoided.
+	 *
+	 * \param x The x co-ordinate of the first pixel to set.
+	 * \param y The y co-ordinate of the pixels to set.
+	 * \param colours The Colours to set, from left to right.
+	 * \param count The number of pixels to set.
+	 */
+	void setRow(int x, int y, const Colour* colours, size_t count);
+
+	/**
+	 * \brief Set a run of pixels in one row from linear float values.
+	 *
+	 * \param x The x co-ordinate of the first pixel to set.
+	 * \param y The y co-ordinate of the pixels to set.
+	 * \param radiance Three floats (red, green, blue) for each pixel, from left to right.
+	 * \param count The number of pixels to set.
+	 * \sa setRow(int, int, const Colour*, size_t)
 	 */
-	void refresh();
-	
+	void setRow(int x, int y, const float* radiance, size_t count);
+
+	/**
+	 * \brief Set a rectangle of pixels.
+	 *
+	 * \param x The x co-ordinate of the top-left pixel to set.
+	 * \param y The y co-ordinate of the top-left pixel to set.
+	 * \param width The width of the rectangle in pixels.
+	 * \param height The height of the rectangle in pixels.
+	 * \param colours The Colours to set, row by row.
+	 * \sa setRow(int, int, const Colour*, size_t)
+	 */
+	void setTile(int x, int y, size_t width, size_t height, const Colour* colours);
+
+	/**
+	 * \brief Set a rectangle of pixels from linear float values.
+	 *
+	 * \param x The x co-ordinate of the top-left pixel to set.
+	 * \param y The y co-ordinate of the top-left pixel to set.
+	 * \param width The width of the rectangle in pixels.
+	 * \param height The height of the rectangle in pixels.
+	 * \param radiance Three floats (red, green, blue) for each pixel, row by row.
+	 * \sa setRow(int, int, const Colour*, size_t)
+	 */
+	void setTile(int x, int y, size_t width, size_t height, const float* radiance);
+
+	/**
+	 * \brief Choose how pixels are tone mapped as they are set.
+	 *
+	 * This does not change pixels that have already been set.
+	 *
+	 * \param toneMapping The settings to make 8-bit pixel values with.
+	 */
+	void setToneMapping(const ToneMapping& toneMapping);
+
+	/**
+	 * \brief Keep PixelFeatures for each pixel, for the Denoiser.
+	 *
+	 * Until this is called (or after a resize()) an ImageDisplay does not store any 
+	 * PixelFeatures, and setFeatures() should not be called. Every pixel starts as 
+	 * background, with no Object.
+	 */
+	void enableFeatures();
+
+	/**
+	 * \brief Whether PixelFeatures are kept for each pixel.
+	 *
+	 * \return true if enableFeatures() has been called since the image was last resized.
+	 */
+	bool hasFeatures() const { return !features_.empty(); }
+
+	/**
+	 * \brief Set the PixelFeatures of a pixel.
+	 *
+	 * \param x The x co-ordinate of the pixel to set.
+	 * \param y The y co-ordinate of the pixel to set.
+	 * \param features What the primary Ray through (x,y) hit.
+	 */
+	void setFeatures(int x, int y, const PixelFeatures& features);
+
+	/**
+	 * \brief Filter noise out of the float framebuffer.
+	 *
+	 * The 8-bit image is not changed, so call toneMap() afterwards. If no PixelFeatures
+	 * are kept, the image is left as it is.
+	 *
+	 * \param denoiser The Denoiser to filter with.
+	 * \param pool The ThreadPool to filter with, or \c nullptr to filter on the calling thread.
+	 */
+	void denoise(const Denoiser& denoiser, ThreadPool* pool = nullptr);
+
+	/**
+	 * \brief Remake the 8-bit image from the float framebuffer.
+	 *
+	 * This is much faster than rendering again, so an image can be re-exposed or re-graded
+	 * after it is finished.
+	 *
+	 * \param toneMapping The settings to make 8-bit pixel values with.
+	 * \param pool The ThreadPool to tone map with, or \c nullptr to tone map on the calling thread.
+	 */
+	void toneMap(const ToneMapping& toneMapping, ThreadPool* pool = nullptr);
+
+	/**
+	 * \brief Load the float framebuffer from a PFM file.
+	 *
+	 * The image is resized to match the file, and the 8-bit image is made with the
+	 * default ToneMapping.
+	 *
+	 * \param filename The PFM file to read.
+	 * \return true if the file was read, false if it could not be read or is not a colour PFM file.
+	 */
+	bool loadPFM(const std::string& filename);
+
 	/**
 	 * \brief Save an image to file.
 	 *
 	 * Images can be saved to files, and the image format is determined by
-	 * the file extension. For example, saving to \c render.png would write a 
-	 * PNG image, while saving to \c RENDER.JPG would write a JPEG.
+	 * the file extension (see imageFormatForFile()). For example, saving to 
+	 * \c render.png would write a PNG image, while saving to \c RENDER.QOI would 
+	 * write a QOI image. PFM files are written from the float framebuffer.
 	 *
 	 * \param filename The file to save to, with an appropriate extension.
+	 * \param pool The ThreadPool to encode the image with, or \c nullptr to encode on the calling thread.
+	 * \return true if the file was written, false if the format cannot hold an image of this
+	 *         size (see imageSizeError()) or the file could not be written (either of which is
+	 *         also reported on \c std::cerr).
+	 */
+	bool save(const std::string& filename, ThreadPool* pool = nullptr) const;
+
+	/**
+	 * \brief Encode the image as a file in memory.
+	 *
+	 * \param format The format to encode the image in.
+	 * \param file Vector to hold the encoded file. Any existing contents are replaced.
+	 * \param pool The ThreadPool to encode the image with, or \c nullptr to encode on the calling thread.
+	 * \return true if the image was encoded, false if the format cannot hold an image of this size.
+	 */
+	bool encode(ImageFormat format, std::vector<unsigned char>& file, ThreadPool* pool = nullptr) const;
+
+	/**
+	 * \brief Access the raw image data.
+	 *
+	 * The image is stored row by row, with three bytes (red, green, blue) per pixel.
+	 * With FramebufferLayout::MortonTiles this is a copy, made when it is called.
+	 *
+	 * \return The image data.
+	 */
+	const std::vector<unsigned char>& getPixels() const;
+
+	/**
+	 * \brief Access the float framebuffer.
+	 *
+	 * The image is stored row by row, with three floats (linear red, green, blue) per pixel.
+	 * With FramebufferLayout::MortonTiles this is a copy, made when it is called.
+	 *
+	 * \return The float framebuffer.
 	 */
-	void save(const std::string& filename) const;
+	const std::vector<float>& getRadiance() const;
+
+	/** \brief The width of the image.
+	 *
+	 * \return The width of the image in pixels.
+	 */
+	size_t width() const { return width_; }
+
+	/** \brief The height of the image.
+	 *
+	 * \return The height of the image in pixels.
+	 */
+	size_t height() const { return height_; }
 	
 	/**
 	 * \brief Wait for a specified duration.
@@ -98,10 +315,32 @@ public:
 
 private:
 
+	/** \brief Copy the values of some pixels from the stored layout to row by row order.
+	 *
+	 * \param stored Three values per pixel, in the stored layout.
+	 * \param rowMajor Filled with three values per pixel, row by row.
+	 */
+	template <typename T>
+	void toRowMajor(const std::vector<T>& stored, std::vector<T>& rowMajor) const;
+
+	/** \brief Copy the values of some pixels from row by row order to the stored layout.
+	 *
+	 * \param rowMajor Three values per pixel, row by row.
+	 * \param stored Filled with three values per pixel, in the stored layout.
+	 */
+	template <typename T>
+	void fromRowMajor(const std::vector<T>& rowMajor, std::vector<T>& stored) const;
+
 	std::vector<unsigned char> image_; //!< Internal storage of the image to render to.
+	std::vector<float> radiance_; //!< Linear Colour of each pixel, before quantization.
+	mutable std::vector<unsigned char> rowMajorImage_; //!< Copy of image_ row by row, for FramebufferLayout::MortonTiles.
+	mutable std::vector<float> rowMajorRadiance_; //!< Copy of radiance_ row by row, for FramebufferLayout::MortonTiles.
+	std::vector<PixelFeatures> features_; //!< What each pixel shows, for denoising, or empty if not kept.
+	std::unique_ptr<ToneMapper> mapper_; //!< Makes 8-bit pixel values as pixels are set.
 	size_t width_; //!< Width of the image.
 	size_t height_; //!< Height of the image.
-	size_t lastRowWritten_; //!< Last row rendered, for the purpose of progress reporting
+	FramebufferLayout layout_; //!< How image_ and radiance_ are arranged.
+	size_t tilesX_; //!< Number of columns of tiles, for FramebufferLayout::MortonTiles.
 };
 
 #endif
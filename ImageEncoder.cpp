@@ -0,0 +1,649 @@
+#include "ImageEncoder.h"
+
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "stb_image_write.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+
+namespace {
+
+	const size_t pngBandBytes = 128 << 10; // Filtered image data in each independently compressed PNG band
+	const size_t lz77Window = 32768;       // Furthest back a deflate match can refer to
+	const unsigned int lz77MaxChain = 32;  // Most earlier positions to try for each match
+	const unsigned int lz77HashBits = 15;  // log2 of the number of hash chains
+
+	/** \brief Append a 32-bit value, most significant byte first. */
+	void putBigEndian32(std::vector<unsigned char>& out, uint32_t value) {
+		out.push_back((unsigned char)(value >> 24));
+		out.push_back((unsigned char)(value >> 16));
+		out.push_back((unsigned char)(value >> 8));
+		out.push_back((unsigned char)value);
+	}
+
+	/** \brief Append a 16-bit value, least significant byte first. */
+	void putLittleEndian16(std::vector<unsigned char>& out, size_t value) {
+		out.push_back((unsigned char)value);
+		out.push_back((unsigned char)(value >> 8));
+	}
+
+	/** \brief CRC-32 (as used by PNG chunks) of some data. */
+	uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0) {
+		static const std::array<uint32_t, 256> table = []() {
+			std::array<uint32_t, 256> t;
+			for (uint32_t n = 0; n < 256; ++n) {
+				uint32_t c = n;
+				for (int k = 0; k < 8; ++k) {
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				t[n] = c;
+			}
+			return t;
+		}();
+		crc = ~crc;
+		for (size_t i = 0; i < size; ++i) {
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return ~crc;
+	}
+
+	/** \brief Adler-32 (as used by zlib streams) of some data. */
+	uint32_t adler32(const unsigned char* data, size_t size) {
+		const uint32_t base = 65521;
+		uint32_t a = 1, b = 0;
+		while (size > 0) {
+			// 5552 is the most bytes that can be summed before b could overflow
+			const size_t block = std::min<size_t>(size, 5552);
+			for (size_t i = 0; i < block; ++i) {
+				a += data[i];
+				b += a;
+			}
+			a %= base;
+			b %= base;
+			data += block;
+			size -= block;
+		}
+		return (b << 16) | a;
+	}
+
+	/** \brief The Adler-32 of two pieces of data joined together, from the Adler-32 of each piece. */
+	uint32_t adler32Combine(uint32_t adler1, uint32_t adler2, size_t size2) {
+		const uint64_t base = 65521;
+		const uint64_t rem = size2 % base;
+		const uint64_t a = ((adler1 & 0xFFFF) + (adler2 & 0xFFFF) + base - 1) % base;
+		const uint64_t b = (rem * (adler1 & 0xFFFF) + (adler1 >> 16) + (adler2 >> 16) + base - rem) % base;
+		return uint32_t((b << 16) | a);
+	}
+
+	/** \brief Writes a stream of bits, least significant first, as deflate requires. */
+	class BitWriter {
+	public:
+		explicit BitWriter(std::vector<unsigned char>& out) : out_(out), bits_(0), count_(0) {}
+
+		/** \brief Write the lowest \c count bits of \c value (at most 16). */
+		void put(uint32_t value, unsigned int count) {
+			bits_ |= value << count_;
+			count_ += count;
+			while (count_ >= 8) {
+				out_.push_back((unsigned char)bits_);
+				bits_ >>= 8;
+				count_ -= 8;
+			}
+		}
+
+		/** \brief Pad with zero bits to the end of the current byte. */
+		void flush() {
+			if (count_ > 0) out_.push_back((unsigned char)bits_);
+			bits_ = 0;
+			count_ = 0;
+		}
+
+	private:
+		std::vector<unsigned char>& out_;
+		uint32_t bits_;
+		unsigned int count_;
+	};
+
+	/** \brief The fixed Huffman codes of deflate (RFC 1951, section 3.2.6), bit-reversed ready for a BitWriter. */
+	struct FixedCodes {
+		std::array<uint16_t, 288> literalCode; //!< Code for each literal/length symbol.
+		std::array<uint8_t, 288> literalBits;  //!< Length of each literal/length code.
+		std::array<uint16_t, 30> distanceCode; //!< Code for each distance symbol (all are 5 bits).
+		std::array<uint8_t, 259> lengthIndex;  //!< Length symbol (less 257) for each match length.
+		std::vector<uint8_t> distanceIndex;    //!< Distance symbol for each match distance.
+
+		static const uint16_t lengthBase[29];
+		static const uint8_t lengthExtra[29];
+		static const uint16_t distanceBase[30];
+		static const uint8_t distanceExtra[30];
+
+		FixedCodes() : distanceIndex(lz77Window + 1) {
+			for (unsigned int symbol = 0; symbol < 288; ++symbol) {
+				unsigned int code, bits;
+				if (symbol < 144) {
+					code = 0x30 + symbol; bits = 8;
+				} else if (symbol < 256) {
+					code = 0x190 + symbol - 144; bits = 9;
+				} else if (symbol < 280) {
+					code = symbol - 256; bits = 7;
+				} else {
+					code = 0xC0 + symbol - 280; bits = 8;
+				}
+				literalCode[symbol] = reverse(code, bits);
+				literalBits[symbol] = (uint8_t)bits;
+			}
+			for (unsigned int symbol = 0; symbol < 30; ++symbol) {
+				distanceCode[symbol] = reverse(symbol, 5);
+			}
+			// Symbol 28 is the only code for 258, so must overwrite the range of symbol 27
+			for (unsigned int ix = 0; ix < 29; ++ix) {
+				for (unsigned int length = lengthBase[ix]; length < lengthBase[ix] + (1u << lengthExtra[ix]) && length <= 258; ++length) {
+					lengthIndex[length] = (uint8_t)ix;
+				}
+			}
+			for (unsigned int ix = 0; ix < 30; ++ix) {
+				for (unsigned int distance = distanceBase[ix]; distance < distanceBase[ix] + (1u << distanceExtra[ix]) && distance <= lz77Window; ++distance) {
+					distanceIndex[distance] = (uint8_t)ix;
+				}
+			}
+		}
+
+		static uint16_t reverse(unsigned int code, unsigned int bits) {
+			unsigned int result = 0;
+			for (unsigned int i = 0; i < bits; ++i) {
+				result = (result << 1) | ((code >> i) & 1);
+			}
+			return (uint16_t)result;
+		}
+	};
+
+	const uint16_t FixedCodes::lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	                                              35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t FixedCodes::lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	                                              3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t FixedCodes::distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	                                                257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t FixedCodes::distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	                                                7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	const FixedCodes& fixedCodes() {
+		static const FixedCodes codes;
+		return codes;
+	}
+
+	/**
+	 * \brief Compress data as a single fixed-Huffman deflate block.
+	 *
+	 * Matches are found with hash chains, as in stb_image_write. Unless \c last is set the
+	 * block is followed by an empty stored block, which ends the output on a byte boundary
+	 * so that another block can be appended.
+	 */
+	void deflateBlock(const unsigned char* data, size_t size, bool last, std::vector<unsigned char>& out) {
+		const FixedCodes& codes = fixedCodes();
+		BitWriter writer(out);
+		writer.put(last ? 1 : 0, 1); // BFINAL
+		writer.put(1, 2);            // BTYPE = fixed Huffman codes
+
+		std::vector<int32_t> head(size_t(1) << lz77HashBits, -1);
+		std::vector<int32_t> previous(size);
+		auto hashAt = [data](size_t i) {
+			const uint32_t v = uint32_t(data[i]) | uint32_t(data[i+1]) << 8 | uint32_t(data[i+2]) << 16;
+			return (v * 2654435761u) >> (32 - lz77HashBits);
+		};
+		auto insert = [&](size_t i) {
+			const uint32_t hash = hashAt(i);
+			previous[i] = head[hash];
+			head[hash] = int32_t(i);
+		};
+
+		size_t i = 0;
+		while (i < size) {
+			size_t bestLength = 0;
+			size_t bestDistance = 0;
+			if (i + 3 <= size) {
+				const size_t maxLength = std::min<size_t>(258, size - i);
+				unsigned int chain = 0;
+				for (int32_t j = head[hashAt(i)]; j >= 0 && i - size_t(j) <= lz77Window && chain < lz77MaxChain; j = previous[j], ++chain) {
+					// Only a longer match is any use, so check where it would have to differ first
+					if (data[j + bestLength] != data[i + bestLength]) continue;
+					size_t length = 0;
+					while (length < maxLength && data[j + length] == data[i + length]) ++length;
+					if (length > bestLength) {
+						bestLength = length;
+						bestDistance = i - size_t(j);
+						if (length == maxLength) break;
+					}
+				}
+				insert(i);
+			}
+
+			if (bestLength >= 3) {
+				const unsigned int lengthIx = codes.lengthIndex[bestLength];
+				const unsigned int lengthSymbol = 257 + lengthIx;
+				writer.put(codes.literalCode[lengthSymbol], codes.literalBits[lengthSymbol]);
+				writer.put(uint32_t(bestLength - FixedCodes::lengthBase[lengthIx]), FixedCodes::lengthExtra[lengthIx]);
+				const unsigned int distanceIx = codes.distanceIndex[bestDistance];
+				writer.put(codes.distanceCode[distanceIx], 5);
+				writer.put(uint32_t(bestDistance - FixedCodes::distanceBase[distanceIx]), FixedCodes::distanceExtra[distanceIx]);
+				for (size_t k = i + 1; k < i + bestLength && k + 3 <= size; ++k) {
+					insert(k);
+				}
+				i += bestLength;
+			} else {
+				writer.put(codes.literalCode[data[i]], codes.literalBits[data[i]]);
+				++i;
+			}
+		}
+		writer.put(codes.literalCode[256], codes.literalBits[256]); // End of block
+
+		if (!last) {
+			// An empty stored block: BFINAL = 0, BTYPE = 0, pad to a byte, LEN = 0, NLEN = ~0
+			writer.put(0, 3);
+			writer.flush();
+			out.push_back(0x00);
+			out.push_back(0x00);
+			out.push_back(0xFF);
+			out.push_back(0xFF);
+		} else {
+			writer.flush();
+		}
+	}
+
+	/** \brief Apply the PNG filter which (by the usual heuristic) is likely to compress a row best. */
+	void filterRow(const unsigned char* row, const unsigned char* above, size_t rowBytes, unsigned char* out) {
+		std::vector<unsigned char> candidate(rowBytes);
+		unsigned long bestScore = ~0ul;
+		for (unsigned char filter = 0; filter < 5; ++filter) {
+			unsigned long score = 0;
+			for (size_t i = 0; i < rowBytes; ++i) {
+				const int a = i >= 3 ? row[i - 3] : 0;
+				const int b = above ? above[i] : 0;
+				const int c = (above && i >= 3) ? above[i - 3] : 0;
+				int predicted = 0;
+				switch (filter) {
+					case 1: predicted = a; break;
+					case 2: predicted = b; break;
+					case 3: predicted = (a + b) / 2; break;
+					case 4: {
+						const int p = a + b - c;
+						const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+						predicted = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+						break;
+					}
+				}
+				candidate[i] = (unsigned char)(row[i] - predicted);
+				score += (unsigned long)std::abs((int)(signed char)candidate[i]);
+			}
+			if (score < bestScore) {
+				bestScore = score;
+				out[0] = filter;
+				std::memcpy(out + 1, candidate.data(), rowBytes);
+			}
+		}
+	}
+
+	/** \brief Append a PNG chunk. */
+	void putChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t size) {
+		putBigEndian32(out, uint32_t(size));
+		const size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data, data + size);
+		putBigEndian32(out, crc32(&out[start], size + 4));
+	}
+
+	/** \brief Run a task for each of \c count items, on a ThreadPool if there is one. */
+	void forEach(size_t count, ThreadPool* pool, const ThreadPool::Task& task) {
+		const ThreadPool::Task tracedTask = [&](size_t i, unsigned int worker) {
+			TRACE_SCOPE_XY("image", "encode part", "part", i, "parts", count);
+			task(i, worker);
+		};
+		if (pool) {
+			pool->parallelFor(count, tracedTask);
+		} else {
+			for (size_t i = 0; i < count; ++i) tracedTask(i, 0);
+		}
+	}
+
+	void encodePNG(const unsigned char* pixels, size_t width, size_t height, std::vector<unsigned char>& file, ThreadPool* pool) {
+		const size_t rowBytes = 3 * width;
+		const size_t rowsPerBand = std::max<size_t>(1, pngBandBytes / (rowBytes + 1));
+		const size_t numBands = (height + rowsPerBand - 1) / rowsPerBand;
+
+		// Each band is filtered, compressed, and wrapped in its own IDAT chunk independently
+		struct Band {
+			std::vector<unsigned char> chunk;
+			uint32_t adler;
+			size_t size;
+		};
+		std::vector<Band> bands(numBands);
+		forEach(numBands, pool, [&](size_t b, unsigned int) {
+			const size_t firstRow = b * rowsPerBand;
+			const size_t endRow = std::min(height, firstRow + rowsPerBand);
+			std::vector<unsigned char> filtered((endRow - firstRow) * (rowBytes + 1));
+			for (size_t y = firstRow; y < endRow; ++y) {
+				filterRow(pixels + y*rowBytes, y > 0 ? pixels + (y - 1)*rowBytes : nullptr, rowBytes, &filtered[(y - firstRow)*(rowBytes + 1)]);
+			}
+			std::vector<unsigned char> compressed;
+			if (b == 0) {
+				// zlib header: deflate with a 32K window, no preset dictionary
+				compressed.push_back(0x78);
+				compressed.push_back(0x01);
+			}
+			deflateBlock(filtered.data(), filtered.size(), b + 1 == numBands, compressed);
+			putChunk(bands[b].chunk, "IDAT", compressed.data(), compressed.size());
+			bands[b].adler = adler32(filtered.data(), filtered.size());
+			bands[b].size = filtered.size();
+		});
+
+		static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		file.assign(signature, signature + 8);
+
+		std::vector<unsigned char> header;
+		putBigEndian32(header, uint32_t(width));
+		putBigEndian32(header, uint32_t(height));
+		header.push_back(8); // Bit depth
+		header.push_back(2); // Colour type: RGB
+		header.push_back(0); // Compression method
+		header.push_back(0); // Filter method
+		header.push_back(0); // Interlace method
+		putChunk(file, "IHDR", header.data(), header.size());
+
+		uint32_t adler = 1;
+		for (const Band& band : bands) {
+			file.insert(file.end(), band.chunk.begin(), band.chunk.end());
+			adler = adler32Combine(adler, band.adler, band.size);
+		}
+		std::vector<unsigned char> trailer;
+		putBigEndian32(trailer, adler);
+		putChunk(file, "IDAT", trailer.data(), trailer.size());
+		putChunk(file, "IEND", nullptr, 0);
+	}
+
+	void encodeQOI(const unsigned char* pixels, size_t width, size_t height, std::vector<unsigned char>& file) {
+		file.clear();
+		file.reserve(14 + 4 * width * height + 8);
+		file.insert(file.end(), { 'q', 'o', 'i', 'f' });
+		putBigEndian32(file, uint32_t(width));
+		putBigEndian32(file, uint32_t(height));
+		file.push_back(3); // Channels: RGB
+		file.push_back(0); // Colour space: sRGB with linear alpha
+
+		// Alpha is always 255, so only red, green, and blue are tracked
+		std::array<std::array<unsigned char, 3>, 64> seen;
+		for (auto& colour : seen) colour = { 0, 0, 0 };
+		unsigned char r0 = 0, g0 = 0, b0 = 0;
+		unsigned int run = 0;
+		const size_t numPixels = width * height;
+		for (size_t ix = 0; ix < numPixels; ++ix) {
+			const unsigned char r = pixels[3*ix], g = pixels[3*ix + 1], b = pixels[3*ix + 2];
+			if (r == r0 && g == g0 && b == b0) {
+				++run;
+				if (run == 62 || ix + 1 == numPixels) {
+					file.push_back((unsigned char)(0xC0 | (run - 1))); // QOI_OP_RUN
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0) {
+				file.push_back((unsigned char)(0xC0 | (run - 1)));
+				run = 0;
+			}
+			const unsigned int hash = (r*3 + g*5 + b*7 + 255*11) % 64;
+			if (seen[hash][0] == r && seen[hash][1] == g && seen[hash][2] == b) {
+				file.push_back((unsigned char)hash); // QOI_OP_INDEX
+			} else {
+				seen[hash] = { r, g, b };
+				const int dr = (signed char)(r - r0), dg = (signed char)(g - g0), db = (signed char)(b - b0);
+				const int drg = dr - dg, dbg = db - dg;
+				if (-2 <= dr && dr <= 1 && -2 <= dg && dg <= 1 && -2 <= db && db <= 1) {
+					file.push_back((unsigned char)(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2))); // QOI_OP_DIFF
+				} else if (-32 <= dg && dg <= 31 && -8 <= drg && drg <= 7 && -8 <= dbg && dbg <= 7) {
+					file.push_back((unsigned char)(0x80 | (dg + 32))); // QOI_OP_LUMA
+					file.push_back((unsigned char)((drg + 8) << 4 | (dbg + 8)));
+				} else {
+					file.insert(file.end(), { 0xFE, r, g, b }); // QOI_OP_RGB
+				}
+			}
+			r0 = r;
+			g0 = g;
+			b0 = b;
+		}
+		file.insert(file.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+	}
+
+	void encodeTGA(const unsigned char* pixels, size_t width, size_t height, std::vector<unsigned char>& file, ThreadPool* pool) {
+		file.assign(12, 0);
+		file[2] = 2; // Uncompressed true-colour
+		putLittleEndian16(file, width);
+		putLittleEndian16(file, height);
+		file.push_back(24);   // Bits per pixel
+		file.push_back(0x20); // Rows are stored top to bottom
+		const size_t start = file.size();
+		const size_t rowBytes = 3 * width;
+		file.resize(start + rowBytes * height);
+
+		// TGA stores blue, green, red
+		const size_t rowsPerBand = std::max<size_t>(1, pngBandBytes / std::max<size_t>(1, rowBytes));
+		forEach((height + rowsPerBand - 1) / rowsPerBand, pool, [&](size_t band, unsigned int) {
+			const size_t begin = band * rowsPerBand * rowBytes;
+			const size_t end = std::min(height, (band + 1) * rowsPerBand) * rowBytes;
+			for (size_t i = begin; i < end; i += 3) {
+				file[start + i] = pixels[i + 2];
+				file[start + i + 1] = pixels[i + 1];
+				file[start + i + 2] = pixels[i];
+			}
+		});
+	}
+
+	/** \brief Whether this machine stores floats least significant byte first. */
+	bool isLittleEndian() {
+		const uint32_t one = 1;
+		unsigned char first;
+		std::memcpy(&first, &one, 1);
+		return first == 1;
+	}
+
+	void encodePPM(const unsigned char* pixels, size_t width, size_t height, std::vector<unsigned char>& file) {
+		const std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+		file.assign(header.begin(), header.end());
+		file.insert(file.end(), pixels, pixels + 3 * width * height);
+	}
+
+}
+
+ImageFormat imageFormatForFile(const std::string& filename) {
+	const size_t dot = filename.find_last_of('.');
+	const std::string extension = dot == std::string::npos ? "" : toUpper(filename.substr(dot + 1));
+	if (extension == "QOI") return ImageFormat::QOI;
+	if (extension == "TGA") return ImageFormat::TGA;
+	if (extension == "PPM") return ImageFormat::PPM;
+	if (extension == "PFM") return ImageFormat::PFM;
+	return ImageFormat::PNG;
+}
+
+std::string imageFormatExtension(ImageFormat format) {
+	switch (format) {
+		case ImageFormat::QOI: return "qoi";
+		case ImageFormat::TGA: return "tga";
+		case ImageFormat::PPM: return "ppm";
+		case ImageFormat::PFM: return "pfm";
+		default: return "png";
+	}
+}
+
+std::string imageSizeError(ImageFormat format, size_t width, size_t height) {
+	if (width == 0 || height == 0) {
+		return "an image must have at least one pixel";
+	}
+	size_t limit = SIZE_MAX;
+	switch (format) {
+		case ImageFormat::TGA: limit = 0xFFFF; break;
+		case ImageFormat::QOI: limit = 0xFFFFFFFF; break;
+		case ImageFormat::PNG: limit = 0x7FFFFFFF; break;
+		default: break;
+	}
+	if (width > limit || height > limit) {
+		return imageFormatExtension(format) + " files cannot hold an image wider or taller than " + std::to_string(limit) + " pixels";
+	}
+	return "";
+}
+
+bool encodeImage(ImageFormat format, const unsigned char* pixels, size_t width, size_t height,
+                 std::vector<unsigned char>& file, ThreadPool* pool) {
+	if (!imageSizeError(format, width, height).empty()) {
+		file.clear();
+		return false;
+	}
+	switch (format) {
+		case ImageFormat::QOI: encodeQOI(pixels, width, height, file); break;
+		case ImageFormat::TGA: encodeTGA(pixels, width, height, file, pool); break;
+		case ImageFormat::PPM: encodePPM(pixels, width, height, file); break;
+		case ImageFormat::PFM: {
+			std::vector<float> radiance(3 * width * height);
+			for (size_t i = 0; i < radiance.size(); ++i) {
+				radiance[i] = pixels[i] / 255.0f;
+			}
+			encodePFM(radiance.data(), width, height, file);
+			break;
+		}
+		default: encodePNG(pixels, width, height, file, pool); break;
+	}
+	return true;
+}
+
+bool encodePFM(const float* radiance, size_t width, size_t height, std::vector<unsigned char>& file) {
+	if (!imageSizeError(ImageFormat::PFM, width, height).empty()) {
+		file.clear();
+		return false;
+	}
+	// A negative scale marks little-endian data. Rows are stored bottom to top.
+	const bool littleEndian = isLittleEndian();
+	const std::string header = "PF\n" + std::to_string(width) + " " + std::to_string(height) + (littleEndian ? "\n-1.0\n" : "\n1.0\n");
+	file.assign(header.begin(), header.end());
+	const size_t rowBytes = 3 * width * sizeof(float);
+	for (size_t y = height; y-- > 0; ) {
+		const unsigned char* row = reinterpret_cast<const unsigned char*>(radiance + 3 * width * y);
+		file.insert(file.end(), row, row + rowBytes);
+	}
+	return true;
+}
+
+bool decodePFM(const std::vector<unsigned char>& file, std::vector<float>& radiance, size_t& width, size_t& height) {
+	// Header: "PF", width, height, and scale, separated by whitespace, then a single whitespace character
+	std::vector<std::string> fields;
+	size_t pos = 0;
+	while (fields.size() < 4 && pos < file.size()) {
+		while (pos < file.size() && std::isspace(file[pos])) ++pos;
+		std::string field;
+		while (pos < file.size() && !std::isspace(file[pos])) field += char(file[pos++]);
+		if (!field.empty()) fields.push_back(field);
+	}
+	++pos;
+	if (fields.size() < 4 || fields[0] != "PF") return false;
+	const long long w = std::atoll(fields[1].c_str());
+	const long long h = std::atoll(fields[2].c_str());
+	const double scale = std::atof(fields[3].c_str());
+	if (w <= 0 || h <= 0 || scale == 0 || pos > file.size() || (file.size() - pos) / 12 / size_t(w) < size_t(h)) return false;
+	width = size_t(w);
+	height = size_t(h);
+
+	radiance.resize(3 * width * height);
+	const size_t rowBytes = 3 * width * sizeof(float);
+	for (size_t y = 0; y < height; ++y) {
+		std::memcpy(&radiance[3 * width * (height - 1 - y)], &file[pos + y * rowBytes], rowBytes);
+	}
+	if ((scale < 0) != isLittleEndian()) {
+		for (float& value : radiance) {
+			unsigned char bytes[sizeof(float)];
+			std::memcpy(bytes, &value, sizeof(float));
+			std::reverse(bytes, bytes + sizeof(float));
+			std::memcpy(&value, bytes, sizeof(float));
+		}
+	}
+	return true;
+}
+
+bool decodePPM(const std::vector<unsigned char>& file, std::vector<unsigned char>& pixels, size_t& width, size_t& height) {
+	// Header: "P6", width, height, and maximum value, separated by whitespace (and comments), then a single whitespace character
+	std::vector<std::string> fields;
+	size_t pos = 0;
+	while (fields.size() < 4 && pos < file.size()) {
+		while (pos < file.size() && std::isspace(file[pos])) ++pos;
+		if (pos < file.size() && file[pos] == '#') {
+			while (pos < file.size() && file[pos] != '\n') ++pos;
+			continue;
+		}
+		std::string field;
+		while (pos < file.size() && !std::isspace(file[pos])) field += char(file[pos++]);
+		if (!field.empty()) fields.push_back(field);
+	}
+	++pos;
+	if (fields.size() < 4 || fields[0] != "P6" || fields[3] != "255") return false;
+	const long long w = std::atoll(fields[1].c_str());
+	const long long h = std::atoll(fields[2].c_str());
+	if (w <= 0 || h <= 0 || pos > file.size() || (file.size() - pos) / 3 / size_t(w) < size_t(h)) return false;
+	width = size_t(w);
+	height = size_t(h);
+	pixels.assign(file.begin() + pos, file.begin() + pos + 3 * width * height);
+	return true;
+}
+
+void benchmarkImageEncoding(const unsigned char* pixels, size_t width, size_t height,
+                            ThreadPool& pool, unsigned int repeats, std::ostream& out) {
+	typedef std::chrono::steady_clock Clock;
+	const double rawBytes = double(3 * width * height);
+
+	out << "Encoding a " << width << "x" << height << " image, median of " << repeats << " run" << (repeats == 1 ? "" : "s") << std::endl;
+	out << std::left << std::setw(12) << "format" << std::right << std::setw(8) << "threads" << std::setw(12) << "ms"
+	    << std::setw(12) << "MB/s" << std::setw(12) << "bytes" << std::setw(10) << "ratio" << std::endl;
+
+	auto report = [&](const std::string& name, unsigned int threads, const std::function<size_t()>& encode) {
+		std::vector<double> times;
+		size_t bytes = 0;
+		for (unsigned int run = 0; run < std::max(1u, repeats); ++run) {
+			const Clock::time_point start = Clock::now();
+			bytes = encode();
+			times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+		}
+		std::sort(times.begin(), times.end());
+		const double ms = times[times.size() / 2];
+		out << std::left << std::setw(12) << name << std::right << std::setw(8) << threads
+		    << std::setw(12) << std::fixed << std::setprecision(2) << ms
+		    << std::setw(12) << std::setprecision(1) << (ms > 0 ? rawBytes / ms / 1000 : 0.0)
+		    << std::setw(12) << bytes
+		    << std::setw(10) << std::setprecision(3) << bytes / rawBytes << std::endl;
+		out << std::defaultfloat << std::setprecision(6);
+	};
+
+	std::vector<unsigned char> file;
+	report("png (stb)", 1, [&]() {
+		file.clear();
+		auto append = [](void* context, void* data, int size) {
+			std::vector<unsigned char>* out = static_cast<std::vector<unsigned char>*>(context);
+			out->insert(out->end(), static_cast<unsigned char*>(data), static_cast<unsigned char*>(data) + size);
+		};
+		stbi_write_png_to_func(append, &file, int(width), int(height), 3, pixels, 3 * int(width));
+		return file.size();
+	});
+	for (ImageFormat format : { ImageFormat::PNG, ImageFormat::QOI, ImageFormat::TGA, ImageFormat::PPM }) {
+		report(imageFormatExtension(format), 1, [&]() {
+			encodeImage(format, pixels, width, height, file);
+			return file.size();
+		});
+		if (format == ImageFormat::PNG || format == ImageFormat::TGA) {
+			report(imageFormatExtension(format), pool.size(), [&]() {
+				encodeImage(format, pixels, width, height, file, &pool);
+				return file.size();
+			});
+		}
+	}
+}
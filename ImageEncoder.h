@@ -0,0 +1,143 @@
+#pragma once
+
+#ifndef IMAGE_ENCODER_H_INCLUDED
+#define IMAGE_ENCODER_H_INCLUDED
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+/** \file
+ * \brief Image encoding header file.
+ */
+
+/**
+ * \brief File formats that images can be saved in.
+ *
+ * PNG files are smallest, and are compressed in parallel bands. The other formats
+ * trade file size for encoding speed: QOI is a simple lossless compression that is
+ * much faster than PNG, while TGA and PPM are stored uncompressed. PFM files keep the
+ * linear floating point framebuffer, so they can be tone mapped again later.
+ */
+enum class ImageFormat {
+	PNG, //!< Portable Network Graphics, deflate compressed.
+	QOI, //!< The "Quite OK Image" format, a fast lossless compression.
+	TGA, //!< Uncompressed Truevision TGA.
+	PPM, //!< Uncompressed binary Portable PixMap (P6).
+	PFM  //!< Portable FloatMap, which keeps linear floating point values rather than 8-bit pixels.
+};
+
+/**
+ * \brief Choose an ImageFormat from a file's extension.
+ *
+ * The extension is not case sensitive, so \c render.qoi and \c RENDER.QOI are both
+ * QOI files. The extensions \c .qoi, \c .tga, \c .ppm, and \c .pfm are recognised, and 
+ * files with any other extension (or none) are saved as PNG.
+ *
+ * \param filename The name of the file.
+ * \return The format to save the file in.
+ */
+ImageFormat imageFormatForFile(const std::string& filename);
+
+/**
+ * \brief The usual file extension for an ImageFormat.
+ *
+ * \param format The format.
+ * \return The extension, in lower case and without a leading dot.
+ */
+std::string imageFormatExtension(ImageFormat format);
+
+/**
+ * \brief Check whether an ImageFormat can hold an image of a given size.
+ *
+ * Every format needs at least one pixel. TGA files store their width and height in
+ * 16 bits, so neither can be more than 65535, and PNG and QOI files store them in 31
+ * and 32 bits.
+ *
+ * \param format The format.
+ * \param width The width of the image in pixels.
+ * \param height The height of the image in pixels.
+ * \return An empty string if the image can be stored, otherwise the reason it cannot.
+ */
+std::string imageSizeError(ImageFormat format, size_t width, size_t height);
+
+/**
+ * \brief Encode an image as a file in memory.
+ *
+ * The image is stored row by row, with three bytes (red, green, blue) per pixel.
+ *
+ * If a ThreadPool is given, PNG files are compressed as independent bands of rows,
+ * one task per band. Each band is a separate deflate block, byte-aligned with an empty
+ * stored block, so the bands can simply be joined together. This costs a few bytes per
+ * band, and matches are not found across bands, but the file is otherwise the same as
+ * when the bands are compressed one after another.
+ *
+ * ImageFormat::PFM holds floating point values, so the pixels are stored as values from 0 to 1.
+ * Use encodePFM() to store linear values instead.
+ *
+ * \param format The format to encode the image in.
+ * \param pixels The image data.
+ * \param width The width of the image in pixels.
+ * \param height The height of the image in pixels.
+ * \param file Vector to hold the encoded file. Any existing contents are replaced.
+ * \param pool The ThreadPool to encode with, or \c nullptr to encode on the calling thread.
+ * \return true if the image was encoded, false (leaving \c file empty) if the format cannot
+ *         hold an image of this size (see imageSizeError()).
+ */
+bool encodeImage(ImageFormat format, const unsigned char* pixels, size_t width, size_t height,
+                 std::vector<unsigned char>& file, ThreadPool* pool = nullptr);
+
+/**
+ * \brief Encode a linear floating point image as a PFM file in memory.
+ *
+ * \param radiance The image data, row by row, with three floats (red, green, blue) per pixel.
+ * \param width The width of the image in pixels.
+ * \param height The height of the image in pixels.
+ * \param file Vector to hold the encoded file. Any existing contents are replaced.
+ * \return true if the image was encoded, false (leaving \c file empty) if it has no pixels.
+ */
+bool encodePFM(const float* radiance, size_t width, size_t height, std::vector<unsigned char>& file);
+
+/**
+ * \brief Decode a colour PFM file.
+ *
+ * \param file The contents of the file.
+ * \param radiance Vector to hold the image data, row by row (top row first), with three floats per pixel.
+ * \param width Set to the width of the image in pixels.
+ * \param height Set to the height of the image in pixels.
+ * \return true if the file could be decoded, false if it is not a colour PFM file.
+ */
+bool decodePFM(const std::vector<unsigned char>& file, std::vector<float>& radiance, size_t& width, size_t& height);
+
+/**
+ * \brief Decode a binary PPM (P6) file with 8-bit channels.
+ *
+ * \param file The contents of the file.
+ * \param pixels Vector to hold the image data, row by row (top row first), with three bytes per pixel.
+ * \param width Set to the width of the image in pixels.
+ * \param height Set to the height of the image in pixels.
+ * \return true if the file could be decoded, false if it is not an 8-bit P6 file.
+ */
+bool decodePPM(const std::vector<unsigned char>& file, std::vector<unsigned char>& pixels, size_t& width, size_t& height);
+
+/**
+ * \brief Compare the time taken to encode an image, and the size of the file, in each format.
+ *
+ * Each format is encoded on one thread and on the ThreadPool, and the original single-threaded
+ * PNG writer from stb_image_write is included for comparison. The median of several repeats is
+ * reported for each.
+ *
+ * \param pixels The image data, stored as for encodeImage().
+ * \param width The width of the image in pixels.
+ * \param height The height of the image in pixels.
+ * \param pool The ThreadPool to encode with.
+ * \param repeats The number of times to encode the image in each format.
+ * \param out The stream to write the results to.
+ */
+void benchmarkImageEncoding(const unsigned char* pixels, size_t width, size_t height,
+                            ThreadPool& pool, unsigned int repeats, std::ostream& out);
+
+#endif // IMAGE_ENCODER_H_INCLUDED
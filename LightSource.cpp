@@ -19,3 +19,11 @@ LightSource& LightSource::operator=(const LightSource& lightSource) {
 	return *this;
 
 }
+
+PackedColour LightSource::getFastIlluminationAt(const Point& point, const Direction& /*lightDirection*/) const {
+	return getIlluminationAt(point);
+}
+
+bool LightSource::mayBeShadowedBy(const BoundingBox& /*caster*/, const BoundingBox& /*receiver*/) const {
+	return true;
+}
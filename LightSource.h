@@ -3,7 +3,9 @@
 #ifndef LIGHT_SOURCE_H_INCLUDED
 #define LIGTH_SOURCE_H_INCLUDED
 
+#include "BoundingBox.h"
 #include "Colour.h"
+#include "PackedColour.h"
 #include "Ray.h"
 
 /**
@@ -31,9 +33,22 @@ public:
 	 * apply to the colour of the light at a given Point in the Scene.
 	 *
 	 * \param point The Point at which light is measured.
-	 * \return The illumination that reaches the Point.
+	 * \return The illumination that reaches the Point, packed for shading.
 	 */
-	virtual Colour getIlluminationAt(const Point& point) const = 0;
+	virtual PackedColour getIlluminationAt(const Point& point) const = 0;
+
+	/** \brief Determine how much light reaches a Point, reusing its light direction, for fastMath shading.
+	 *
+	 * Shading already has the Direction from the light to the Point, so a LightSource whose
+	 * illumination falls off with distance can work it out from that without a square root.
+	 * The result may differ from getIlluminationAt() by rounding. The default implementation
+	 * just calls getIlluminationAt().
+	 *
+	 * \param point The Point at which light is measured.
+	 * \param lightDirection The Direction from the light to the Point, as returned by getLightDirection().
+	 * \return The illumination that reaches the Point, packed for shading.
+	 */
+	virtual PackedColour getFastIlluminationAt(const Point& point, const Direction& lightDirection) const;
 
 
 	/** \brief Determine how far away the light source is from a given Point.
@@ -69,6 +84,19 @@ public:
 	 */	
 	virtual Direction getLightDirection(const Point& point) const = 0;
 
+	/** \brief Check whether an Object might shadow another from this light.
+	 *
+	 * This is a conservative test on bounding boxes, used to decide which Objects
+	 * shadow Rays need to be tested against. It only depends on the Scene, not on
+	 * where it is viewed from, so it can be worked out once and shared by every view.
+	 * The default implementation assumes that any Object might cast a shadow.
+	 *
+	 * \param caster Bounds of the Object which might cast a shadow.
+	 * \param receiver Bounds of the Object which might be in shadow.
+	 * \return false if no point in receiver can be shadowed by caster, true otherwise.
+	 */
+	virtual bool mayBeShadowedBy(const BoundingBox& caster, const BoundingBox& receiver) const;
+
 
 protected:
 
@@ -94,7 +122,7 @@ protected:
 	 */
 	LightSource& operator=(const LightSource& lightSource);
 
-	Colour colour_;  //!< The Colour of this LightSource's illumination.
+	PackedColour colour_;  //!< The Colour of this LightSource's illumination.
 };
 
 #endif // LIGHT_SOURCE_H_INCLUDED
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "MaterialClasses.h"
+
+#include <map>
+
+namespace {
+
+	bool isBlack(const Colour& colour) {
+		return !(colour.red > 0 || colour.green > 0 || colour.blue > 0);
+	}
+
+}
+
+MaterialClasses::MaterialClasses(const std::vector<Material>& materials, const std::vector<unsigned int>& materialOf) :
+	features_() {
+	std::vector<unsigned char> classes;
+	for (const Material& material : materials) {
+		classes.push_back((unsigned char)classify(material));
+	}
+	for (unsigned int material : materialOf) {
+		features_.push_back(classes[material]);
+	}
+}
+
+MaterialClasses::~MaterialClasses() {
+
+}
+
+unsigned int MaterialClasses::classify(const Material& material) {
+	unsigned int features = 0;
+	if (!isBlack(material.ambientColour)) features |= AmbientFeature;
+	if (!isBlack(material.diffuseColour)) features |= DiffuseFeature;
+	if (!isBlack(material.specularColour)) features |= SpecularFeature;
+	if (!isBlack(material.mirrorColour)) features |= MirrorFeature;
+	return features;
+}
+
+std::string MaterialClasses::describe(unsigned int features) {
+	static const char* const names[] = { "ambient", "diffuse", "specular", "mirror" };
+	std::string description;
+	for (unsigned int bit = 0; bit < 4; ++bit) {
+		if (features & (1u << bit)) {
+			if (!description.empty()) description += "+";
+			description += names[bit];
+		}
+	}
+	return description.empty() ? "black" : description;
+}
+
+std::string MaterialClasses::summary() const {
+	std::map<unsigned int, size_t> counts;
+	for (unsigned char features : features_) {
+		++counts[features];
+	}
+	std::string result;
+	for (const auto& count : counts) {
+		if (!result.empty()) result += ", ";
+		result += std::to_string(count.second) + " " + describe(count.first);
+	}
+	return result.empty() ? "no objects" : result;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#ifndef MATERIAL_CLASSES_H_INCLUDED
+#define MATERIAL_CLASSES_H_INCLUDED
+
+#include "Material.h"
+#include "NonCopyable.h"
+
+#include <string>
+#include <vector>
+
+/** \file
+ * \brief MaterialClasses class header file.
+ */
+
+/** \brief The shading terms that a Material contributes, as bit flags. */
+enum MaterialFeature : unsigned int {
+	AmbientFeature = 1,  //!< The ambientColour is not black.
+	DiffuseFeature = 2,  //!< The diffuseColour is not black.
+	SpecularFeature = 4, //!< The specularColour is not black.
+	MirrorFeature = 8    //!< The mirrorColour is not black, so reflections are traced.
+};
+
+/**
+ * \brief The shading terms of each Object's Material.
+ *
+ * Most Materials only use some of the terms of the lighting model: a matte surface
+ * has no specular highlights, and few surfaces are mirrors. Terms whose Colour is
+ * black add nothing to the image, so the Scene uses these classes to pick a shading
+ * kernel compiled for just the terms a Material has. A Material with neither diffuse
+ * nor specular terms does not need shadow Rays at all.
+ *
+ * The classes are built once, as part of the CompiledScene.
+ */
+class MaterialClasses : private NonCopyable {
+
+public:
+
+	/** \brief Classify the Materials of a set of Objects.
+	 *
+	 * \param materials The distinct Materials in the Scene.
+	 * \param materialOf The index into materials of each Object's Material. Object indices refer to this vector.
+	 */
+	MaterialClasses(const std::vector<Material>& materials, const std::vector<unsigned int>& materialOf);
+
+	/** \brief MaterialClasses destructor. */
+	~MaterialClasses();
+
+	/** \brief Find the shading terms of a Material.
+	 *
+	 * \param material The Material to classify.
+	 * \return A combination of MaterialFeature flags.
+	 */
+	static unsigned int classify(const Material& material);
+
+	/** \brief Describe a combination of shading terms, such as "diffuse+specular".
+	 *
+	 * \param features A combination of MaterialFeature flags.
+	 * \return The names of the terms, joined by '+', or "black" if there are none.
+	 */
+	static std::string describe(unsigned int features);
+
+	/** \brief The shading terms of an Object's Material.
+	 *
+	 * \param object The index of the Object.
+	 * \return A combination of MaterialFeature flags.
+	 */
+	unsigned int features(unsigned int object) const {
+		return features_[object];
+	}
+
+	/** \brief Summarise how many Objects use each combination of shading terms.
+	 *
+	 * \return A list such as "3 diffuse, 1 diffuse+mirror".
+	 */
+	std::string summary() const;
+
+private:
+
+	std::vector<unsigned char> features_; //!< MaterialFeature flags for each Object.
+};
+
+#endif // MATERIAL_CLASSES_H_INCLUDED
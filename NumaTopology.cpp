@@ -0,0 +1,147 @@
+#include "NumaTopology.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+	thread_local size_t pinnedNode = 0; // Node of the CPU this thread was pinned to
+
+	// Memory policies, from linux/mempolicy.h
+	const int mpolDefault = 0;
+	const int mpolInterleave = 3;
+
+	// Parse a list of CPUs or nodes such as "0-3,8-11". Anything unreadable gives an empty list.
+	std::vector<int> parseList(const std::string& text) {
+		std::vector<int> cpus;
+		std::stringstream stream(text);
+		std::string range;
+		while (std::getline(stream, range, ',')) {
+			if (range.empty() || range == "\n") continue;
+			const size_t dash = range.find('-');
+			int first, last;
+			try {
+				first = std::stoi(range.substr(0, dash));
+				last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+			} catch (const std::exception&) {
+				return std::vector<int>();
+			}
+			for (int cpu = first; cpu <= last; ++cpu) {
+				cpus.push_back(cpu);
+			}
+		}
+		return cpus;
+	}
+
+	// Read the first line of a file, or an empty string if it cannot be read
+	std::string readLine(const std::string& filename) {
+		std::ifstream file(filename);
+		std::string line;
+		std::getline(file, line);
+		return line;
+	}
+
+}
+
+const NumaTopology& NumaTopology::system() {
+	static const NumaTopology topology;
+	return topology;
+}
+
+NumaTopology::NumaTopology() : cpus_(), nodeIds_() {
+#ifdef __linux__
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	const bool haveMask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+	for (int node : parseList(readLine("/sys/devices/system/node/online"))) {
+		if (node < 0 || node >= 1024) continue;
+		std::vector<int> cpus;
+		for (int cpu : parseList(readLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"))) {
+			if (!haveMask || (cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) cpus.push_back(cpu);
+		}
+		if (!cpus.empty()) {
+			cpus_.push_back(cpus);
+			nodeIds_.push_back(node);
+		}
+	}
+#endif
+	if (cpus_.empty()) {
+		// No topology information, so one node holds every hardware thread
+		std::vector<int> cpus;
+		for (unsigned int cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+			cpus.push_back(int(cpu));
+		}
+		cpus_.push_back(cpus);
+		nodeIds_.push_back(0);
+	}
+}
+
+std::vector<int> NumaTopology::cpuOrder(ThreadAffinity affinity) const {
+	std::vector<int> order;
+	if (affinity == ThreadAffinity::Compact) {
+		for (const auto& cpus : cpus_) {
+			order.insert(order.end(), cpus.begin(), cpus.end());
+		}
+	} else if (affinity == ThreadAffinity::Scatter) {
+		size_t longest = 0;
+		for (const auto& cpus : cpus_) {
+			longest = std::max(longest, cpus.size());
+		}
+		for (size_t ix = 0; ix < longest; ++ix) {
+			for (const auto& cpus : cpus_) {
+				if (ix < cpus.size()) order.push_back(cpus[ix]);
+			}
+		}
+	}
+	return order;
+}
+
+size_t NumaTopology::nodeOf(int cpu) const {
+	for (size_t node = 0; node < cpus_.size(); ++node) {
+		if (std::find(cpus_[node].begin(), cpus_[node].end(), cpu) != cpus_[node].end()) return node;
+	}
+	return 0;
+}
+
+bool NumaTopology::pinCurrentThread(int cpu) const {
+	pinnedNode = nodeOf(cpu);
+#ifdef __linux__
+	if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+size_t NumaTopology::currentNode() {
+	return pinnedNode;
+}
+
+bool NumaTopology::interleaveAllocations(bool interleave) const {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+	if (!interleave) {
+		return syscall(SYS_set_mempolicy, mpolDefault, nullptr, 0) == 0;
+	}
+	const unsigned long bitsPerWord = 8 * sizeof(unsigned long);
+	std::vector<unsigned long> mask(1024 / bitsPerWord, 0);
+	for (int node : nodeIds_) {
+		mask[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+	}
+	return syscall(SYS_set_mempolicy, mpolInterleave, mask.data(), mask.size() * bitsPerWord) == 0;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#ifndef NUMA_TOPOLOGY_H_INCLUDED
+#define NUMA_TOPOLOGY_H_INCLUDED
+
+#include <cstddef>
+#include <vector>
+
+/** \file
+ * \brief NumaTopology class header file.
+ */
+
+/** \brief How render threads are pinned to CPUs. */
+enum class ThreadAffinity {
+	None,    //!< Threads are left for the operating system to schedule.
+	Compact, //!< Threads fill the CPUs of one NUMA node before moving on to the next.
+	Scatter  //!< Threads are dealt out to the NUMA nodes in turn.
+};
+
+/**
+ * \brief Where a Scene's CompiledScene is placed on a machine with several NUMA nodes.
+ *
+ * This places only the CompiledScene (the bounds, light lists, Materials, and tables
+ * derived from the Scene). The Objects and their Transforms stay wherever they were
+ * allocated while the Scene was read, and are shared by the threads on every node.
+ */
+enum class NumaPlacement {
+	Local,      //!< One copy, on the node of the thread that builds it.
+	Replicate,  //!< One copy per node, each used by the threads on that node. The Objects are not copied.
+	Interleave  //!< One copy, with its pages spread across all of the nodes.
+};
+
+/**
+ * \brief The NUMA nodes of the machine, and the CPUs that belong to each.
+ *
+ * On a machine with several sockets, each socket (node) has its own memory, and
+ * reading another node's memory is slower. Linux places a page on the node of the 
+ * thread that first writes to it, so data built by one thread and read by all of
+ * them ends up remote for most of them. The NumaTopology is used to pin threads
+ * to the CPUs of particular nodes, and to set where a thread's allocations go.
+ *
+ * The topology is read from \c /sys/devices/system/node on Linux, keeping only the
+ * CPUs this process may run on. Elsewhere, or if that cannot be read, there is a 
+ * single node holding every hardware thread, and pinning and memory placement
+ * do nothing.
+ */
+class NumaTopology {
+
+public:
+
+	/** \brief The topology of this machine, read the first time it is needed.
+	 *
+	 * \return The NumaTopology shared by the whole program.
+	 */
+	static const NumaTopology& system();
+
+	/** \brief The number of NUMA nodes with CPUs that this process can use.
+	 *
+	 * \return At least 1.
+	 */
+	size_t numNodes() const {
+		return cpus_.size();
+	}
+
+	/** \brief The CPUs of a node.
+	 *
+	 * \param node The index of the node, from 0 to numNodes()-1.
+	 * \return The CPU numbers, in increasing order.
+	 */
+	const std::vector<int>& cpusOf(size_t node) const {
+		return cpus_[node];
+	}
+
+	/** \brief The order in which to give CPUs to threads.
+	 *
+	 * \param affinity How to spread threads over the nodes.
+	 * \return Every usable CPU, in the order threads should be pinned to them (repeating
+	 *         once every CPU is used), or an empty list for ThreadAffinity::None.
+	 */
+	std::vector<int> cpuOrder(ThreadAffinity affinity) const;
+
+	/** \brief The node that a CPU belongs to.
+	 *
+	 * \param cpu The CPU number.
+	 * \return The index of its node, or 0 if it is not a usable CPU.
+	 */
+	size_t nodeOf(int cpu) const;
+
+	/** \brief Pin the calling thread to one CPU.
+	 *
+	 * The thread's node is remembered, and returned by currentNode().
+	 *
+	 * \param cpu The CPU to run on.
+	 * \return true if the thread was pinned, false if pinning is not supported or failed.
+	 */
+	bool pinCurrentThread(int cpu) const;
+
+	/** \brief The node that the calling thread was pinned to.
+	 *
+	 * \return The node index, or 0 if the thread has not been pinned.
+	 */
+	static size_t currentNode();
+
+	/** \brief Spread the calling thread's future allocations over every node, or stop doing so.
+	 *
+	 * \param interleave true to interleave new pages over the nodes, false to go back
+	 *                   to placing them on the node of the thread that first touches them.
+	 * \return true if the policy was set, false if it is not supported or failed.
+	 */
+	bool interleaveAllocations(bool interleave) const;
+
+private:
+
+	/** \brief Read the topology of this machine. */
+	NumaTopology();
+
+	std::vector<std::vector<int>> cpus_; //!< The usable CPUs of each node with any.
+	std::vector<int> nodeIds_;           //!< The operating system's number for each node.
+};
+
+#endif // NUMA_TOPOLOGY_H_INCLUDED
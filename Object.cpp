@@ -17,4 +17,17 @@ Object& Object::operator=(const Object& object) {
 		transform = object.transform;
 	}
 	return *this;
-}
\ No newline at end of file
+}
+
+size_t Object::memoryBytes() const {
+	return sizeof(Object) - sizeof(Transform) + transform.memoryBytes();
+}
+
+BoundingBox Object::getBounds() const {
+	const BoundingBox unitCube(Point(-1, -1, -1), Point(1, 1, 1));
+	BoundingBox bounds;
+	for (int i = 0; i < 8; ++i) {
+		bounds.include(transform.apply(unitCube.corner(i)));
+	}
+	return bounds;
+}
@@ -3,6 +3,7 @@
 #ifndef OBJECT_H_INCLUDED
 #define OBJECT_H_INCLUDED
 
+#include "BoundingBox.h"
 #include "Material.h"
 #include "Ray.h"
 #include "RayIntersection.h"
@@ -49,6 +50,26 @@ public:
 	 */
 	virtual std::vector<RayIntersection> intersect(const Ray& ray) const = 0;
 
+	/** \brief World-space bounds of the Object.
+	 *
+	 * All of the standard Objects fit within the cube \f$[-1,1]^3\f$ before their
+	 * transform is applied, so the default implementation transforms the corners of
+	 * that cube and returns the box that contains them. An Object which extends
+	 * beyond this cube must override this method.
+	 *
+	 * \return A BoundingBox containing every Point where a Ray can hit the Object.
+	 */
+	virtual BoundingBox getBounds() const;
+
+	/** \brief Estimate the memory used by the Object.
+	 *
+	 * This includes the Object itself and the storage of its Transform. An Object with
+	 * members of its own, or storage of its own, should override this to add them.
+	 *
+	 * \return The number of bytes used.
+	 */
+	virtual size_t memoryBytes() const;
+
 	Transform transform; //!< A 3D transformation to apply to this Object.
 	
 	Material material; //!< The colour and reflectance properties of the Object.
@@ -0,0 +1,228 @@
+#pragma once
+
+#ifndef PACKED_COLOUR_H_INCLUDED
+#define PACKED_COLOUR_H_INCLUDED
+
+#include "Colour.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PACKED_COLOUR_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PACKED_COLOUR_NEON
+#endif
+
+/**
+ * \file
+ * \brief PackedColour class header file.
+ */
+
+/**
+ * \brief Colour stored as four single precision lanes, for shading.
+ *
+ * Shading a hit point combines several Colours per LightSource, and with Colour
+ * each of those products is three separate double precision operations in an
+ * out-of-line function. A PackedColour keeps red, green, and blue (and an unused
+ * fourth lane, which is always 0) in one SSE or NEON register, so each operation
+ * is a single inlined instruction. Where neither instruction set is available
+ * the lanes are plain floats.
+ *
+ * Single precision is ample for a value that ends up as an 8-bit pixel, but the
+ * Colours a PackedColour is made from are rounded to float, so results can differ
+ * from the same sums done with Colour in the last bit or two.
+ *
+ * The operators follow those of Colour, and are applied independently to each component.
+ */
+class PackedColour {
+
+public:
+
+	/** \brief PackedColour default constructor, which makes black. */
+	PackedColour() : lanes_(splat(0.0f)) {
+
+	}
+
+	/** \brief PackedColour constructor.
+	 *
+	 * \param r The red value of the new PackedColour.
+	 * \param g The green value of the new PackedColour.
+	 * \param b The blue value of the new PackedColour.
+	 */
+	PackedColour(float r, float g, float b) : lanes_(make(r, g, b)) {
+
+	}
+
+	/** \brief Convert a Colour to a PackedColour.
+	 *
+	 * \param colour The Colour to convert, whose components are rounded to float.
+	 */
+	explicit PackedColour(const Colour& colour) : lanes_(make(float(colour.red), float(colour.green), float(colour.blue))) {
+
+	}
+
+	/** \brief Convert back to a Colour.
+	 *
+	 * \return The Colour with the same components.
+	 */
+	Colour toColour() const {
+		float values[4];
+		store(values);
+		return Colour(values[0], values[1], values[2]);
+	}
+
+	/** \brief Add a PackedColour to this one in place.
+	 *
+	 * \param colour The PackedColour to add to \c this.
+	 * \return A reference to the updated \c this.
+	 */
+	PackedColour& operator+=(const PackedColour& colour) {
+#if defined(PACKED_COLOUR_SSE)
+		lanes_ = _mm_add_ps(lanes_, colour.lanes_);
+#elif defined(PACKED_COLOUR_NEON)
+		lanes_ = vaddq_f32(lanes_, colour.lanes_);
+#else
+		for (int i = 0; i < 4; ++i) lanes_.v[i] += colour.lanes_.v[i];
+#endif
+		return *this;
+	}
+
+	/** \brief Subtract a PackedColour from this one in place.
+	 *
+	 * \param colour The PackedColour to subtract from \c this.
+	 * \return A reference to the updated \c this.
+	 */
+	PackedColour& operator-=(const PackedColour& colour) {
+#if defined(PACKED_COLOUR_SSE)
+		lanes_ = _mm_sub_ps(lanes_, colour.lanes_);
+#elif defined(PACKED_COLOUR_NEON)
+		lanes_ = vsubq_f32(lanes_, colour.lanes_);
+#else
+		for (int i = 0; i < 4; ++i) lanes_.v[i] -= colour.lanes_.v[i];
+#endif
+		return *this;
+	}
+
+	/** \brief Multiply this PackedColour by another in place.
+	 *
+	 * \param colour The PackedColour to multiply \c this by.
+	 * \return A reference to the updated \c this.
+	 */
+	PackedColour& operator*=(const PackedColour& colour) {
+#if defined(PACKED_COLOUR_SSE)
+		lanes_ = _mm_mul_ps(lanes_, colour.lanes_);
+#elif defined(PACKED_COLOUR_NEON)
+		lanes_ = vmulq_f32(lanes_, colour.lanes_);
+#else
+		for (int i = 0; i < 4; ++i) lanes_.v[i] *= colour.lanes_.v[i];
+#endif
+		return *this;
+	}
+
+	/** \brief Multiply this PackedColour by a scalar in place.
+	 *
+	 * \param s The scalar to multiply \c this by.
+	 * \return A reference to the updated \c this.
+	 */
+	PackedColour& operator*=(float s) {
+		return *this *= PackedColour(splat(s));
+	}
+
+	/** \brief Clip each component to the range [0,1], as Colour::clip() does. */
+	void clip() {
+#if defined(PACKED_COLOUR_SSE)
+		lanes_ = _mm_min_ps(_mm_max_ps(lanes_, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+#elif defined(PACKED_COLOUR_NEON)
+		lanes_ = vminq_f32(vmaxq_f32(lanes_, vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+#else
+		for (int i = 0; i < 4; ++i) lanes_.v[i] = lanes_.v[i] < 0 ? 0.0f : (lanes_.v[i] > 1 ? 1.0f : lanes_.v[i]);
+#endif
+	}
+
+	float red() const { float values[4]; store(values); return values[0]; }   //!< \return The red component.
+	float green() const { float values[4]; store(values); return values[1]; } //!< \return The green component.
+	float blue() const { float values[4]; store(values); return values[2]; }  //!< \return The blue component.
+
+private:
+
+#if defined(PACKED_COLOUR_SSE)
+	typedef __m128 Lanes;
+#elif defined(PACKED_COLOUR_NEON)
+	typedef float32x4_t Lanes;
+#else
+	struct Lanes { float v[4]; };
+#endif
+
+	/** \brief Make a PackedColour directly from its lanes. */
+	explicit PackedColour(Lanes lanes) : lanes_(lanes) {
+
+	}
+
+	/** \brief Lanes holding red, green, blue, and 0. */
+	static Lanes make(float r, float g, float b) {
+#if defined(PACKED_COLOUR_SSE)
+		return _mm_setr_ps(r, g, b, 0.0f);
+#elif defined(PACKED_COLOUR_NEON)
+		const float values[4] = { r, g, b, 0.0f };
+		return vld1q_f32(values);
+#else
+		Lanes lanes = { { r, g, b, 0.0f } };
+		return lanes;
+#endif
+	}
+
+	/** \brief Lanes holding the same value in each of the colour lanes. */
+	static Lanes splat(float s) {
+		return make(s, s, s);
+	}
+
+	/** \brief Copy the lanes out to memory. */
+	void store(float values[4]) const {
+#if defined(PACKED_COLOUR_SSE)
+		_mm_storeu_ps(values, lanes_);
+#elif defined(PACKED_COLOUR_NEON)
+		vst1q_f32(values, lanes_);
+#else
+		for (int i = 0; i < 4; ++i) values[i] = lanes_.v[i];
+#endif
+	}
+
+	Lanes lanes_; //!< Red, green, blue, and an unused lane.
+};
+
+/** \brief PackedColour addition.
+ * \relates PackedColour
+ */
+inline PackedColour operator+(PackedColour lhs, const PackedColour& rhs) {
+	return lhs += rhs;
+}
+
+/** \brief PackedColour subtraction.
+ * \relates PackedColour
+ */
+inline PackedColour operator-(PackedColour lhs, const PackedColour& rhs) {
+	return lhs -= rhs;
+}
+
+/** \brief PackedColour multiplication, component by component.
+ * \relates PackedColour
+ */
+inline PackedColour operator*(PackedColour lhs, const PackedColour& rhs) {
+	return lhs *= rhs;
+}
+
+/** \brief PackedColour-scalar multiplication.
+ * \relates PackedColour
+ */
+inline PackedColour operator*(PackedColour colour, float s) {
+	return colour *= s;
+}
+
+/** \brief Scalar-PackedColour multiplication.
+ * \relates PackedColour
+ */
+inline PackedColour operator*(float s, PackedColour colour) {
+	return colour *= s;
+}
+
+#endif // PACKED_COLOUR_H_INCLUDED
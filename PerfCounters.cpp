@@ -0,0 +1,221 @@
+#include "PerfCounters.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+	/** \brief The perf_event_attr type and config of each PerfCounters::Event. */
+	const struct { uint32_t type; uint64_t config; } eventConfigs[PerfCounters::NumEvents] = {
+		{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+	};
+
+	/** \brief Open a counter of user-space events on a thread, and the threads it starts.
+	 *
+	 * \return The file descriptor, or -1 with errno set.
+	 */
+	int openCounter(PerfCounters::Event event, pid_t tid) {
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = eventConfigs[event].type;
+		attr.config = eventConfigs[event].config;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		attr.inherit = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		return int(syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0));
+	}
+
+	/** \brief Read a counter, scaled up for any time the kernel was not counting it. */
+	double readCounter(int fd) {
+		uint64_t values[3] = { 0, 0, 0 }; // Count, time enabled, time running
+		if (::read(fd, values, sizeof(values)) != ssize_t(sizeof(values)) || values[2] == 0) return 0;
+		return values[2] < values[1] ? double(values[0]) * double(values[1]) / double(values[2]) : double(values[0]);
+	}
+
+	/** \brief The IDs of every thread in this process. */
+	std::vector<pid_t> processThreads() {
+		std::vector<pid_t> threads;
+		if (DIR* tasks = opendir("/proc/self/task")) {
+			while (const dirent* entry = readdir(tasks)) {
+				if (entry->d_name[0] != '.') threads.push_back(pid_t(std::atoi(entry->d_name)));
+			}
+			closedir(tasks);
+		}
+		if (threads.empty()) threads.push_back(0); // The calling thread
+		return threads;
+	}
+#endif
+
+	/** \brief Write a count with a few significant figures. */
+	std::string formatCount(double value) {
+		std::ostringstream out;
+		if (value < 1000) {
+			out << std::setprecision(3) << value;
+		} else {
+			out << std::fixed << std::setprecision(0) << value;
+		}
+		return out.str();
+	}
+
+}
+
+PerfCounters::Counts::Counts() {
+	for (int event = 0; event < NumEvents; ++event) {
+		values[event] = 0;
+		available[event] = false;
+	}
+}
+
+PerfCounters::Counts& PerfCounters::Counts::operator+=(const Counts& other) {
+	for (int event = 0; event < NumEvents; ++event) {
+		values[event] += other.values[event];
+		available[event] = available[event] || other.available[event];
+	}
+	return *this;
+}
+
+bool PerfCounters::Counts::any() const {
+	for (int event = 0; event < NumEvents; ++event) {
+		if (available[event]) return true;
+	}
+	return false;
+}
+
+std::string PerfCounters::Counts::summary(double units, const std::string& unit) const {
+	if (!any()) return "unavailable";
+	std::ostringstream out;
+	const double scale = units > 0 ? 1 / units : 1;
+	if (units > 0) out << "per " << unit << ": ";
+	bool first = true;
+	for (int event = 0; event < NumEvents; ++event) {
+		if (!available[event]) continue;
+		out << (first ? "" : ", ") << formatCount(values[event] * scale) << " " << eventName(Event(event));
+		first = false;
+	}
+	if (available[Cycles] && available[Instructions] && values[Cycles] > 0) {
+		out << ", IPC " << formatCount(values[Instructions] / values[Cycles]);
+	}
+	return out.str();
+}
+
+void PerfCounters::Counts::writeJson(std::ostream& out, double units, const std::string& unit) const {
+	out << "{";
+	for (int event = 0; event < NumEvents; ++event) {
+		out << (event == 0 ? "" : ", ") << "\"" << eventName(Event(event)) << "\": ";
+		if (available[event]) out << values[event]; else out << "null";
+	}
+	if (units > 0) {
+		out << ", \"per_" << unit << "\": {";
+		for (int event = 0; event < NumEvents; ++event) {
+			out << (event == 0 ? "" : ", ") << "\"" << eventName(Event(event)) << "\": ";
+			if (available[event]) out << values[event] / units; else out << "null";
+		}
+		out << "}";
+	}
+	out << "}";
+}
+
+PerfCounters::PerfCounters() : counters_() {
+#ifdef __linux__
+	const std::vector<pid_t> threads = processThreads();
+	for (int event = 0; event < NumEvents; ++event) {
+		Counter& counter = counters_[event];
+		for (pid_t thread : threads) {
+			const int fd = openCounter(Event(event), thread);
+			if (fd < 0) {
+				if (errno == ESRCH) continue; // The thread has finished
+				// The event cannot be counted at all, so none of its counters are kept
+				for (int open : counter.fds) close(open);
+				counter.fds.clear();
+				break;
+			}
+			counter.fds.push_back(fd);
+		}
+		for (int fd : counter.fds) {
+			counter.started.push_back(readCounter(fd));
+		}
+	}
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+	for (const Counter& counter : counters_) {
+		for (int fd : counter.fds) close(fd);
+	}
+#endif
+}
+
+PerfCounters::Counts PerfCounters::read() const {
+	Counts counts;
+#ifdef __linux__
+	for (int event = 0; event < NumEvents; ++event) {
+		const Counter& counter = counters_[event];
+		if (counter.fds.empty()) continue;
+		counts.available[event] = true;
+		for (size_t ix = 0; ix < counter.fds.size(); ++ix) {
+			counts.values[event] += readCounter(counter.fds[ix]) - counter.started[ix];
+		}
+	}
+#endif
+	return counts;
+}
+
+std::string PerfCounters::availability() {
+#ifdef __linux__
+	static const std::string reason = [] {
+		for (int event = 0; event < NumEvents; ++event) {
+			const int fd = openCounter(Event(event), 0);
+			if (fd >= 0) {
+				close(fd);
+				continue;
+			}
+			const int error = errno;
+			std::string why = std::string(eventName(Event(event))) + " cannot be counted: " + std::strerror(error);
+			if (error == ENOENT || error == EOPNOTSUPP) {
+				why += " (no hardware counters, as in many virtual machines)";
+			} else if (error == EACCES || error == EPERM) {
+				why += " (see /proc/sys/kernel/perf_event_paranoid)";
+			} else if (error == ENOSYS) {
+				why += " (the kernel does not support perf_event_open)";
+			}
+			return why;
+		}
+		return std::string();
+	}();
+	return reason;
+#else
+	return "performance counters need Linux's perf_event_open";
+#endif
+}
+
+const char* PerfCounters::eventName(Event event) {
+	switch (event) {
+		case TaskClock: return "cpu_ns";
+		case Cycles: return "cycles";
+		case Instructions: return "instructions";
+		case L1DataMisses: return "l1d_misses";
+		case LastLevelMisses: return "llc_misses";
+		case BranchMisses: return "branch_misses";
+		default: return "unknown";
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#ifndef PERF_COUNTERS_H_INCLUDED
+#define PERF_COUNTERS_H_INCLUDED
+
+#include "NonCopyable.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/** \file
+ * \brief PerfCounters class header file.
+ */
+
+/**
+ * \brief Counts hardware events, such as cache misses, with Linux's \c perf_event_open.
+ *
+ * A PerfCounters object counts, from when it is constructed, the events of every thread
+ * in the process, including threads started later. Only user-space events are counted,
+ * which is all that the default \c perf_event_paranoid setting allows.
+ *
+ * Counters are often unavailable: on other operating systems, in virtual machines and
+ * containers without a PMU, or when \c perf_event_paranoid forbids them. Each event that
+ * cannot be counted is simply left out of the Counts, and availability() says why.
+ * When the kernel shares the hardware counters between more events than it has, each
+ * count is scaled up by the fraction of the time it was counted for.
+ */
+class PerfCounters : private NonCopyable {
+
+public:
+
+	/** \brief The events counted. */
+	enum Event {
+		TaskClock,       //!< CPU time in nanoseconds (a software event, so it is usually available).
+		Cycles,          //!< CPU cycles.
+		Instructions,    //!< Instructions retired.
+		L1DataMisses,    //!< Level 1 data cache read misses.
+		LastLevelMisses, //!< Last level cache misses.
+		BranchMisses,    //!< Mispredicted branches.
+		NumEvents        //!< The number of events.
+	};
+
+	/**
+	 * \brief The number of each event counted over some time.
+	 */
+	struct Counts {
+
+		/** \brief Counts constructor, for no events. */
+		Counts();
+
+		/** \brief Add the counts of another period.
+		 *
+		 * \param other The counts to add. Events not counted in either are not counted in the total.
+		 * \return This Counts.
+		 */
+		Counts& operator+=(const Counts& other);
+
+		/** \brief Whether any event was counted.
+		 *
+		 * \return true if at least one event is available.
+		 */
+		bool any() const;
+
+		/** \brief Summarise the counts on one line.
+		 *
+		 * \param units The amount of work done, such as the number of Rays traced, or 0 for none.
+		 * \param unit The name of one unit of work, such as "ray".
+		 * \return Each available count per unit, and the instructions per cycle, or "unavailable".
+		 */
+		std::string summary(double units, const std::string& unit) const;
+
+		/** \brief Write the counts as a JSON object.
+		 *
+		 * Events that were not counted are written as \c null.
+		 *
+		 * \param out The stream to write to.
+		 * \param units The amount of work done, for the per-unit values, or 0 for none.
+		 * \param unit The name of one unit of work, such as "ray".
+		 */
+		void writeJson(std::ostream& out, double units, const std::string& unit) const;
+
+		double values[NumEvents];  //!< The count of each event.
+		bool available[NumEvents]; //!< Whether each event was counted.
+	};
+
+	/** \brief PerfCounters constructor, which starts counting.
+	 *
+	 * Counters are opened on every thread in the process, and inherited by any threads
+	 * they start.
+	 */
+	PerfCounters();
+
+	/** \brief PerfCounters destructor, which stops counting. */
+	~PerfCounters();
+
+	/** \brief The counts since construction.
+	 *
+	 * \return The count of each available event.
+	 */
+	Counts read() const;
+
+	/** \brief Why events cannot be counted.
+	 *
+	 * \return A description of the first event that could not be opened, or empty if all of them can.
+	 */
+	static std::string availability();
+
+	/** \brief The name of an event, as used in reports.
+	 *
+	 * \param event The event.
+	 * \return A short name, such as "cycles".
+	 */
+	static const char* eventName(Event event);
+
+private:
+
+	/** \brief The counters for one event, one per thread. */
+	struct Counter {
+		std::vector<int> fds;        //!< File descriptors of the counters.
+		std::vector<double> started; //!< The scaled count of each when counting started.
+	};
+
+	Counter counters_[NumEvents]; //!< Counters for each event.
+};
+
+#endif // PERF_COUNTERS_H_INCLUDED
@@ -1,5 +1,7 @@
 #include "PinholeCamera.h"
 
+#include "utility.h"
+
 PinholeCamera::PinholeCamera(double f) : Camera(), focalLength(f) {
 
 }
@@ -27,4 +29,28 @@ Ray PinholeCamera::castRay(double x, double y) const {
 	ray.direction(1) = y;
 	ray.direction(2) = focalLength;
 	return transform.apply(ray);
-}
\ No newline at end of file
+}
+
+bool PinholeCamera::projectBounds(const BoundingBox& bounds, double& minX, double& minY, double& maxX, double& maxY) const {
+	if (focalLength <= 0) return false;
+
+	// In camera co-ordinates castRay(x, y) passes through t*(x, y, focalLength), for t > 0
+	minX = minY = infinity;
+	maxX = maxY = -infinity;
+	int behind = 0;
+	for (int i = 0; i < 8; ++i) {
+		Point p = transform.applyInverse(bounds.corner(i));
+		if (p(2) <= 0) {
+			++behind;
+			continue;
+		}
+		double x = focalLength * p(0) / p(2);
+		double y = focalLength * p(1) / p(2);
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+	}
+	// A box straddling the camera centre can appear anywhere. One entirely behind can't be seen
+	return behind == 0 || behind == 8;
+}
@@ -61,6 +61,22 @@ public:
 	 */
 	Ray castRay(double x, double y) const;
 
+	/** \brief Find the region of the image plane where a BoundingBox can appear.
+	 *
+	 * The corners of the box are projected onto the image plane, and the region
+	 * is the rectangle containing them. If the box is partly behind the camera 
+	 * centre this does not work, and false is returned. If it is completely 
+	 * behind the camera it cannot be seen, and an empty region is returned.
+	 *
+	 * \param bounds The BoundingBox to project.
+	 * \param minX Set to the smallest x-value of the region.
+	 * \param minY Set to the smallest y-value of the region.
+	 * \param maxX Set to the largest x-value of the region.
+	 * \param maxY Set to the largest y-value of the region.
+	 * \return true if the region was found, false if it could be anywhere.
+	 */
+	bool projectBounds(const BoundingBox& bounds, double& minX, double& minY, double& maxX, double& maxY) const;
+
 	double focalLength; //!< The distance from the camera centre to the image plane.
 
 private:
@@ -2,6 +2,8 @@
 
 #include "utility.h"
 
+#include <algorithm>
+
 PointLightSource::PointLightSource(const Colour& colour, const Point& location) :
 LightSource(colour), location_(location) {
 
@@ -23,10 +25,15 @@ PointLightSource& PointLightSource::operator=(const PointLightSource& lightSourc
 	return *this;
 }
 
-Colour PointLightSource::getIlluminationAt(const Point& point) const {
+PackedColour PointLightSource::getIlluminationAt(const Point& point) const {
 	double distance = (location_ - point).norm();
 	if (distance < epsilon) distance = epsilon;
-	return (1.0 / (distance*distance)) * colour_;
+	return float(1.0 / (distance*distance)) * colour_;
+}
+
+PackedColour PointLightSource::getFastIlluminationAt(const Point& /*point*/, const Direction& lightDirection) const {
+	const double squaredDistance = std::max(lightDirection.squaredNorm(), epsilon*epsilon);
+	return float(1.0 / squaredDistance) * colour_;
 }
 
 
@@ -38,3 +45,7 @@ Direction PointLightSource::getLightDirection(const Point& point) const {
 
 	return point - location_;
 }
+
+bool PointLightSource::mayBeShadowedBy(const BoundingBox& caster, const BoundingBox& receiver) const {
+	return caster.mayBlock(receiver, location_);
+}
@@ -58,7 +58,18 @@ public:
 	 * \param point The Point at which light is measured.
 	 * \return The illumination that reaches the Point.
 	 */
-	Colour getIlluminationAt(const Point& point) const;
+	PackedColour getIlluminationAt(const Point& point) const;
+
+	/** \brief Determine how much light reaches a Point from this PointLightSource, for fastMath shading.
+	 *
+	 * The squared distance \f$d^2\f$ is the squared length of the light direction,
+	 * so the \f$1/d^2\f$ falloff needs no square root.
+	 *
+	 * \param point The Point at which light is measured.
+	 * \param lightDirection The Direction from the light to the Point, as returned by getLightDirection().
+	 * \return The illumination that reaches the Point.
+	 */
+	PackedColour getFastIlluminationAt(const Point& point, const Direction& lightDirection) const;
 
 	/**
 	 * \brief Determine how far away the light source is from a given Point.
@@ -78,6 +89,15 @@ public:
 	 */
 	Direction getLightDirection(const Point& point) const;
 
+	/** \brief Check whether an Object might shadow another from this light.
+	 *
+	 * \param caster Bounds of the Object which might cast a shadow.
+	 * \param receiver Bounds of the Object which might be in shadow.
+	 * \return false if no point in receiver can be shadowed by caster, true otherwise.
+	 * \sa LightSource::mayBeShadowedBy()
+	 */
+	bool mayBeShadowedBy(const BoundingBox& caster, const BoundingBox& receiver) const;
+
 private:
 
 	Point location_; //!< Location of this PointLightSource
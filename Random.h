@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef RANDOM_H_INCLUDED
+#define RANDOM_H_INCLUDED
+
+#include <cstdint>
+
+/**
+ * \file
+ * \brief Random class header file.
+ */
+
+/**
+ * \brief Small, fast, seedable random number generator.
+ *
+ * Random implements the SplitMix64 generator. It has only 64 bits of state, 
+ * so each sample of each pixel can carry its own generator, seeded from the 
+ * pixel co-ordinates and sample number. Every random decision made while tracing
+ * a sample then depends only on that sample, and not on the order in which pixels
+ * (or Rays) happen to be processed, or on which thread processes them.
+ */
+class Random {
+
+public:
+
+	/** \brief Random constructor.
+	 *
+	 * \param seed The initial state of the generator.
+	 */
+	explicit Random(uint64_t seed = 0) : state_(seed) {
+
+	}
+
+	/** \brief Create the generator for a sample within a pixel.
+	 *
+	 * \param u The column of the pixel.
+	 * \param v The row of the pixel.
+	 * \param sample The index of the sample within the pixel.
+	 * \return A generator whose sequence depends only on (u,v) and the sample.
+	 */
+	static Random forPixel(unsigned int u, unsigned int v, unsigned int sample = 0) {
+		Random pixelMixer((uint64_t(v) << 32) | u);
+		Random sampleMixer(pixelMixer.next() ^ (uint64_t(sample) * 0xD1B54A32D192ED03ull));
+		return Random(sampleMixer.next());
+	}
+
+	/** \brief Generate the next 64 random bits.
+	 *
+	 * \return A uniformly distributed 64-bit integer.
+	 */
+	uint64_t next() {
+		uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	/** \brief Generate a random number in [0,1).
+	 *
+	 * \return A uniformly distributed value in [0,1).
+	 */
+	double uniform() {
+		return double(next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+private:
+
+	uint64_t state_; //!< Current state of the generator.
+
+};
+
+#endif // RANDOM_H_INCLUDED
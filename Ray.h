@@ -19,6 +19,20 @@
  */
 class Ray {
 public:
+	/** \brief Ray default constructor, starting at the origin with a zero Direction. */
+	Ray() : point(), direction() {
+
+	}
+
+	/** \brief Ray constructor.
+	 *
+	 * \param point The starting Point for the Ray.
+	 * \param direction The Direction for the Ray.
+	 */
+	Ray(const Point& point, const Direction& direction) : point(point), direction(direction) {
+
+	}
+
 	Point point; //!< The starting Point for the Ray.
 	Direction direction; //!< The Direction for the Ray.
 };
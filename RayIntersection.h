@@ -32,6 +32,7 @@ public:
 	Normal normal; //!< The Normal at the Point of intersection.
 	Material material; //!< The Material of the Object that is hit.
 	double distance; //!< The distance along the Ray to the intersection Point.
+	unsigned int object; //!< Index (in the Scene) of the Object that is hit.
 
 	/** \brief Less-than comparison for RayIntersection.
 	 * 
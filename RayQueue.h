@@ -0,0 +1,117 @@
+#pragma once
+
+#ifndef RAY_QUEUE_H_INCLUDED
+#define RAY_QUEUE_H_INCLUDED
+
+#include "Ray.h"
+
+#include <vector>
+
+/**
+ * \file
+ * \brief RayQueue class header file.
+ */
+
+/**
+ * \brief A queue of Rays stored as a structure of arrays.
+ *
+ * The WavefrontRenderer processes Rays in large batches, one stage at a time.
+ * Rather than keeping a std::vector of Ray objects (each of which holds its Point
+ * and Direction on the heap), a RayQueue keeps each co-ordinate in its own 
+ * contiguous array. Each Ray also records the index of the path (pixel) it 
+ * belongs to, so that results can be routed back once the stage is complete.
+ */
+class RayQueue {
+
+public:
+
+	/** \brief Remove all Rays from the queue, keeping the allocated storage. */
+	void clear() {
+		originX.clear();
+		originY.clear();
+		originZ.clear();
+		directionX.clear();
+		directionY.clear();
+		directionZ.clear();
+		path.clear();
+	}
+
+	/** \brief Reserve storage for a number of Rays.
+	 *
+	 * \param capacity The number of Rays to make room for.
+	 */
+	void reserve(size_t capacity) {
+		originX.reserve(capacity);
+		originY.reserve(capacity);
+		originZ.reserve(capacity);
+		directionX.reserve(capacity);
+		directionY.reserve(capacity);
+		directionZ.reserve(capacity);
+		path.reserve(capacity);
+	}
+
+	/** \brief The number of Rays in the queue.
+	 *
+	 * \return The number of Rays in the queue.
+	 */
+	size_t size() const {
+		return path.size();
+	}
+
+	/** \brief Add a Ray to the end of the queue.
+	 *
+	 * \param ray The Ray to add.
+	 * \param pathIndex The path that the Ray contributes to.
+	 */
+	void push(const Ray& ray, unsigned int pathIndex) {
+		originX.push_back(ray.point(0));
+		originY.push_back(ray.point(1));
+		originZ.push_back(ray.point(2));
+		directionX.push_back(ray.direction(0));
+		directionY.push_back(ray.direction(1));
+		directionZ.push_back(ray.direction(2));
+		path.push_back(pathIndex);
+	}
+
+	/** \brief Rebuild a Ray from the queue.
+	 *
+	 * \param ix The position of the Ray in the queue.
+	 * \return The Ray at position ix.
+	 */
+	Ray ray(size_t ix) const {
+		return Ray(Point(originX[ix], originY[ix], originZ[ix]), Direction(directionX[ix], directionY[ix], directionZ[ix]));
+	}
+
+	/** \brief Copy the start Point of a Ray into a plain array.
+	 *
+	 * \param ix The position of the Ray in the queue.
+	 * \param origin Set to the x, y, and z components of the start Point.
+	 */
+	void origin(size_t ix, double origin[3]) const {
+		origin[0] = originX[ix];
+		origin[1] = originY[ix];
+		origin[2] = originZ[ix];
+	}
+
+	/** \brief Copy the Direction of a Ray into a plain array.
+	 *
+	 * \param ix The position of the Ray in the queue.
+	 * \param direction Set to the x, y, and z components of the Direction.
+	 */
+	void direction(size_t ix, double direction[3]) const {
+		direction[0] = directionX[ix];
+		direction[1] = directionY[ix];
+		direction[2] = directionZ[ix];
+	}
+
+	std::vector<double> originX;    //!< X-components of the Ray start Points.
+	std::vector<double> originY;    //!< Y-components of the Ray start Points.
+	std::vector<double> originZ;    //!< Z-components of the Ray start Points.
+	std::vector<double> directionX; //!< X-components of the Ray Directions.
+	std::vector<double> directionY; //!< Y-components of the Ray Directions.
+	std::vector<double> directionZ; //!< Z-components of the Ray Directions.
+	std::vector<unsigned int> path; //!< Index of the path (pixel) each Ray contributes to.
+
+};
+
+#endif // RAY_QUEUE_H_INCLUDED
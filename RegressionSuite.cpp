@@ -0,0 +1,247 @@
+#include "RegressionSuite.h"
+
+#include "ImageDisplay.h"
+#include "ImageEncoder.h"
+#include "RenderProgress.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+
+#ifndef RAYTRACER_BUILD_TYPE
+#define RAYTRACER_BUILD_TYPE ""
+#endif
+
+namespace {
+
+	typedef std::chrono::steady_clock Clock;
+
+	/** \brief The median of values sorted into increasing order. */
+	double median(const std::vector<double>& sorted) {
+		const size_t middle = sorted.size() / 2;
+		return sorted.size() % 2 == 1 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+	}
+
+}
+
+RegressionSuite::RegressionSuite(unsigned int numThreads, const SceneSetup& setup, const std::vector<int>& cpus) :
+	pool_(numThreads, cpus), setup_(setup) {
+
+}
+
+RegressionSuite::~RegressionSuite() {
+
+}
+
+std::vector<RegressionSuite::Entry> RegressionSuite::readSuite(const std::string& suite) {
+	const char* keys[] = { "NAME", "REFERENCE", "TOLERANCE", "OUTLIERS" };
+	const std::vector<SceneJob> jobs = SceneJob::readList(suite, "benchmark suite", std::vector<std::string>(std::begin(keys), std::end(keys)));
+
+	std::vector<Entry> entries;
+	for (const SceneJob& job : jobs) {
+		Entry entry{job, job.setting("NAME"), job.setting("REFERENCE"), 1, 0};
+		if (!job.setting("TOLERANCE").empty()) {
+			std::istringstream value(job.setting("TOLERANCE"));
+			if (!(value >> entry.tolerance) || entry.tolerance < 0) {
+				std::cerr << "Unexpected setting 'tolerance=" << job.setting("TOLERANCE") << "' on line " << job.line << " of " << suite << std::endl;
+				exit(-1);
+			}
+		}
+		if (!job.setting("OUTLIERS").empty()) {
+			std::istringstream value(job.setting("OUTLIERS"));
+			if (!(value >> entry.outliers) || entry.outliers < 0 || entry.outliers > 1) {
+				std::cerr << "Unexpected setting 'outliers=" << job.setting("OUTLIERS") << "' on line " << job.line << " of " << suite << std::endl;
+				exit(-1);
+			}
+		}
+		if (entry.name.empty() || entry.reference.empty()) {
+			std::cerr << "Scene on line " << job.line << " of " << suite << " needs a name and a reference image" << std::endl;
+			exit(-1);
+		}
+		entries.push_back(entry);
+	}
+	return entries;
+}
+
+RegressionSuite::BaselineFile RegressionSuite::readBaseline(const std::string& filename) {
+	BaselineFile baseline{"", 0, std::map<std::string, Baseline>()};
+	std::ifstream fin(filename);
+	std::string line;
+	while (std::getline(fin, line)) {
+		std::stringstream strstream(line);
+		std::string name;
+		Baseline scene{0, 0};
+		if (!(strstream >> name) || name[0] == '#') continue;
+		if (name.compare(0, 6, "build=") == 0) {
+			// The configuration the times were measured with
+			baseline.build = name.substr(6);
+			std::string threads;
+			if (strstream >> threads && threads.compare(0, 8, "threads=") == 0) {
+				baseline.threads = (unsigned int)std::max(0, atoi(threads.c_str() + 8));
+			}
+			continue;
+		}
+		if (strstream >> scene.medianMs >> scene.raysPerSecond && scene.medianMs > 0) {
+			baseline.scenes[name] = scene;
+		}
+	}
+	return baseline;
+}
+
+std::string RegressionSuite::buildType() {
+	const std::string build = RAYTRACER_BUILD_TYPE;
+	return build.empty() ? "default" : build;
+}
+
+RegressionSuite::Result RegressionSuite::render(const Entry& entry, const std::string& directory, unsigned int repeats) {
+	Result result{false, "", std::vector<double>(), 0, PerfCounters::Counts(), std::vector<unsigned char>(), 0, 0};
+
+	Scene scene;
+	if (!entry.job.load(scene, setup_, directory, result.error)) return result;
+	scene.statsFile.clear();
+	scene.freeze();
+
+	// Only the render itself is timed, and each repeat starts from a fresh framebuffer
+	for (unsigned int repeat = 0; repeat < repeats; ++repeat) {
+		ImageDisplay display(entry.name, scene.renderWidth, scene.renderHeight);
+		const std::unique_ptr<PerfCounters> counters(scene.perfCounters ? new PerfCounters() : nullptr);
+		const Clock::time_point start = Clock::now();
+		const RenderStats stats = scene.renderImage(display, pool_, scene.tileOrder);
+		result.renderMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+		if (counters) result.counts += counters->read();
+		result.rays = RenderProgress::totalRays(stats);
+		if (repeat + 1 == repeats) {
+			result.pixels = display.getPixels();
+			result.width = display.width();
+			result.height = display.height();
+		}
+	}
+	std::sort(result.renderMs.begin(), result.renderMs.end());
+	result.ok = true;
+	return result;
+}
+
+bool RegressionSuite::run(const std::string& suite, unsigned int repeats, double threshold, bool update) {
+	const std::vector<Entry> entries = readSuite(suite);
+	const size_t slash = suite.find_last_of('/');
+	const std::string directory = slash == std::string::npos ? "" : suite.substr(0, slash + 1);
+	const size_t dot = suite.find_last_of('.');
+	const std::string baselineFile = (dot == std::string::npos || (slash != std::string::npos && dot < slash) ? suite : suite.substr(0, dot)) + ".baseline";
+	const BaselineFile stored = update ? BaselineFile{"", 0, std::map<std::string, Baseline>()} : readBaseline(baselineFile);
+	repeats = std::max(1u, repeats);
+
+	std::cout << "Benchmarking " << entries.size() << " scene" << (entries.size() == 1 ? "" : "s") << " from " << suite << ", "
+	          << repeats << " render" << (repeats == 1 ? "" : "s") << " each on " << pool_.size() << " thread" << (pool_.size() == 1 ? "" : "s") 
+	          << " (" << buildType() << " build)" << std::endl;
+
+	// Times from another build type or number of threads say nothing about this one
+	std::map<std::string, Baseline> baseline = stored.scenes;
+	if (!update && baseline.empty()) {
+		std::cout << "No baseline in " << baselineFile << ", so times are not checked" << std::endl;
+	} else if (!update && (stored.build != buildType() || stored.threads != pool_.size())) {
+		std::cout << "Baseline in " << baselineFile << " is for a " << (stored.build.empty() ? "unknown" : stored.build) 
+		          << " build on " << stored.threads << " thread" << (stored.threads == 1 ? "" : "s") 
+		          << ", so times are not checked" << std::endl;
+		baseline.clear();
+	}
+
+	size_t passed = 0;
+	std::ostringstream newBaseline;
+	newBaseline << "build=" << buildType() << " threads=" << pool_.size() << std::endl;
+	newBaseline << "# name median_ms rays_per_s" << std::endl;
+	for (const Entry& entry : entries) {
+		std::cout << std::endl;
+		const Result result = render(entry, directory, repeats);
+		if (!result.ok) {
+			std::cout << entry.name << " (line " << entry.job.line << "): FAILED, " << result.error << std::endl;
+			continue;
+		}
+		const double medianMs = median(result.renderMs);
+		const double raysPerSecond = medianMs > 0 ? result.rays / (medianMs / 1000) : 0;
+		std::cout << entry.name << ": " << result.width << "x" << result.height << ", median " << medianMs << "ms (min "
+		          << result.renderMs.front() << "ms, max " << result.renderMs.back() << "ms), "
+		          << result.rays << " rays, " << raysPerSecond / 1e6 << " Mrays/s" << std::endl;
+		if (result.counts.any()) {
+			std::cout << "  counters " << result.counts.summary(double(result.rays) * repeats, "ray") << std::endl;
+			if (!PerfCounters::availability().empty()) std::cout << "  " << PerfCounters::availability() << std::endl;
+		}
+		const std::string referenceFile = SceneJob::relativeTo(directory, entry.reference);
+
+		if (update) {
+			std::vector<unsigned char> file;
+			const bool encoded = encodeImage(ImageFormat::PPM, result.pixels.data(), result.width, result.height, file);
+			std::ofstream fout(referenceFile, std::ios::binary);
+			fout.write(reinterpret_cast<const char*>(file.data()), std::streamsize(file.size()));
+			if (!encoded || !fout) {
+				std::cout << "  could not save reference image " << referenceFile << std::endl;
+				continue;
+			}
+			std::cout << "  saved reference image " << referenceFile << std::endl;
+			newBaseline << entry.name << " " << medianMs << " " << raysPerSecond << std::endl;
+			++passed;
+			continue;
+		}
+
+		// The image must match the reference to within the tolerance
+		bool ok = true;
+		std::ifstream fin(referenceFile, std::ios::binary);
+		const std::vector<unsigned char> file((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+		std::vector<unsigned char> reference;
+		size_t width = 0, height = 0;
+		if (!decodePPM(file, reference, width, height)) {
+			std::cout << "  image: could not read reference image " << referenceFile << ": FAILED" << std::endl;
+			ok = false;
+		} else if (width != result.width || height != result.height) {
+			std::cout << "  image: reference is " << width << "x" << height << ": FAILED" << std::endl;
+			ok = false;
+		} else {
+			int largest = 0;
+			size_t outliers = 0;
+			for (size_t pixel = 0; pixel < width * height; ++pixel) {
+				int difference = 0;
+				for (size_t channel = 3 * pixel; channel < 3 * pixel + 3; ++channel) {
+					difference = std::max(difference, std::abs(int(result.pixels[channel]) - int(reference[channel])));
+				}
+				largest = std::max(largest, difference);
+				if (difference > entry.tolerance) ++outliers;
+			}
+			const bool matches = outliers <= entry.outliers * width * height;
+			std::cout << "  image: largest difference " << largest << " levels, " << outliers << " of " << width * height
+			          << " pixels over " << entry.tolerance << ": " << (matches ? "ok" : "FAILED") << std::endl;
+			ok = ok && matches;
+		}
+
+		// The median time must be within the threshold of the baseline
+		const auto scene = baseline.find(entry.name);
+		if (scene != baseline.end()) {
+			const double change = medianMs / scene->second.medianMs - 1;
+			const bool fastEnough = change <= threshold;
+			std::cout << "  time: baseline " << scene->second.medianMs << "ms, " << std::showpos << std::fixed << std::setprecision(1)
+			          << 100 * change << "% (allowed " << 100 * threshold << "%)" << std::noshowpos << std::defaultfloat << std::setprecision(6)
+			          << ", baseline " << scene->second.raysPerSecond / 1e6 << " Mrays/s: " << (fastEnough ? "ok" : "FAILED") << std::endl;
+			ok = ok && fastEnough;
+		} else if (!baseline.empty()) {
+			std::cout << "  time: not in the baseline" << std::endl;
+		}
+		if (ok) ++passed;
+	}
+
+	if (update) {
+		std::ofstream fout(baselineFile);
+		fout << newBaseline.str();
+		if (!fout) {
+			std::cerr << "Could not save baseline to " << baselineFile << std::endl;
+			return false;
+		}
+		std::cout << std::endl << "Saved baseline to " << baselineFile << std::endl;
+	}
+	std::cout << std::endl << "Benchmark suite: " << passed << " of " << entries.size() << " scenes passed" << std::endl;
+	return passed == entries.size();
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#ifndef REGRESSION_SUITE_H_INCLUDED
+#define REGRESSION_SUITE_H_INCLUDED
+
+#include "NonCopyable.h"
+#include "PerfCounters.h"
+#include "Scene.h"
+#include "SceneJob.h"
+#include "ThreadPool.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/** \file
+ * \brief RegressionSuite class header file.
+ */
+
+/**
+ * \brief Renders a fixed set of scenes as an end-to-end benchmark and regression check.
+ *
+ * Each scene in the suite is rendered several times at a fixed size. The median render
+ * time and the Rays traced per second are reported, and the image is compared with a
+ * stored reference image. The suite fails if any image differs from its reference by
+ * more than a tolerance, or if any median time is slower than a stored baseline by more
+ * than a threshold.
+ *
+ * The suite is listed in a file, one scene per line, read as SceneJobs in the same form as
+ * a BatchRenderer manifest. Each line lists one or more scene files, followed by settings:
+\verbatim
+# Scene files           Settings
+../snowman.txt          name=snowman size=240x160 reference=snowman.ppm
+../objectTest.txt       name=objects size=240x180 reference=objects.ppm tolerance=2
+\endverbatim
+ * Allowed settings are:
+ * - <tt>name=[name]</tt>: The name of the scene in the report and the baseline (required).
+ * - <tt>reference=[file.ppm]</tt>: The reference image, as a binary PPM (required).
+ * - <tt>size=[width]x[height]</tt>: Set the Scene's \c renderWidth and \c renderHeight.
+ * - <tt>samples=[count]</tt>: Set the Scene's \c samplesPerPixel.
+ * - <tt>raydepth=[depth]</tt>: Set the Scene's \c maxRayDepth.
+ * - <tt>tolerance=[levels]</tt>: The largest difference allowed in any 8-bit channel (default 1).
+ * - <tt>outliers=[fraction]</tt>: The fraction of pixels allowed to differ by more than the tolerance (default 0).
+ *
+ * File names are relative to the directory of the suite file. Blank lines, and anything
+ * after a \c #, are ignored.
+ *
+ * The baseline is stored next to the suite file, with the extension \c .baseline.
+ * Its first line gives the build type (CMAKE_BUILD_TYPE) and number of render threads
+ * it was measured with, as <tt>build=[type] threads=[count]</tt>, and there is then one
+ * line per scene giving its name, median milliseconds, and Rays per second. Times are
+ * only comparable between runs of the same build type on the same number of threads,
+ * so if either differs the times are reported but not checked. Running with \c update
+ * set rewrites the reference images and the baseline from the current build, and so
+ * should only be done on the machine the suite is checked on.
+ *
+ * If the Scene setup turns on Scene::perfCounters, the hardware events of the renders
+ * are also counted with PerfCounters, and reported per Ray.
+ */
+class RegressionSuite : private NonCopyable {
+
+public:
+
+	/** \brief RegressionSuite constructor.
+	 *
+	 * \param numThreads The number of threads to render with, or 0 for one per hardware thread.
+	 * \param setup Function to apply default settings to each Scene.
+	 * \param cpus CPUs to pin the threads to (see Scene::threadCpus()), or empty to leave them unpinned.
+	 */
+	RegressionSuite(unsigned int numThreads, const SceneSetup& setup, const std::vector<int>& cpus = std::vector<int>());
+
+	/** \brief RegressionSuite destructor. */
+	~RegressionSuite();
+
+	/** \brief Render every scene in a suite, and report the results.
+	 *
+	 * If the suite file cannot be read, or has errors, the program is terminated.
+	 *
+	 * \param suite The name of the suite file.
+	 * \param repeats The number of times to render each scene.
+	 * \param threshold The fraction by which a median time may exceed the baseline, such as 0.1 for 10%.
+	 * \param update Whether to save new reference images and a new baseline rather than checking against them.
+	 * \return true if every scene rendered and passed its checks.
+	 */
+	bool run(const std::string& suite, unsigned int repeats, double threshold, bool update);
+
+private:
+
+	/** \brief One scene in a suite. */
+	struct Entry {
+		SceneJob job;          //!< Scene files to read, and the settings they share with a BatchRenderer manifest.
+		std::string name;      //!< Name in the report and baseline.
+		std::string reference; //!< Reference image file.
+		int tolerance;         //!< Largest allowed difference in an 8-bit channel.
+		double outliers;       //!< Fraction of pixels allowed to exceed the tolerance.
+	};
+
+	/** \brief Baseline performance of one scene. */
+	struct Baseline {
+		double medianMs;      //!< Median render time in milliseconds.
+		double raysPerSecond; //!< Rays traced per second at the median time.
+	};
+
+	/** \brief The contents of a baseline file. */
+	struct BaselineFile {
+		std::string build;                       //!< Build type the times were measured with, or empty if not given.
+		unsigned int threads;                    //!< Number of render threads the times were measured with, or 0 if not given.
+		std::map<std::string, Baseline> scenes;  //!< Baseline of each scene by name.
+	};
+
+	/** \brief The outcome of rendering one scene. */
+	struct Result {
+		bool ok;                           //!< Whether the scene was read and rendered.
+		std::string error;                 //!< What went wrong, if it was not.
+		std::vector<double> renderMs;      //!< Time of each render, in increasing order.
+		unsigned long long rays;           //!< Rays traced by one render.
+		PerfCounters::Counts counts;       //!< Hardware events over all of the renders, if counted.
+		std::vector<unsigned char> pixels; //!< The rendered image, row by row, with three bytes per pixel.
+		size_t width;                      //!< Width of the image in pixels.
+		size_t height;                     //!< Height of the image in pixels.
+	};
+
+	/** \brief Read the entries from a suite file.
+	 *
+	 * \param suite The name of the suite file.
+	 * \return The entries, in the order listed.
+	 */
+	static std::vector<Entry> readSuite(const std::string& suite);
+
+	/** \brief Read a baseline file.
+	 *
+	 * \param filename The name of the baseline file.
+	 * \return The build, threads, and baseline of each scene, which are empty if there is no file.
+	 */
+	static BaselineFile readBaseline(const std::string& filename);
+
+	/** \brief The build type of this program, as given to CMake.
+	 *
+	 * \return The value of CMAKE_BUILD_TYPE, or "default" if none was given.
+	 */
+	static std::string buildType();
+
+	/** \brief Read and render one scene several times.
+	 *
+	 * \param entry The scene to render.
+	 * \param directory The directory that file names are relative to, ending in a \c /, or empty.
+	 * \param repeats The number of times to render it.
+	 * \return The render times and final image.
+	 */
+	Result render(const Entry& entry, const std::string& directory, unsigned int repeats);
+
+	ThreadPool pool_;  //!< Threads to render with.
+	SceneSetup setup_; //!< Default settings for each Scene.
+};
+
+#endif // REGRESSION_SUITE_H_INCLUDED
@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef RENDER_PROGRESS_H_INCLUDED
+#define RENDER_PROGRESS_H_INCLUDED
+
+#include "RenderStats.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/**
+ * \file
+ * \brief RenderProgress class header file.
+ */
+
+/**
+ * \brief Counters of the work finished so far in a render, shared between threads.
+ *
+ * Render threads add to the counters as they finish each piece of work (a tile, or
+ * a band of rows), and a TelemetryReporter reads them from another thread. The 
+ * counters are atomic, and are only ever added to, so neither side ever waits for
+ * the other.
+ */
+class RenderProgress {
+
+public:
+
+	/** \brief RenderProgress constructor.
+	 *
+	 * \param unit The name of a piece of work, such as "tile" or "row".
+	 * \param unitsTotal The number of pieces of work in the render.
+	 * \param pixelsTotal The number of pixels in the render.
+	 * \param deadline When a render with a time budget must stop, even if not all the pixels are done.
+	 */
+	RenderProgress(const std::string& unit, unsigned long long unitsTotal, unsigned long long pixelsTotal, 
+	               std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max()) :
+		unit(unit), unitsTotal(unitsTotal), pixelsTotal(pixelsTotal), deadline(deadline), unitsDone(0), pixelsDone(0), rays(0) {
+
+	}
+
+	/** \brief Record a finished piece of work.
+	 *
+	 * \param units The number of pieces of work finished.
+	 * \param pixels The number of pixels they covered.
+	 * \param tracedRays The number of Rays traced for them.
+	 */
+	void add(unsigned long long units, unsigned long long pixels, unsigned long long tracedRays) {
+		unitsDone.fetch_add(units, std::memory_order_relaxed);
+		pixelsDone.fetch_add(pixels, std::memory_order_relaxed);
+		rays.fetch_add(tracedRays, std::memory_order_relaxed);
+	}
+
+	/** \brief The number of Rays of every kind counted in a RenderStats.
+	 *
+	 * \param stats The counters to total.
+	 * \return The number of primary, shadow, and reflected Rays.
+	 */
+	static unsigned long long totalRays(const RenderStats& stats) {
+		return stats.primaryRays + stats.shadowRays + stats.reflectedRays;
+	}
+
+	const std::string unit;                     //!< The name of a piece of work.
+	const unsigned long long unitsTotal;        //!< Number of pieces of work in the render.
+	const unsigned long long pixelsTotal;       //!< Number of pixels in the render.
+	const std::chrono::steady_clock::time_point deadline; //!< When the render must stop, or \c time_point::max() if it has no time budget.
+	std::atomic<unsigned long long> unitsDone;  //!< Number of pieces of work finished.
+	std::atomic<unsigned long long> pixelsDone; //!< Number of pixels finished.
+	std::atomic<unsigned long long> rays;       //!< Number of Rays traced in the finished work.
+};
+
+#endif // RENDER_PROGRESS_H_INCLUDED
@@ -0,0 +1,172 @@
+#include "RenderReport.h"
+
+#include <fstream>
+
+#include <sys/resource.h>
+
+RenderReport::RenderReport() :
+	width(0), height(0), views(0), samplesPerPixel(0), threads(0), 
+	parseSeconds(0), buildSeconds(0), renderSeconds(0), encodeSeconds(0),
+	objects(0), materials(0), ambientLights(0), directLights(0), shadowCasterDensity(0), compiledSummary(), shadingKernels(), 
+	russianRoulette(false), workUnit("tile"), stats(), counted(false), buildCounts(), renderCounts(), encodeCounts(),
+	allocationsCounted(false), parseAllocations(), buildAllocations(), renderAllocations(), saveAllocations(), objectMemory() {
+
+}
+
+void RenderReport::describe(const CompiledScene& compiled) {
+	objects = compiled.numObjects();
+	materials = compiled.materials().size();
+	ambientLights = compiled.ambientLights().size();
+	directLights = compiled.directLights().size();
+	shadowCasterDensity = compiled.shadowCasters().density();
+	compiledSummary = compiled.summary();
+	shadingKernels = compiled.materialClasses().summary();
+}
+
+void RenderReport::printRender(std::ostream& out) const {
+	out << "Rendered " << views << " view" << (views == 1 ? "" : "s") << " with " << threads << " thread" << (threads == 1 ? "" : "s") 
+	    << " and " << samplesPerPixel << " sample" << (samplesPerPixel == 1 ? "" : "s") << " per pixel" << std::endl;
+	out << "Screen tiles: " << stats.emptyTiles << " of " << stats.tiles << " filled with background" << std::endl;
+	out << "Compiled scene: " << compiledSummary << std::endl;
+	out << "Shadow rays: tested against " << 100 * shadowCasterDensity << "% of light/receiver/caster combinations" << std::endl;
+	out << "Shading kernels: " << shadingKernels << std::endl;
+	for (size_t node = 0; node < stats.nodes.size(); ++node) {
+		const RenderStats::NodeStats& nodeStats = stats.nodes[node];
+		if (nodeStats.threads == 0) continue;
+		out << "NUMA node " << node << ": " << nodeStats.threads << " thread" << (nodeStats.threads == 1 ? "" : "s") << ", " 
+		    << nodeStats.pixels << " pixels, " << nodeStats.pixels / renderSeconds << " pixels/s (" 
+		    << (nodeStats.busySeconds > 0 ? nodeStats.pixels / nodeStats.busySeconds : 0) << " per busy thread-second)" << std::endl;
+	}
+	out << "Mirror reflections: " << stats.reflectedRays << " traced, " << stats.terminatedPaths 
+	    << " paths terminated early (saving up to " << stats.bouncesSaved << " bounces)";
+	if (russianRoulette) {
+		out << ", " << stats.rouletteSurvivors << " Russian roulette survivors";
+	}
+	out << std::endl;
+	if (counted) {
+		const std::string unavailable = PerfCounters::availability();
+		if (!unavailable.empty()) out << "Hardware counters: " << unavailable << std::endl;
+		out << "Hardware counters (build): " << buildCounts.summary(0, "") << std::endl;
+		out << "Hardware counters (render): " << renderCounts.summary(double(stats.primaryRays + stats.shadowRays + stats.reflectedRays), "ray") << std::endl;
+	}
+}
+
+void RenderReport::printSave(std::ostream& out) const {
+	if (counted) {
+		out << "Hardware counters (encode): " << encodeCounts.summary(0, "") << std::endl;
+	}
+	if (!allocationsCounted) return;
+
+	const double rays = double(stats.primaryRays + stats.shadowRays + stats.reflectedRays);
+	auto printAllocations = [&out](const std::string& phase, const AllocationTracker::Counts& counts) {
+		out << "Allocations (" << phase << "): " << counts.allocations << " blocks, " << counts.bytesAllocated 
+		    << " bytes, peak " << counts.peakBytes << " bytes live";
+	};
+	printAllocations("parse", parseAllocations);
+	out << std::endl;
+	printAllocations("build", buildAllocations);
+	out << std::endl;
+	printAllocations("render", renderAllocations);
+	out << " (" << (rays > 0 ? renderAllocations.allocations / rays : 0) << " blocks and " 
+	    << (rays > 0 ? renderAllocations.bytesAllocated / rays : 0) << " bytes per ray)" << std::endl;
+	printAllocations("save", saveAllocations);
+	out << std::endl;
+
+	size_t objectBytes = 0;
+	out << "Object memory:";
+	for (const ObjectMemory& type : objectMemory) {
+		out << (&type == &objectMemory.front() ? " " : ", ") << type.count << " " << type.type << " (" << type.bytes / type.count << " bytes each)";
+		objectBytes += type.bytes;
+	}
+	const long long compiledBytes = (long long)buildAllocations.bytesAllocated - (long long)buildAllocations.bytesFreed;
+	out << "; " << objectBytes << " bytes, and " << compiledBytes << " bytes of compiled scene (" 
+	    << (objects == 0 ? 0 : compiledBytes / (long long)objects) << " per object)" << std::endl;
+}
+
+void RenderReport::write(std::ostream& out) const {
+	const double busySeconds = stats.tileSecondsTotal;
+	const double available = threads * renderSeconds;
+
+	out << "{\n";
+	out << "  \"image\": {\"width\": " << width << ", \"height\": " << height << ", \"views\": " << views 
+	    << ", \"samples_per_pixel\": " << samplesPerPixel << "},\n";
+	out << "  \"phases_s\": {\"parse\": " << parseSeconds << ", \"build\": " << buildSeconds << ", \"render\": " << renderSeconds 
+	    << ", \"encode\": " << encodeSeconds << ", \"total\": " << parseSeconds + buildSeconds + renderSeconds + encodeSeconds << "},\n";
+	out << "  \"rays\": {\"primary\": " << stats.primaryRays << ", \"shadow\": " << stats.shadowRays << ", \"reflected\": " << stats.reflectedRays 
+	    << ", \"total\": " << stats.primaryRays + stats.shadowRays + stats.reflectedRays << "},\n";
+	out << "  \"paths\": {\"terminated\": " << stats.terminatedPaths << ", \"roulette_survivors\": " << stats.rouletteSurvivors 
+	    << ", \"bounces_saved\": " << stats.bouncesSaved << "},\n";
+	out << "  \"acceleration\": {\"objects\": " << objects << ", \"distinct_materials\": " << materials 
+	    << ", \"ambient_lights\": " << ambientLights << ", \"direct_lights\": " << directLights
+	    << ", \"screen_tiles\": " << stats.tiles << ", \"empty_screen_tiles\": " << stats.emptyTiles 
+	    << ", \"mean_candidates_per_tile\": " << (stats.tiles > 0 ? double(stats.tileCandidates) / stats.tiles : 0)
+	    << ", \"shadow_caster_density\": " << shadowCasterDensity << "},\n";
+	out << "  \"memory\": {\"peak_rss_bytes\": " << peakResidentBytes() << "},\n";
+	out << "  \"threads\": {\"count\": " << threads << ", \"busy_s\": " << busySeconds 
+	    << ", \"utilization\": " << (available > 0 ? busySeconds / available : 0) << ", \"nodes\": [";
+	for (size_t node = 0; node < stats.nodes.size(); ++node) {
+		out << (node > 0 ? ", " : "") << "{\"node\": " << node << ", \"threads\": " << stats.nodes[node].threads 
+		    << ", \"pixels\": " << stats.nodes[node].pixels << ", \"busy_s\": " << stats.nodes[node].busySeconds << "}";
+	}
+	out << "]},\n";
+	out << "  \"work_units\": {\"unit\": \"" << workUnit << "\", \"count\": " << stats.timedTiles 
+	    << ", \"min_s\": " << stats.tileSecondsMin << ", \"max_s\": " << stats.tileSecondsMax 
+	    << ", \"mean_s\": " << (stats.timedTiles > 0 ? stats.tileSecondsTotal / stats.timedTiles : 0) << "}";
+	if (counted) {
+		const std::string unavailable = PerfCounters::availability();
+		out << ",\n  \"counters\": {\"unavailable\": ";
+		if (unavailable.empty()) out << "null"; else out << "\"" << unavailable << "\"";
+		out << ",\n    \"build\": ";
+		buildCounts.writeJson(out, 0, "");
+		out << ",\n    \"render\": ";
+		renderCounts.writeJson(out, double(stats.primaryRays + stats.shadowRays + stats.reflectedRays), "ray");
+		out << ",\n    \"encode\": ";
+		encodeCounts.writeJson(out, 0, "");
+		out << "}";
+	}
+	if (allocationsCounted) {
+		out << ",\n  \"allocations\": {\n    \"parse\": ";
+		parseAllocations.writeJson(out, 0, "");
+		out << ",\n    \"build\": ";
+		buildAllocations.writeJson(out, 0, "");
+		out << ",\n    \"render\": ";
+		renderAllocations.writeJson(out, double(stats.primaryRays + stats.shadowRays + stats.reflectedRays), "ray");
+		out << ",\n    \"save\": ";
+		saveAllocations.writeJson(out, 0, "");
+		out << "}";
+	}
+	size_t objectBytes = 0;
+	for (const ObjectMemory& type : objectMemory) {
+		objectBytes += type.bytes;
+	}
+	out << ",\n  \"scene_memory\": {\"objects\": " << objects << ", \"object_bytes\": " << objectBytes 
+	    << ", \"object_bytes_per_object\": " << (objects > 0 ? double(objectBytes) / objects : 0);
+	if (allocationsCounted) {
+		// What the build kept is the CompiledScene
+		const long long compiledBytes = (long long)buildAllocations.bytesAllocated - (long long)buildAllocations.bytesFreed;
+		out << ", \"compiled_bytes\": " << compiledBytes << ", \"compiled_bytes_per_object\": " << (objects > 0 ? double(compiledBytes) / objects : 0);
+	}
+	out << ", \"types\": [";
+	for (size_t ix = 0; ix < objectMemory.size(); ++ix) {
+		out << (ix > 0 ? ", " : "") << "{\"type\": \"" << objectMemory[ix].type << "\", \"count\": " << objectMemory[ix].count 
+		    << ", \"bytes\": " << objectMemory[ix].bytes << "}";
+	}
+	out << "]}";
+	out << "\n}\n";
+}
+
+bool RenderReport::save(const std::string& filename) const {
+	std::ofstream fout(filename);
+	write(fout);
+	return bool(fout);
+}
+
+unsigned long long RenderReport::peakResidentBytes() {
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+	return (unsigned long long)usage.ru_maxrss; // Already in bytes
+#else
+	return (unsigned long long)usage.ru_maxrss * 1024; // In kilobytes
+#endif
+}
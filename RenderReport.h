@@ -0,0 +1,134 @@
+#pragma once
+
+#ifndef RENDER_REPORT_H_INCLUDED
+#define RENDER_REPORT_H_INCLUDED
+
+#include "AllocationTracker.h"
+#include "CompiledScene.h"
+#include "PerfCounters.h"
+#include "RenderStats.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/** \file
+ * \brief RenderReport class header file.
+ */
+
+/**
+ * \brief Statistics about one render, written as a JSON document.
+ *
+ * Scene::render() fills in a RenderReport as it goes, shows it on the console with
+ * printRender() and printSave(), and saves it to the Scene's statsFile, so that the
+ * cost of every render can be collected by other programs. The document has the form
+ *
+ *     {
+ *       "image": {"width": 800, "height": 600, "views": 1, "samples_per_pixel": 1},
+ *       "phases_s": {"parse": 0.002, "build": 0.001, "render": 4.41, "encode": 0.09, "total": 4.50},
+ *       "rays": {"primary": 480000, "shadow": 1312345, "reflected": 90348, "total": 1882693},
+ *       "paths": {"terminated": 0, "roulette_survivors": 0, "bounces_saved": 0},
+ *       "acceleration": {"objects": 34, ...},
+ *       "memory": {"peak_rss_bytes": 10039296},
+ *       "threads": {"count": 4, "busy_s": 17.5, "utilization": 0.99, "nodes": [...]},
+ *       "work_units": {"unit": "tile", "count": 1900, "min_s": 0.0001, "max_s": 0.02, "mean_s": 0.0092}
+ *     }
+ *
+ * If hardware events were counted, a \c "counters" object is added, with the PerfCounters::Counts
+ * of the build, render, and encode phases (the render's also per Ray), and the reason if they
+ * could not all be counted.
+ *
+ * A \c "scene_memory" object gives an estimate of the memory used by the Objects, by
+ * type. If allocations were counted (see AllocationTracker), an \c "allocations" object
+ * gives them for the parse, build, render (also per Ray), and save phases, and the
+ * memory kept by the CompiledScene is added to \c "scene_memory".
+ */
+class RenderReport {
+
+public:
+
+	/** \brief Estimated memory of the Objects of one type. */
+	struct ObjectMemory {
+		std::string type; //!< The class of the Objects.
+		size_t count;     //!< Number of Objects of the type.
+		size_t bytes;     //!< Their total memory, from Object::memoryBytes().
+	};
+
+	/** \brief RenderReport default constructor. Everything starts at zero. */
+	RenderReport();
+
+	/** \brief Fill in the sizes of a CompiledScene, and the summaries shown by printRender().
+	 *
+	 * \param compiled The CompiledScene that was rendered.
+	 */
+	void describe(const CompiledScene& compiled);
+
+	/** \brief Show what the render did, for the console.
+	 *
+	 * \param out The stream to write to.
+	 */
+	void printRender(std::ostream& out) const;
+
+	/** \brief Show the costs of saving, and of memory, for the console.
+	 *
+	 * \param out The stream to write to.
+	 */
+	void printSave(std::ostream& out) const;
+
+	/** \brief Write the report as JSON.
+	 *
+	 * \param out The stream to write to.
+	 */
+	void write(std::ostream& out) const;
+
+	/** \brief Save the report as a JSON file.
+	 *
+	 * \param filename The file to write, which is replaced if it exists.
+	 * \return true if the file was written, false otherwise.
+	 */
+	bool save(const std::string& filename) const;
+
+	/** \brief The most memory this process has used so far.
+	 *
+	 * \return The peak resident set size in bytes, or 0 if it cannot be found.
+	 */
+	static unsigned long long peakResidentBytes();
+
+	unsigned int width;           //!< Width of the image in pixels.
+	unsigned int height;          //!< Height of the image in pixels.
+	unsigned int views;           //!< Number of views rendered.
+	unsigned int samplesPerPixel; //!< Samples traced for each pixel.
+	unsigned int threads;         //!< Number of render threads.
+
+	double parseSeconds;          //!< Time taken to read the Scene description.
+	double buildSeconds;          //!< Time taken to build the CompiledScene.
+	double renderSeconds;         //!< Time taken to render the views.
+	double encodeSeconds;         //!< Time taken to encode and save the images.
+
+	size_t objects;               //!< Number of Objects in the Scene.
+	size_t materials;             //!< Number of distinct Materials.
+	size_t ambientLights;         //!< Number of ambient LightSources.
+	size_t directLights;          //!< Number of shadow casting LightSources.
+	double shadowCasterDensity;   //!< Fraction of light/receiver/caster combinations tested by shadow Rays.
+	std::string compiledSummary;  //!< One line summary of the CompiledScene.
+	std::string shadingKernels;   //!< One line summary of the shading kernels used by the Materials.
+
+	bool russianRoulette;         //!< Whether faint reflections were traced by Russian roulette.
+
+	std::string workUnit;         //!< What the work was shared out in, such as "tile".
+	RenderStats stats;            //!< Counters from the render.
+
+	bool counted;                 //!< Whether hardware events were counted.
+	PerfCounters::Counts buildCounts;  //!< Hardware events while building the CompiledScene.
+	PerfCounters::Counts renderCounts; //!< Hardware events while rendering.
+	PerfCounters::Counts encodeCounts; //!< Hardware events while encoding and saving the images.
+
+	bool allocationsCounted;                     //!< Whether allocations were counted.
+	AllocationTracker::Counts parseAllocations;  //!< Allocations while reading the Scene description.
+	AllocationTracker::Counts buildAllocations;  //!< Allocations while building the CompiledScene.
+	AllocationTracker::Counts renderAllocations; //!< Allocations while rendering.
+	AllocationTracker::Counts saveAllocations;   //!< Allocations while encoding and saving the images.
+	std::vector<ObjectMemory> objectMemory;      //!< Estimated memory of the Objects, by type.
+};
+
+#endif // RENDER_REPORT_H_INCLUDED
@@ -0,0 +1,284 @@
+#include "RenderServer.h"
+
+#include "ImageDisplay.h"
+#include "SceneReader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+	typedef std::chrono::steady_clock Clock;
+
+	const size_t maxSceneBytes = 16 << 20;         // Largest scene description accepted
+	const size_t maxHeaderBytes = 256;             // Longest request line accepted
+	const size_t maxImagePixels = size_t(8) << 20; // Largest width x height accepted, about 130MB of framebuffer
+	const int socketTimeoutSeconds = 10;           // Longest wait for any one read or write on a connection
+	const std::chrono::seconds requestTimeout(30); // Longest time to read a whole request
+
+	/** \brief Read exactly \c size bytes from a socket. Returns false on error, end of file, or once the deadline has passed. */
+	bool readFully(int connection, char* data, size_t size, Clock::time_point deadline) {
+		while (size > 0) {
+			if (Clock::now() > deadline) return false;
+			ssize_t n = recv(connection, data, size, 0);
+			if (n <= 0) return false;
+			data += n;
+			size -= size_t(n);
+		}
+		return true;
+	}
+
+	/** \brief Write all of \c size bytes to a socket. Returns false on error. */
+	bool writeFully(int connection, const char* data, size_t size) {
+		while (size > 0) {
+			ssize_t n = send(connection, data, size, MSG_NOSIGNAL);
+			if (n <= 0) return false;
+			data += n;
+			size -= size_t(n);
+		}
+		return true;
+	}
+
+	/** \brief Read one line (without the newline) from a socket. Returns false on error, if the line is too long, or once the deadline has passed. */
+	bool readLine(int connection, std::string& line, Clock::time_point deadline) {
+		line.clear();
+		char c;
+		while (line.size() < maxHeaderBytes) {
+			if (!readFully(connection, &c, 1, deadline)) return false;
+			if (c == '\n') return true;
+			line += c;
+		}
+		return false;
+	}
+
+	/** \brief Milliseconds between two times. */
+	double millisecondsBetween(Clock::time_point start, Clock::time_point end) {
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	/** \brief Stop reads and writes on a connection from blocking for longer than socketTimeoutSeconds. */
+	void setTimeouts(int connection) {
+		timeval timeout;
+		timeout.tv_sec = socketTimeoutSeconds;
+		timeout.tv_usec = 0;
+		setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	}
+
+	/** \brief Whether the process at the other end of a connection runs as the same user as this one. */
+	bool fromSameUser(int connection) {
+#ifdef __linux__
+		ucred credentials;
+		socklen_t length = sizeof(credentials);
+		return getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0 && credentials.uid == geteuid();
+#else
+		uid_t uid;
+		gid_t gid;
+		return getpeereid(connection, &uid, &gid) == 0 && uid == geteuid();
+#endif
+	}
+
+}
+
+RenderServer::RenderServer(const std::string& socketPath, unsigned int numThreads, unsigned int maxConnections,
+                           size_t maxQueued, const SceneSetup& setup, const std::vector<int>& cpus) :
+	socketPath_(socketPath), listener_(-1), setup_(setup), pool_(numThreads, cpus), maxQueued_(maxQueued),
+	mutex_(), wake_(), queue_(), stopping_(false), handlers_() {
+
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path)) {
+		std::cerr << "Socket path '" << socketPath << "' is too long" << std::endl;
+		exit(-1);
+	}
+	std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+	unlink(socketPath.c_str());
+	listener_ = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener_ < 0 || bind(listener_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener_, 64) != 0) {
+		std::cerr << "Could not listen on '" << socketPath << "': " << std::strerror(errno) << std::endl;
+		exit(-1);
+	}
+
+	for (unsigned int i = 0; i < std::max(1u, maxConnections); ++i) {
+		handlers_.emplace_back(&RenderServer::handleConnections, this);
+	}
+}
+
+RenderServer::~RenderServer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	for (auto& handler : handlers_) {
+		handler.join();
+	}
+	close(listener_);
+	unlink(socketPath_.c_str());
+}
+
+void RenderServer::run() {
+	std::cout << "Listening on " << socketPath_ << " with " << pool_.size() << " render thread"
+	          << (pool_.size() == 1 ? "" : "s") << std::endl;
+	while (true) {
+		int connection = accept(listener_, nullptr, nullptr);
+		if (connection < 0) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (stopping_) break;
+			continue;
+		}
+		// A client which stalls must not hold a handler (or this thread) indefinitely
+		setTimeouts(connection);
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (stopping_) {
+			lock.unlock();
+			sendError(connection, "server is stopping");
+			close(connection);
+		} else if (queue_.size() >= maxQueued_) {
+			// Turn the request away now, rather than leaving it to wait indefinitely
+			lock.unlock();
+			sendError(connection, "server is busy");
+			close(connection);
+		} else {
+			queue_.push_back(Pending{connection, Clock::now()});
+			lock.unlock();
+			wake_.notify_one();
+		}
+	}
+}
+
+void RenderServer::handleConnections() {
+	while (true) {
+		Pending pending;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+			if (queue_.empty()) return; // Stopping, and nothing left to do
+			pending = queue_.front();
+			queue_.pop_front();
+		}
+		handle(pending.connection, millisecondsBetween(pending.accepted, Clock::now()));
+		close(pending.connection);
+	}
+}
+
+void RenderServer::handle(int connection, double queueMs) {
+	const Clock::time_point start = Clock::now();
+	const Clock::time_point deadline = start + requestTimeout;
+
+	std::string header;
+	if (!readLine(connection, header, deadline)) {
+		sendError(connection, "could not read request");
+		return;
+	}
+	std::istringstream request(header);
+	std::string command, format;
+	size_t length = 0;
+	request >> command;
+	if (command == "STOP") {
+		if (!fromSameUser(connection)) {
+			sendError(connection, "STOP is only accepted from the user running the server");
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		// Wake the accept() in run()
+		shutdown(listener_, SHUT_RDWR);
+		writeFully(connection, "OK\n", 3);
+		return;
+	}
+	if (command != "RENDER" || !(request >> format >> length) || (format != "png" && format != "raw")) {
+		sendError(connection, "expected 'RENDER png|raw [length]' or 'STOP'");
+		return;
+	}
+	if (length > maxSceneBytes) {
+		sendError(connection, "scene is too large");
+		return;
+	}
+	std::string sceneText(length, '\0');
+	if (length > 0 && !readFully(connection, &sceneText[0], length, deadline)) {
+		sendError(connection, "could not read scene");
+		return;
+	}
+
+	// Parse
+	Scene scene;
+	setup_(scene);
+	scene.showProgress = false;
+	try {
+		SceneReader reader(&scene, false);
+		std::istringstream in(sceneText);
+		reader.read(in, "request");
+	} catch (const std::runtime_error& error) {
+		sendError(connection, error.what());
+		return;
+	}
+	if (!scene.hasCamera()) {
+		sendError(connection, "cannot render a scene with no camera");
+		return;
+	}
+	const size_t numViews = scene.getViews().size();
+	if (numViews > 1) {
+		sendError(connection, "scene has " + std::to_string(numViews) + " views, but a request can only return one image");
+		return;
+	}
+	if (scene.renderWidth == 0 || scene.renderHeight == 0 || size_t(scene.renderWidth) * scene.renderHeight > maxImagePixels) {
+		sendError(connection, "unsupported render size");
+		return;
+	}
+	const Clock::time_point parsed = Clock::now();
+
+	// Render
+	ImageDisplay display("Render", scene.renderWidth, scene.renderHeight);
+	if (scene.timeBudgetMs > 0) {
+		scene.renderWithinBudget(display, pool_);
+	} else {
+		scene.renderImage(display, pool_);
+	}
+	const Clock::time_point rendered = Clock::now();
+
+	// Encode
+	std::vector<unsigned char> png;
+	if (format == "png" && !display.encode(ImageFormat::PNG, png, &pool_)) {
+		sendError(connection, "could not encode image");
+		return;
+	}
+	const std::vector<unsigned char>& image = format == "png" ? png : display.getPixels();
+	const Clock::time_point encoded = Clock::now();
+
+	std::ostringstream reply;
+	reply << "OK " << format << " " << scene.renderWidth << " " << scene.renderHeight << " " << image.size()
+	      << " queue_ms=" << queueMs
+	      << " parse_ms=" << millisecondsBetween(start, parsed)
+	      << " render_ms=" << millisecondsBetween(parsed, rendered)
+	      << " encode_ms=" << millisecondsBetween(rendered, encoded)
+	      << " total_ms=" << queueMs + millisecondsBetween(start, encoded) << "\n";
+	const std::string replyHeader = reply.str();
+	if (writeFully(connection, replyHeader.data(), replyHeader.size())) {
+		writeFully(connection, reinterpret_cast<const char*>(image.data()), image.size());
+	}
+
+	std::cout << "Rendered " << scene.renderWidth << "x" << scene.renderHeight << " " << format << ": "
+	          << replyHeader.substr(replyHeader.find("queue_ms"));
+}
+
+void RenderServer::sendError(int connection, const std::string& message) {
+	const std::string reply = "ERROR " + message + "\n";
+	writeFully(connection, reply.data(), reply.size());
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#ifndef RENDER_SERVER_H_INCLUDED
+#define RENDER_SERVER_H_INCLUDED
+
+#include "NonCopyable.h"
+#include "Scene.h"
+#include "SceneJob.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** \file
+ * \brief RenderServer class header file.
+ */
+
+/**
+ * \brief A long-running server which renders scenes sent over a UNIX domain socket.
+ *
+ * Starting a new process for each image means reading the scene, starting threads,
+ * and allocating buffers every time. A RenderServer does this once, then accepts
+ * connections on a UNIX domain socket. Each connection carries one request:
+\verbatim
+RENDER [format] [length]
+[length bytes of scene description]
+\endverbatim
+ * where the scene description is in the format read by SceneReader, and format is
+ * either \c png (a PNG file) or \c raw (rows of 8-bit red, green, blue values).
+ * The reply is a single header line followed by the image:
+\verbatim
+OK [format] [width] [height] [length] queue_ms=[t] parse_ms=[t] render_ms=[t] encode_ms=[t] total_ms=[t]
+[length bytes of image data]
+\endverbatim
+ * or <tt>ERROR [message]</tt> if the request could not be handled (for example, if the
+ * scene could not be parsed, or the server is too busy). Since a reply holds one image,
+ * scenes with more than one view (see Scene::addCamera()) are refused, as are images of
+ * more than 8M pixels. A request of \c STOP shuts the server down once the requests
+ * already accepted have been answered, but only if it comes from a process of the user
+ * running the server.
+ *
+ * Each read or write on a connection times out after 10s, and the whole request must
+ * arrive within 30s, so clients which stall cannot hold the handlers indefinitely.
+ *
+ * Accepted connections wait in a bounded queue, and a fixed number of handler threads
+ * take them from the queue. Several requests can be in progress at once, and they all
+ * render on a single shared ThreadPool. If the queue is full, new connections are
+ * answered with an error straight away, rather than being left to wait.
+ */
+class RenderServer : private NonCopyable {
+
+public:
+
+	/** \brief RenderServer constructor.
+	 *
+	 * This creates the socket and starts the worker threads, but does not accept
+	 * any connections until run() is called. If the socket cannot be created the
+	 * program is terminated.
+	 *
+	 * \param socketPath The path of the UNIX domain socket to listen on. Any existing file at this path is removed.
+	 * \param numThreads The number of threads to render with, or 0 for one per hardware thread.
+	 * \param maxConnections The number of requests to handle at the same time.
+	 * \param maxQueued The number of accepted connections that may wait for a handler.
+	 * \param setup Function to apply default settings to each Scene.
+	 * \param cpus CPUs to pin the render threads to (see Scene::threadCpus()), or empty to leave them unpinned.
+	 */
+	RenderServer(const std::string& socketPath, unsigned int numThreads, unsigned int maxConnections,
+	             size_t maxQueued, const SceneSetup& setup, const std::vector<int>& cpus = std::vector<int>());
+
+	/** \brief RenderServer destructor.
+	 *
+	 * Stops the handler threads and removes the socket.
+	 */
+	~RenderServer();
+
+	/** \brief Accept and handle requests until a \c STOP request is received. */
+	void run();
+
+private:
+
+	/** \brief The main loop of each handler thread. */
+	void handleConnections();
+
+	/** \brief Read a request from a connection, and send the reply.
+	 *
+	 * \param connection The socket for the connection.
+	 * \param queueMs The time (in milliseconds) that the connection waited in the queue.
+	 */
+	void handle(int connection, double queueMs);
+
+	/** \brief Send an error reply on a connection.
+	 *
+	 * \param connection The socket for the connection.
+	 * \param message A description of the error.
+	 */
+	static void sendError(int connection, const std::string& message);
+
+	/** \brief A connection waiting to be handled. */
+	struct Pending {
+		int connection;  //!< The socket for the connection.
+		std::chrono::steady_clock::time_point accepted; //!< When the connection was accepted.
+	};
+
+	std::string socketPath_; //!< Path of the UNIX domain socket.
+	int listener_;           //!< The listening socket.
+	SceneSetup setup_;       //!< Default settings for each Scene.
+	ThreadPool pool_;        //!< Threads shared by all of the renders.
+	size_t maxQueued_;       //!< Maximum number of connections waiting for a handler.
+
+	std::mutex mutex_;                  //!< Protects queue_ and stopping_.
+	std::condition_variable wake_;      //!< Signalled when a connection is queued or the server is stopping.
+	std::deque<Pending> queue_;         //!< Connections waiting for a handler.
+	bool stopping_;                     //!< Set when the server should stop.
+	std::vector<std::thread> handlers_; //!< Threads which handle requests.
+};
+
+#endif // RENDER_SERVER_H_INCLUDED
@@ -0,0 +1,99 @@
+#pragma once
+
+#ifndef RENDER_STATS_H_INCLUDED
+#define RENDER_STATS_H_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/**
+ * \file
+ * \brief RenderStats class header file.
+ */
+
+/**
+ * \brief Counters collected while rendering a Scene.
+ *
+ * A RenderStats object is passed down through the ray tracing code, and 
+ * each counter is incremented as the corresponding event happens. Counters
+ * from different parts of an image can be combined with \c +=.
+ */
+class RenderStats {
+
+public:
+
+	/** \brief Work done by the render threads on one NUMA node. */
+	struct NodeStats {
+		unsigned int threads;      //!< Number of render threads on the node.
+		unsigned long long pixels; //!< Number of pixels rendered by those threads.
+		double busySeconds;        //!< Time spent rendering, summed over those threads.
+	};
+
+	/** \brief RenderStats default constructor. All counters start at zero. */
+	RenderStats() : primaryRays(0), shadowRays(0), reflectedRays(0), terminatedPaths(0), rouletteSurvivors(0), bouncesSaved(0), tiles(0), emptyTiles(0), tileCandidates(0), 
+		timedTiles(0), tileSecondsTotal(0), tileSecondsMin(0), tileSecondsMax(0), nodes() {
+
+	}
+
+	/** \brief Add the counters from another RenderStats to \c this.
+	 *
+	 * \param stats The counters to add.
+	 * \return A reference to \c this to allow for chaining of assignment.
+	 */
+	RenderStats& operator+=(const RenderStats& stats) {
+		primaryRays += stats.primaryRays;
+		shadowRays += stats.shadowRays;
+		reflectedRays += stats.reflectedRays;
+		terminatedPaths += stats.terminatedPaths;
+		rouletteSurvivors += stats.rouletteSurvivors;
+		bouncesSaved += stats.bouncesSaved;
+		tiles += stats.tiles;
+		emptyTiles += stats.emptyTiles;
+		tileCandidates += stats.tileCandidates;
+		if (stats.timedTiles > 0) {
+			tileSecondsMin = timedTiles > 0 ? std::min(tileSecondsMin, stats.tileSecondsMin) : stats.tileSecondsMin;
+			tileSecondsMax = timedTiles > 0 ? std::max(tileSecondsMax, stats.tileSecondsMax) : stats.tileSecondsMax;
+			timedTiles += stats.timedTiles;
+			tileSecondsTotal += stats.tileSecondsTotal;
+		}
+		if (nodes.size() < stats.nodes.size()) {
+			nodes.resize(stats.nodes.size(), NodeStats{0, 0, 0});
+		}
+		for (size_t node = 0; node < stats.nodes.size(); ++node) {
+			nodes[node].threads += stats.nodes[node].threads;
+			nodes[node].pixels += stats.nodes[node].pixels;
+			nodes[node].busySeconds += stats.nodes[node].busySeconds;
+		}
+		return *this;
+	}
+
+	/** \brief Add the time taken by one tile (or other piece of work) to the tile timings.
+	 *
+	 * \param seconds The time taken.
+	 */
+	void addTileTime(double seconds) {
+		tileSecondsMin = timedTiles > 0 ? std::min(tileSecondsMin, seconds) : seconds;
+		tileSecondsMax = timedTiles > 0 ? std::max(tileSecondsMax, seconds) : seconds;
+		++timedTiles;
+		tileSecondsTotal += seconds;
+	}
+
+	unsigned long long primaryRays;       //!< Number of Rays traced from the Camera.
+	unsigned long long shadowRays;        //!< Number of Rays traced towards LightSources.
+	unsigned long long reflectedRays;     //!< Number of mirror reflection Rays traced.
+	unsigned long long terminatedPaths;   //!< Number of mirror hits whose reflection was not traced because it could not contribute.
+	unsigned long long rouletteSurvivors; //!< Number of low-contribution reflections traced (and reweighted) by Russian roulette.
+	unsigned long long bouncesSaved;      //!< Upper bound on the reflection Rays saved by terminated paths.
+	unsigned long long tiles;             //!< Number of tiles the image is divided into.
+	unsigned long long emptyTiles;        //!< Number of image tiles which no Object can appear in.
+	unsigned long long tileCandidates;    //!< Total length of the per-tile lists of Objects that primary Rays can hit.
+	unsigned long long timedTiles;        //!< Number of tiles (or bands of rows, with a WavefrontRenderer) timed.
+	double tileSecondsTotal;              //!< Total time taken by the timed tiles.
+	double tileSecondsMin;                //!< Shortest time taken by a timed tile.
+	double tileSecondsMax;                //!< Longest time taken by a timed tile.
+	std::vector<NodeStats> nodes;         //!< Work done on each NUMA node, if it was measured.
+
+};
+
+#endif // RENDER_STATS_H_INCLUDED
@@ -1,14 +1,95 @@
 #include "Scene.h"
 
+#include "CacheModel.h"
 #include "Colour.h"
+#include "Denoiser.h"
 #include "ImageDisplay.h"
+#include "ScreenFootprints.h"
+#include "RayQueue.h"
+#include "RenderProgress.h"
+#include "RenderReport.h"
+#include "ShadowCasters.h"
+#include "TelemetryReporter.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "WavefrontRenderer.h"
 #include "utility.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
 #include <float.h>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <typeinfo>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+namespace {
+
+	/** \brief Diffuse and specular lighting computed with Colour and Vector, as Scene::addDirectLighting() was
+	 *         before it used PackedColour. Kept as the baseline for Scene::benchmarkShading().
+	 */
+	void addDirectLightingReference(const LightSource& light, const RayIntersection& hitPoint, const Ray& ray, Colour& hitColour) {
+		auto toUnitVector = [](const Vector vec) {
+			Vector resultVector = Vector(vec);
+			double vecLen = vec.norm();
+			if (vecLen != 1) {
+				resultVector(0) = vec(0)/vecLen;
+				resultVector(1) = vec(1)/vecLen;
+				resultVector(2) = vec(2)/vecLen;
+			}
+			return resultVector;
+		};
+
+		Colour lightAtHitPoint = light.getIlluminationAt(hitPoint.point).toColour();
+		Vector unitLightDir = toUnitVector(light.getLightDirection(hitPoint.point));
+		Vector hitUnitNormal = toUnitVector(hitPoint.normal);
+		Colour diffuseColour = lightAtHitPoint * hitPoint.material.diffuseColour * hitUnitNormal.dot(-unitLightDir);
+		if (hitUnitNormal.dot(-unitLightDir) > 0) hitColour += diffuseColour;
+
+		Vector dirTowardsViewer = toUnitVector(ray.direction);
+		Colour specColour = (lightAtHitPoint * hitPoint.material.specularColour) * pow(dirTowardsViewer.dot(-unitLightDir), hitPoint.material.specularExponent);
+		if (unitLightDir.dot(dirTowardsViewer) < 0) hitColour += specColour;
+	}
+
+	/** \brief The readable name of an Object's class, such as "Sphere". */
+	std::string typeName(const Object& object) {
+		const char* name = typeid(object).name();
+#ifdef __GNUG__
+		int status = 0;
+		const std::unique_ptr<char, void(*)(void*)> demangled(abi::__cxa_demangle(name, nullptr, nullptr, &status), std::free);
+		if (status == 0) return demangled.get();
+#endif
+		return name;
+	}
+
+	/** \brief Estimate the memory used by each type of Object, in the order each type first appears. */
+	std::vector<RenderReport::ObjectMemory> estimateObjectMemory(const std::vector<std::shared_ptr<Object>>& objects) {
+		std::vector<RenderReport::ObjectMemory> types;
+		for (const auto& object : objects) {
+			const std::string type = typeName(*object);
+			size_t ix = 0;
+			while (ix < types.size() && types[ix].type != type) ++ix;
+			if (ix == types.size()) types.push_back(RenderReport::ObjectMemory{type, 0, 0});
+			++types[ix].count;
+			types[ix].bytes += object->memoryBytes();
+		}
+		return types;
+	}
+
+}
 
 // For demos
 
-Scene::Scene() : backgroundColour(0,0,0), ambientLight(0,0,0), maxRayDepth(3), renderWidth(800), renderHeight(600), filename("render.png"), camera_(), objects_(), lights_() {
+Scene::Scene() : backgroundColour(0,0,0), ambientLight(0,0,0), maxRayDepth(3), minContribution(0.5 / 255), russianRoulette(false), hdr(false), toneMapping(), denoise(false), fastMath(false), wavefront(false), telemetryFd(-1), telemetryIntervalMs(1000), statsFile(), parseSeconds(0), perfCounters(false), parseAllocations(), costHeatmap(CostMetric::None), tileOrder(TileOrder::Scanline), framebufferLayout(FramebufferLayout::RowMajor), numThreads(0), threadAffinity(ThreadAffinity::None), numaPlacement(NumaPlacement::Local), hugePages(HugePages::None), samplesPerPixel(1), showProgress(true), timeBudgetMs(0), renderWidth(800), renderHeight(600), filename("render.png"), camera_(), views_(), objects_(), lights_(), compiledMutex_(), compiled_(), buildSeconds_(0), buildCounts_(), buildAllocations_(), replicas_() {
 
 }
 
@@ -21,135 +102,1012 @@ auto printPoint = [](Vector vec, std::string varName) {
 };
 
 
-void Scene::render() const {
+bool Scene::render() const {
+	ThreadPool pool(numThreads, threadCpus());
+
+	// One ImageDisplay per view, all sharing the Objects, Materials, and shadow caster lists
+	const std::vector<View> views = getViews();
+	std::vector<std::unique_ptr<ImageDisplay>> displays;
+	std::vector<const Camera*> cameras;
+	std::vector<ImageDisplay*> displayPointers;
+	for (const View& view : views) {
+		displays.emplace_back(new ImageDisplay(view.name.empty() ? "Render" : view.name, renderWidth, renderHeight));
+		cameras.push_back(view.camera.get());
+		displayPointers.push_back(displays.back().get());
+	}
+
+	// The WavefrontRenderer traces many pixels at once, so only the recursive renderer measures each pixel
+	std::vector<std::unique_ptr<CostHeatmap>> heatmaps;
+	std::vector<CostHeatmap*> heatmapPointers;
+	if (costHeatmap != CostMetric::None && (!wavefront || timeBudgetMs > 0)) {
+		for (size_t ix = 0; ix < views.size(); ++ix) {
+			heatmaps.emplace_back(new CostHeatmap(costHeatmap, renderWidth, renderHeight, ScreenFootprints::defaultTileSize));
+			heatmapPointers.push_back(heatmaps.back().get());
+		}
+	}
+
+	// Build the CompiledScene first, so that its cost is not counted as rendering
+	freeze();
+	RenderReport report = startReport((unsigned int)views.size(), pool.size());
+
+	typedef std::chrono::steady_clock Clock;
+	std::unique_ptr<PerfCounters> counters(perfCounters ? new PerfCounters() : nullptr);
+	std::unique_ptr<AllocationTracker::Phase> allocations(new AllocationTracker::Phase());
+	const Clock::time_point start = Clock::now();
+	RenderStats stats;
+	if (timeBudgetMs > 0) {
+		// The views share one budget, each taking an equal part of the time left when it starts
+		const Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(timeBudgetMs));
+		for (size_t ix = 0; ix < views.size(); ++ix) {
+			const Clock::time_point viewStart = Clock::now();
+			const Clock::time_point viewDeadline = viewStart + (deadline - viewStart) / (long long)(views.size() - ix);
+			stats += renderUntil(*cameras[ix], *displayPointers[ix], pool, viewDeadline, heatmaps.empty() ? nullptr : heatmapPointers[ix]);
+		}
+	} else {
+		stats = renderViews(cameras, displayPointers, pool, tileOrder, 0, heatmapPointers);
+	}
+	report.renderSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+	report.stats = stats;
+	if (counters) report.renderCounts = counters->read();
+	report.renderAllocations = allocations->counts();
+	std::cout << std::endl;
+	report.printRender(std::cout);
+
+	if (perfCounters) counters.reset(new PerfCounters());
+	allocations.reset(new AllocationTracker::Phase());
+	const Clock::time_point encodeStart = Clock::now();
+	bool saved = true;
+	for (size_t ix = 0; ix < views.size(); ++ix) {
+		if (views.size() > 1) {
+			std::cout << "Saving " << (views[ix].name.empty() ? "default" : views[ix].name) << " view to " << views[ix].filename << std::endl;
+		}
+		saved = displays[ix]->save(views[ix].filename, &pool) && saved;
+	}
+	report.encodeSeconds = std::chrono::duration<double>(Clock::now() - encodeStart).count();
+	if (counters) report.encodeCounts = counters->read();
+	report.saveAllocations = allocations->counts();
+	report.printSave(std::cout);
+
+	if (costHeatmap != CostMetric::None && heatmaps.empty()) {
+		std::cout << "Cost heatmap: pixels are not measured by the wavefront renderer" << std::endl;
+	}
+	for (size_t ix = 0; ix < heatmaps.size(); ++ix) {
+		const std::string imageFile = CostHeatmap::filenameFor(views[ix].filename, "heatmap");
+		const std::string tileFile = CostHeatmap::filenameFor(views[ix].filename, "heatmap", "csv");
+		std::cout << "Cost heatmap" << (views.size() > 1 ? " (" + (views[ix].name.empty() ? std::string("default") : views[ix].name) + ")" : "") 
+		          << ": " << heatmaps[ix]->summary() << std::endl;
+		if (heatmaps[ix]->save(imageFile, &pool) && heatmaps[ix]->saveTiles(tileFile)) {
+			std::cout << "Saved cost heatmap to " << imageFile << " and tile costs to " << tileFile << std::endl;
+		} else {
+			std::cerr << "Could not save cost heatmap to " << imageFile << " and " << tileFile << std::endl;
+			saved = false;
+		}
+	}
+	if (!statsFile.empty() && !report.save(statsFile)) {
+		std::cerr << "Could not save statistics to " << statsFile << std::endl;
+		saved = false;
+	}
+	displays[0]->pause(5);
+	return saved;
+}
+
+RenderReport Scene::startReport(unsigned int views, unsigned int threads) const {
+	RenderReport report;
+	report.width = renderWidth;
+	report.height = renderHeight;
+	report.views = views;
+	report.samplesPerPixel = samplesPerPixel;
+	report.threads = threads;
+	report.parseSeconds = parseSeconds;
+	report.buildSeconds = buildSeconds_;
+	report.describe(*compiled_);
+	report.russianRoulette = russianRoulette;
+	report.workUnit = wavefront && timeBudgetMs <= 0 ? "row band" : "tile";
+	report.counted = perfCounters;
+	report.buildCounts = buildCounts_;
+	report.allocationsCounted = AllocationTracker::enabled();
+	report.parseAllocations = parseAllocations;
+	report.buildAllocations = buildAllocations_;
+	report.objectMemory = estimateObjectMemory(objects_);
+	return report;
+}
+
+RenderStats Scene::renderImage(ImageDisplay& display, ThreadPool& pool, TileOrder order, uint64_t orderSeed) const {
+	return renderImage(*getViews().front().camera, display, pool, order, orderSeed);
+}
+
+RenderStats Scene::renderImage(const Camera& camera, ImageDisplay& display, ThreadPool& pool, TileOrder order, uint64_t orderSeed) const {
+	return renderViews(std::vector<const Camera*>(1, &camera), std::vector<ImageDisplay*>(1, &display), pool, order, orderSeed);
+}
+
+RenderStats Scene::renderViews(const std::vector<const Camera*>& cameras, const std::vector<ImageDisplay*>& displays, 
+                               ThreadPool& pool, TileOrder order, uint64_t orderSeed, const std::vector<CostHeatmap*>& heatmaps) const {
+	freeze();
+	TRACE_SCOPE("render", "Scene::renderViews");
+	for (ImageDisplay* display : displays) {
+		if (display->layout() != framebufferLayout) display->setLayout(framebufferLayout);
+		display->setToneMapping(toneMapping);
+		if (denoise) display->enableFeatures();
+	}
+
+	// Find which Objects primary Rays can hit in each tile of each view
+	std::vector<std::unique_ptr<ScreenFootprints>> footprints;
+	for (const Camera* camera : cameras) {
+		footprints.emplace_back(new ScreenFootprints(*camera, objects_, renderWidth, renderHeight));
+	}
+
+	// Each worker counts into its own RenderStats, and they are summed at the end. 
+	// Since the counts are integers, the totals do not depend on which worker did what.
+	// Each worker also times its own work, under the NUMA node it runs on.
+	std::vector<RenderStats> threadStats(pool.size());
+	for (unsigned int worker = 0; worker < pool.size(); ++worker) {
+		threadStats[worker].nodes.resize(pool.nodeOf(worker) + 1, RenderStats::NodeStats{0, 0, 0});
+		threadStats[worker].nodes.back().threads = 1;
+	}
+	typedef std::chrono::steady_clock Clock;
+
+	// Progress is published through atomic counters, which a background thread reports
+	std::unique_ptr<RenderProgress> progress;
+	std::unique_ptr<TelemetryReporter> reporter;
+	auto startReporting = [&](const std::string& unit, size_t units) {
+		progress.reset(new RenderProgress(unit, units, (unsigned long long)renderWidth * renderHeight * cameras.size()));
+		reporter.reset(new TelemetryReporter(*progress, telemetryFd, showProgress, telemetryIntervalMs));
+	};
+
+	// All of the views are shared out as one loop, so no thread is left idle between views
+	if (wavefront) {
+		// Each worker traces whole bands of rows with its own WavefrontRenderer for each view
+		std::vector<std::unique_ptr<WavefrontRenderer>> renderers;
+		for (size_t view = 0; view < cameras.size(); ++view) {
+			for (unsigned int i = 0; i < pool.size(); ++i) {
+				renderers.emplace_back(new WavefrontRenderer(*this, *footprints[view]));
+			}
+		}
+		const unsigned int rowsPerBatch = renderers[0]->rowsPerBatch();
+		const unsigned int numBatches = (renderHeight + rowsPerBatch - 1) / rowsPerBatch;
+		std::vector<unsigned int> batches;
+		for (unsigned int view = 0; view < cameras.size(); ++view) {
+			for (unsigned int batch : orderTiles(order, 1, numBatches, orderSeed)) {
+				batches.push_back(view*numBatches + batch);
+			}
+		}
+		startReporting("row band", batches.size());
+		pool.parallelFor(batches.size(), [&](size_t i, unsigned int worker) {
+			const Clock::time_point start = Clock::now();
+			const unsigned long long raysBefore = RenderProgress::totalRays(threadStats[worker]);
+			const size_t view = batches[i] / numBatches;
+			const unsigned int firstRow = (batches[i] % numBatches) * rowsPerBatch;
+			TRACE_SCOPE_XY("render", "row band", "view", view, "row", firstRow);
+			const unsigned int endRow = std::min(renderHeight, firstRow + rowsPerBatch);
+			renderers[view*pool.size() + worker]->renderRows(*displays[view], firstRow, endRow, threadStats[worker]);
+			RenderStats::NodeStats& nodeStats = threadStats[worker].nodes.back();
+			const unsigned long long pixels = (unsigned long long)(endRow - firstRow) * renderWidth;
+			const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			nodeStats.pixels += pixels;
+			nodeStats.busySeconds += seconds;
+			threadStats[worker].addTileTime(seconds);
+			progress->add(1, pixels, RenderProgress::totalRays(threadStats[worker]) - raysBefore);
+		});
+	} else {
+		const unsigned int tilesX = footprints[0]->numTilesX();
+		const unsigned int tilesPerView = tilesX * footprints[0]->numTilesY();
+		std::vector<unsigned int> tiles;
+		for (unsigned int view = 0; view < cameras.size(); ++view) {
+			for (unsigned int tile : orderTiles(order, tilesX, footprints[0]->numTilesY(), orderSeed)) {
+				tiles.push_back(view*tilesPerView + tile);
+			}
+		}
+		const unsigned int tileSize = footprints[0]->tileSize();
+		startReporting("tile", tiles.size());
+		pool.parallelFor(tiles.size(), [&](size_t i, unsigned int worker) {
+			const Clock::time_point start = Clock::now();
+			const unsigned long long raysBefore = RenderProgress::totalRays(threadStats[worker]);
+			const size_t view = tiles[i] / tilesPerView;
+			const unsigned int tile = tiles[i] % tilesPerView;
+			const unsigned int tileX = tile % tilesX;
+			const unsigned int tileY = tile / tilesX;
+			TRACE_SCOPE_XY("render", "tile", "x", tileX, "y", tileY);
+			renderTile(*displays[view], *footprints[view], tileX, tileY, threadStats[worker], heatmaps.empty() ? nullptr : heatmaps[view]);
+			RenderStats::NodeStats& nodeStats = threadStats[worker].nodes.back();
+			const unsigned long long pixels = (unsigned long long)(std::min(renderWidth, (tileX + 1)*tileSize) - tileX*tileSize) * 
+			                                  (std::min(renderHeight, (tileY + 1)*tileSize) - tileY*tileSize);
+			const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			nodeStats.pixels += pixels;
+			nodeStats.busySeconds += seconds;
+			threadStats[worker].addTileTime(seconds);
+			progress->add(1, pixels, RenderProgress::totalRays(threadStats[worker]) - raysBefore);
+		});
+	}
+	reporter.reset();
+
+	RenderStats stats;
+	for (const RenderStats& threadStat : threadStats) {
+		stats += threadStat;
+	}
+	for (const auto& viewFootprints : footprints) {
+		stats.tiles += viewFootprints->numTilesX() * viewFootprints->numTilesY();
+		for (unsigned int ty = 0; ty < viewFootprints->numTilesY(); ++ty) {
+			for (unsigned int tx = 0; tx < viewFootprints->numTilesX(); ++tx) {
+				if (viewFootprints->candidates(tx, ty).empty()) ++stats.emptyTiles;
+				stats.tileCandidates += viewFootprints->candidates(tx, ty).size();
+			}
+		}
+	}
+	if (denoise) {
+		for (ImageDisplay* display : displays) {
+			display->denoise(Denoiser(), &pool);
+			display->toneMap(toneMapping, &pool);
+		}
+	}
+	return stats;
+}
+
+RenderStats Scene::renderWithinBudget(ImageDisplay& display, ThreadPool& pool) const {
+	return renderWithinBudget(*getViews().front().camera, display, pool);
+}
+
+RenderStats Scene::renderWithinBudget(const Camera& camera, ImageDisplay& display, ThreadPool& pool, CostHeatmap* heatmap) const {
+	typedef std::chrono::steady_clock Clock;
+	const Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(timeBudgetMs));
+	return renderUntil(camera, display, pool, deadline, heatmap);
+}
+
+RenderStats Scene::renderUntil(const Camera& camera, ImageDisplay& display, ThreadPool& pool, std::chrono::steady_clock::time_point deadline, 
+                               CostHeatmap* heatmap) const {
+	typedef std::chrono::steady_clock Clock;
+	const Clock::time_point start = Clock::now();
+
+	freeze();
+	TRACE_SCOPE("render", "Scene::renderWithinBudget");
+	ScreenFootprints footprints(camera, objects_, renderWidth, renderHeight);
+	if (display.layout() != framebufferLayout) display.setLayout(framebufferLayout);
+	display.setToneMapping(toneMapping);
+	if (denoise) display.enableFeatures();
+
+	// Passes from a coarse preview up to the full quality of the Scene. Each pass is
+	// an improvement on the one before, so its tiles can replace the older ones as they finish.
+	std::vector<Quality> passes;
+	passes.push_back(Quality{16, 0, 1});
+	passes.push_back(Quality{8, 0, 1});
+	passes.push_back(Quality{4, 0, 1});
+	passes.push_back(Quality{2, std::min(1u, maxRayDepth), 1});
+	passes.push_back(Quality{1, maxRayDepth, 1});
+	if (samplesPerPixel > 1) {
+		passes.push_back(Quality{1, maxRayDepth, samplesPerPixel});
+	}
+
+	// Refine the middle of the image first, where detail is usually most noticed
+	const std::vector<unsigned int> tiles = orderTiles(TileOrder::CentreOut, footprints.numTilesX(), footprints.numTilesY());
+	std::vector<RenderStats> threadStats(pool.size());
+
+	// Every pass counts towards the progress, which the pass summaries below already show on the console
+	RenderProgress progress("tile", tiles.size() * passes.size(), (unsigned long long)renderWidth * renderHeight * passes.size(), deadline);
+	std::unique_ptr<TelemetryReporter> reporter(new TelemetryReporter(progress, telemetryFd, false, telemetryIntervalMs));
+	const unsigned int tileSize = footprints.tileSize();
+
+	for (size_t pass = 0; pass < passes.size(); ++pass) {
+		std::atomic<size_t> tilesDone(0);
+		pool.parallelFor(tiles.size(), [&](size_t i, unsigned int worker) {
+			// The first pass always covers the whole image, so there is something to save
+			const Clock::time_point tileStart = Clock::now();
+			if (pass > 0 && tileStart >= deadline) return;
+			const unsigned long long raysBefore = RenderProgress::totalRays(threadStats[worker]);
+			const unsigned int tileX = tiles[i] % footprints.numTilesX();
+			const unsigned int tileY = tiles[i] / footprints.numTilesX();
+			const unsigned int tileWidth = std::min(renderWidth, (tileX + 1)*tileSize) - tileX*tileSize;
+			const unsigned int tileHeight = std::min(renderHeight, (tileY + 1)*tileSize) - tileY*tileSize;
+			// Empty tiles are exactly the backgroundColour after the first pass, and later
+			// passes stop between rows at the deadline, so a tile may be left partly refined
+			TRACE_SCOPE_XY("render", "budget tile", "x", tileX, "y", tileY);
+			unsigned int rows = tileHeight;
+			if (pass == 0 || !footprints.candidates(tileX, tileY).empty()) {
+				rows = renderTile(display, footprints, tileX, tileY, passes[pass], threadStats[worker], heatmap, 
+				                  pass > 0 ? deadline : Clock::time_point::max());
+			}
+			if (rows == tileHeight) ++tilesDone;
+			threadStats[worker].addTileTime(std::chrono::duration<double>(Clock::now() - tileStart).count());
+			progress.add(rows == tileHeight ? 1 : 0, (unsigned long long)tileWidth * rows, 
+			             RenderProgress::totalRays(threadStats[worker]) - raysBefore);
+		});
+
+		const double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		if (showProgress) std::cout << "Pass " << pass + 1 << " of " << passes.size() << " (" << passes[pass].pixelStep << "x" << passes[pass].pixelStep 
+		          << " pixel blocks, ray depth " << passes[pass].rayDepth << ", " << passes[pass].samples << " sample" 
+		          << (passes[pass].samples == 1 ? "" : "s") << "): " << tilesDone << " of " << tiles.size() 
+		          << " tiles after " << elapsed << "ms" << std::endl;
+		if (tilesDone < tiles.size()) break;
+	}
+	reporter.reset();
+
+	RenderStats stats;
+	for (const RenderStats& threadStat : threadStats) {
+		stats += threadStat;
+	}
+	stats.tiles = footprints.numTilesX() * footprints.numTilesY();
+	for (unsigned int ty = 0; ty < footprints.numTilesY(); ++ty) {
+		for (unsigned int tx = 0; tx < footprints.numTilesX(); ++tx) {
+			if (footprints.candidates(tx, ty).empty()) ++stats.emptyTiles;
+			stats.tileCandidates += footprints.candidates(tx, ty).size();
+		}
+	}
+	if (denoise) {
+		display.denoise(Denoiser(), &pool);
+		display.toneMap(toneMapping, &pool);
+	}
+	return stats;
+}
+
+bool Scene::verifyDeterminism() const {
+	// Render once on a single thread in scanline order...
+	ImageDisplay reference("Reference", renderWidth, renderHeight);
+	{
+		ThreadPool pool(1, threadCpus());
+		renderImage(reference, pool, TileOrder::Scanline);
+	}
+
+	// ...and again with several threads, taking the tiles in a shuffled order
+	ImageDisplay shuffled("Shuffled", renderWidth, renderHeight);
+	unsigned int numThreads = std::max(4u, std::thread::hardware_concurrency());
+	{
+		ThreadPool pool(numThreads, threadCpus());
+		renderImage(shuffled, pool, TileOrder::Shuffled, 0x5EED);
+	}
+	std::cout << std::endl;
+
+	const std::vector<unsigned char>& a = reference.getPixels();
+	const std::vector<unsigned char>& b = shuffled.getPixels();
+	size_t differences = 0;
+	for (size_t pixel = 0; pixel < size_t(renderWidth) * renderHeight; ++pixel) {
+		if (a[3*pixel] != b[3*pixel] || a[3*pixel + 1] != b[3*pixel + 1] || a[3*pixel + 2] != b[3*pixel + 2]) {
+			if (differences < 10) {
+				std::cout << "Pixel (" << pixel % renderWidth << ", " << pixel / renderWidth << ") differs: ("
+				          << int(a[3*pixel]) << ", " << int(a[3*pixel + 1]) << ", " << int(a[3*pixel + 2]) << ") vs ("
+				          << int(b[3*pixel]) << ", " << int(b[3*pixel + 1]) << ", " << int(b[3*pixel + 2]) << ")" << std::endl;
+			}
+			++differences;
+		}
+	}
+
+	std::cout << "Determinism check (1 thread, scanline order vs " << numThreads << " threads, shuffled order): ";
+	if (differences == 0) {
+		std::cout << "images are identical" << std::endl;
+	} else {
+		std::cout << differences << " pixels differ" << std::endl;
+	}
+	return differences == 0;
+}
+
+bool Scene::verifyFastMath() {
+	// Check each specular table against pow() directly...
+	const SpecularTables& tables = freeze().specularTables();
+	double worstTable = 0;
+	for (const SpecularTable& table : tables.tables()) {
+		worstTable = std::max(worstTable, table.maxError(100000));
+	}
+	std::cout << "Specular tables: " << tables.tables().size() << " exponent" << (tables.tables().size() == 1 ? "" : "s")
+	          << ", largest error " << worstTable * 255 << " of an 8-bit level" << std::endl;
+
+	// ...then render the image with and without the approximations
+	const bool wasFastMath = fastMath;
+	ThreadPool pool(numThreads, threadCpus());
+	ImageDisplay exact("Exact", renderWidth, renderHeight);
+	fastMath = false;
+	renderImage(exact, pool);
+	ImageDisplay approximate("Fast math", renderWidth, renderHeight);
+	fastMath = true;
+	renderImage(approximate, pool);
+	fastMath = wasFastMath;
+	std::cout << std::endl;
+
+	const std::vector<unsigned char>& a = exact.getPixels();
+	const std::vector<unsigned char>& b = approximate.getPixels();
+	size_t differences = 0;
+	int largest = 0;
+	for (size_t pixel = 0; pixel < size_t(renderWidth) * renderHeight; ++pixel) {
+		int pixelLargest = 0;
+		for (size_t c = 0; c < 3; ++c) {
+			pixelLargest = std::max(pixelLargest, std::abs(int(a[3*pixel + c]) - int(b[3*pixel + c])));
+		}
+		if (pixelLargest > 0) ++differences;
+		largest = std::max(largest, pixelLargest);
+	}
+
+	std::cout << "Fast math check (exact vs fast math shading): " << differences << " of " << size_t(renderWidth) * renderHeight 
+	          << " pixels differ, by at most " << largest << " level" << (largest == 1 ? "" : "s") << std::endl;
+	return largest <= 1;
+}
+
+void Scene::benchmarkEncoding(unsigned int repeats) const {
+	ThreadPool pool(numThreads, threadCpus());
 	ImageDisplay display("Render", renderWidth, renderHeight);
+	renderImage(display, pool);
+	std::cout << std::endl;
+	benchmarkImageEncoding(display.getPixels().data(), display.width(), display.height(), pool, repeats, std::cout);
+}
 
-	const double w = double(renderWidth);
-	const double h = double(renderHeight);
+void Scene::benchmarkShading(unsigned int repeats) const {
+	typedef std::chrono::steady_clock Clock;
 
+	// Find the primary hits of the image once, so only the lighting is timed
+	const Camera& camera = *getViews().front().camera;
+	ScreenFootprints footprints(camera, objects_, renderWidth, renderHeight);
+	std::vector<Ray> rays;
+	std::vector<RayIntersection> hits;
 	for (unsigned int v = 0; v < renderHeight; ++v) {
 		for (unsigned int u = 0; u < renderWidth; ++u) {
-			double cu = -1 + (u + 0.5)*(2.0 / w);
-			double cv = -h/w + (v + 0.5)*(2.0 / w);
-			Ray ray = camera_->castRay(cu, cv);
-			display.set(u, v, computeColour(ray, maxRayDepth));
+			const Ray ray = castPrimaryRay(camera, u, v);
+			const RayIntersection hit = intersect(ray, footprints.candidatesAt(u, v));
+			if (hit.distance != infinity) {
+				rays.push_back(ray);
+				hits.push_back(hit);
+			}
+		}
+	}
+	std::vector<const LightSource*> lights;
+	for (const auto& light : lights_) {
+		if (light->getDistanceToLight(Point()) >= 0) lights.push_back(light.get());
+	}
+	if (hits.empty() || lights.empty()) {
+		std::cout << "Nothing to shade: the image needs at least one hit and one non-ambient LightSource" << std::endl;
+		return;
+	}
+
+	// Shade every hit with every light, ignoring shadows, with each implementation
+	std::vector<Colour> reference(hits.size());
+	std::vector<Colour> packed(hits.size());
+	auto shadeReference = [&]() {
+		for (size_t h = 0; h < hits.size(); ++h) {
+			Colour colour(0, 0, 0);
+			for (const LightSource* light : lights) addDirectLightingReference(*light, hits[h], rays[h], colour);
+			reference[h] = colour;
+		}
+	};
+	auto shadePacked = [&]() {
+		for (size_t h = 0; h < hits.size(); ++h) {
+			PackedColour colour(0, 0, 0);
+			for (const LightSource* light : lights) addDirectLighting(*light, hits[h], rays[h], colour);
+			packed[h] = colour.toColour();
+		}
+	};
+	auto medianMs = [&](const std::function<void()>& shade, PerfCounters::Counts& counts) {
+		std::vector<double> times;
+		for (unsigned int r = 0; r < std::max(1u, repeats); ++r) {
+			const std::unique_ptr<PerfCounters> counters(perfCounters ? new PerfCounters() : nullptr);
+			const Clock::time_point start = Clock::now();
+			shade();
+			times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+			if (counters) counts += counters->read();
+		}
+		std::sort(times.begin(), times.end());
+		return times[times.size() / 2];
+	};
+	std::vector<Colour> fast(hits.size());
+	auto shadeFast = [&]() {
+		for (size_t h = 0; h < hits.size(); ++h) {
+			PackedColour colour(0, 0, 0);
+			for (const LightSource* light : lights) addDirectLighting(*light, hits[h], rays[h], colour, true);
+			fast[h] = colour.toColour();
+		}
+	};
+	PerfCounters::Counts referenceCounts, packedCounts, fastCounts;
+	const double referenceMs = medianMs(shadeReference, referenceCounts);
+	const double packedMs = medianMs(shadePacked, packedCounts);
+	const double fastMs = medianMs(shadeFast, fastCounts);
+
+	double maxDifference = 0;
+	double maxFastDifference = 0;
+	for (size_t h = 0; h < hits.size(); ++h) {
+		maxDifference = std::max({maxDifference, std::abs(reference[h].red - packed[h].red),
+		                          std::abs(reference[h].green - packed[h].green), std::abs(reference[h].blue - packed[h].blue)});
+		maxFastDifference = std::max({maxFastDifference, std::abs(reference[h].red - fast[h].red),
+		                              std::abs(reference[h].green - fast[h].green), std::abs(reference[h].blue - fast[h].blue)});
+	}
+	const double shaded = double(hits.size()) * lights.size();
+	std::cout << "Phong shading of " << hits.size() << " hits with " << lights.size() << " light" << (lights.size() == 1 ? "" : "s") 
+	          << " (median of " << std::max(1u, repeats) << "):" << std::endl;
+	std::cout << "  Colour (double):       " << referenceMs << "ms, " << 1e6 * referenceMs / shaded << "ns per hit and light" << std::endl;
+	std::cout << "  PackedColour (float):  " << packedMs << "ms, " << 1e6 * packedMs / shaded << "ns per hit and light" << std::endl;
+	std::cout << "  Speedup: " << referenceMs / packedMs << "x, largest difference " << maxDifference * 255 << " of an 8-bit level" << std::endl;
+	std::cout << "  Fast math:             " << fastMs << "ms, " << 1e6 * fastMs / shaded << "ns per hit and light" << std::endl;
+	std::cout << "  Speedup: " << referenceMs / fastMs << "x, largest difference " << maxFastDifference * 255 << " of an 8-bit level" << std::endl;
+	if (perfCounters) {
+		// Counted over every repeat, so divided by all of the hits and lights shaded
+		const double allShaded = shaded * std::max(1u, repeats);
+		const std::string unavailable = PerfCounters::availability();
+		if (!unavailable.empty()) std::cout << "  Hardware counters: " << unavailable << std::endl;
+		std::cout << "  Colour (double) counters " << referenceCounts.summary(allShaded, "hit and light") << std::endl;
+		std::cout << "  PackedColour counters " << packedCounts.summary(allShaded, "hit and light") << std::endl;
+		std::cout << "  Fast math counters " << fastCounts.summary(allShaded, "hit and light") << std::endl;
+	}
+}
+
+void Scene::benchmarkTileOrder(unsigned int repeats) {
+	typedef std::chrono::steady_clock Clock;
+
+	freeze();
+	ThreadPool pool(numThreads, threadCpus());
+	const Camera& camera = *getViews().front().camera;
+	ScreenFootprints footprints(camera, objects_, renderWidth, renderHeight);
+	const unsigned int tileSize = footprints.tileSize();
+
+	// Simulated addresses for the bounds of each Object and the two framebuffers
+	const uint64_t boundsBase = 0;
+	const uint64_t radianceBase = uint64_t(1) << 40;
+	const uint64_t pixelsBase = uint64_t(2) << 40;
+
+	const bool wasShowingProgress = showProgress;
+	const FramebufferLayout oldLayout = framebufferLayout;
+	showProgress = false;
+
+	if (perfCounters && !PerfCounters::availability().empty()) {
+		std::cout << "Hardware counters: " << PerfCounters::availability() << std::endl;
+	}
+	std::cout << "Tile orders (median of " << std::max(1u, repeats) << " render" << (repeats > 1 ? "s" : "") << " with " << pool.size() 
+	          << " thread" << (pool.size() == 1 ? "" : "s") << "; cache misses replayed on one thread):" << std::endl;
+	const std::vector<std::pair<TileOrder, std::string>> orders = { 
+		{TileOrder::Scanline, "scanline"}, {TileOrder::Morton, "Morton"}, {TileOrder::Hilbert, "Hilbert"} 
+	};
+	const std::vector<std::pair<FramebufferLayout, std::string>> layouts = {
+		{FramebufferLayout::RowMajor, "row-major"}, {FramebufferLayout::MortonTiles, "Morton tiles"}
+	};
+	for (const auto& layout : layouts) {
+		for (const auto& order : orders) {
+			framebufferLayout = layout.first;
+			ImageDisplay display("Benchmark", renderWidth, renderHeight);
+			std::vector<double> times;
+			PerfCounters::Counts counts;
+			unsigned long long rays = 0;
+			for (unsigned int r = 0; r < std::max(1u, repeats); ++r) {
+				const std::unique_ptr<PerfCounters> counters(perfCounters ? new PerfCounters() : nullptr);
+				const Clock::time_point start = Clock::now();
+				rays += RenderProgress::totalRays(renderImage(camera, display, pool, order.first));
+				times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+				if (counters) counts += counters->read();
+			}
+			std::sort(times.begin(), times.end());
+
+			CacheModel small(32 << 10, 8);
+			CacheModel large(1 << 20, 16);
+			auto access = [&small, &large](uint64_t address, size_t bytes) {
+				small.access(address, bytes);
+				large.access(address, bytes);
+			};
+			for (unsigned int tile : orderTiles(order.first, footprints.numTilesX(), footprints.numTilesY())) {
+				const unsigned int tileX = tile % footprints.numTilesX();
+				const unsigned int tileY = tile / footprints.numTilesX();
+				const std::vector<unsigned int>& candidates = footprints.candidates(tileX, tileY);
+				for (unsigned int v = tileY * tileSize; v < std::min(renderHeight, (tileY + 1) * tileSize); ++v) {
+					for (unsigned int u = tileX * tileSize; u < std::min(renderWidth, (tileX + 1) * tileSize); ++u) {
+						for (unsigned int object : candidates) {
+							access(boundsBase + 64 * uint64_t(object), 48);
+						}
+						const uint64_t pixel = display.pixelIndex(u, v);
+						access(radianceBase + 3 * sizeof(float) * pixel, 3 * sizeof(float));
+						access(pixelsBase + 3 * pixel, 3);
+					}
+				}
+			}
+
+			std::cout << "  " << order.second << " order, " << layout.second << " framebuffer: " << times[times.size() / 2] << "ms, "
+			          << small.misses() << " misses in 32kB and " << large.misses() << " in 1MB (of " << small.accesses() << " line accesses)" << std::endl;
+			if (perfCounters) {
+				std::cout << "    counters " << counts.summary(double(rays), "ray") << std::endl;
+			}
+		}
+	}
+
+	framebufferLayout = oldLayout;
+	showProgress = wasShowingProgress;
+}
+
+void Scene::renderTile(ImageDisplay& display, const ScreenFootprints& footprints, unsigned int tileX, unsigned int tileY, RenderStats& stats, 
+                       CostHeatmap* heatmap) const {
+	renderTile(display, footprints, tileX, tileY, Quality{1, maxRayDepth, samplesPerPixel}, stats, heatmap);
+}
+
+unsigned int Scene::renderTile(ImageDisplay& display, const ScreenFootprints& footprints, unsigned int tileX, unsigned int tileY, 
+                               const Quality& quality, RenderStats& stats, CostHeatmap* heatmap, std::chrono::steady_clock::time_point deadline) const {
+	const unsigned int tileSize = footprints.tileSize();
+	const unsigned int endU = std::min(renderWidth, (tileX + 1) * tileSize);
+	const unsigned int endV = std::min(renderHeight, (tileY + 1) * tileSize);
+	const std::vector<unsigned int>& candidates = footprints.candidates(tileX, tileY);
+	const unsigned int step = std::max(1u, quality.pixelStep);
+	const bool recordFeatures = display.hasFeatures();
+
+	// The tile is gathered here and written to the display in one go
+	const unsigned int startU = tileX * tileSize;
+	const unsigned int startV = tileY * tileSize;
+	const size_t tileWidth = endU - startU;
+	std::vector<Colour> tile(tileWidth * (endV - startV));
+	const bool hasDeadline = deadline != std::chrono::steady_clock::time_point::max();
+
+	unsigned int v = startV;
+	for (; v < endV; v += step) {
+		// Rows not reached by the deadline keep whatever the display held before
+		if (hasDeadline && std::chrono::steady_clock::now() >= deadline) break;
+		for (unsigned int u = startU; u < endU; u += step) {
+			Colour colour = backgroundColour;
+			PixelFeatures features = { { 0, 0, 0 }, 0, -1 };
+			if (!candidates.empty() && heatmap) {
+				typedef std::chrono::steady_clock Clock;
+				const unsigned long long raysBefore = RenderProgress::totalRays(stats);
+				const Clock::time_point start = Clock::now();
+				colour = renderPixel(footprints.camera(), u, v, candidates, quality, stats, recordFeatures ? &features : nullptr);
+				heatmap->add(u, v, heatmap->metric() == CostMetric::Time ? std::chrono::duration<double, std::nano>(Clock::now() - start).count() 
+				                                                         : double(RenderProgress::totalRays(stats) - raysBefore));
+			} else if (!candidates.empty()) {
+				colour = renderPixel(footprints.camera(), u, v, candidates, quality, stats, recordFeatures ? &features : nullptr);
+			}
+			// Nothing can be seen in an empty tile, so there is no need to trace any Rays
+			for (unsigned int blockV = v; blockV < std::min(endV, v + step); ++blockV) {
+				for (unsigned int blockU = u; blockU < std::min(endU, u + step); ++blockU) {
+					tile[(blockV - startV)*tileWidth + (blockU - startU)] = colour;
+					if (recordFeatures) display.setFeatures(blockU, blockV, features);
+				}
+			}
+		}
+	}
+	const unsigned int rows = std::min(v, endV) - startV;
+	if (rows > 0) display.setTile(startU, startV, tileWidth, rows, tile.data());
+	return rows;
+}
+
+Colour Scene::renderPixel(const Camera& camera, unsigned int u, unsigned int v, const std::vector<unsigned int>& candidates, const Quality& quality, 
+                          RenderStats& stats, PixelFeatures* features) const {
+	const double step = double(std::max(1u, quality.pixelStep));
+	stats.primaryRays += std::max(1u, quality.samples);
+	if (quality.samples <= 1) {
+		Random random = Random::forPixel(u, v);
+		const Ray ray = castPrimaryRay(camera, u, v, 0.5*step, 0.5*step);
+		const RayIntersection hit = intersect(ray, candidates);
+		if (features) addSampleFeatures(*features, hit, 0, size_t(v)*renderWidth + u);
+		return finishPath(computeColour(ray, hit, quality.rayDepth, Colour(1, 1, 1), random, stats)).toColour();
+	}
+
+	// Samples are summed in a fixed order, so the result is the same whichever thread computes it
+	Colour sum(0, 0, 0);
+	for (unsigned int sample = 0; sample < quality.samples; ++sample) {
+		Random random = Random::forPixel(u, v, sample);
+		double offsetU = random.uniform()*step;
+		double offsetV = random.uniform()*step;
+		const Ray ray = castPrimaryRay(camera, u, v, offsetU, offsetV);
+		const RayIntersection hit = intersect(ray, candidates);
+		if (features) addSampleFeatures(*features, hit, sample, size_t(v)*renderWidth + u);
+		sum += finishPath(computeColour(ray, hit, quality.rayDepth, Colour(1, 1, 1), random, stats)).toColour();
+	}
+	return sum / quality.samples;
+}
+
+void Scene::addSampleFeatures(PixelFeatures& features, const RayIntersection& hit, unsigned int sample, size_t pixel) {
+	const int32_t object = hit.distance == infinity ? -1 : int32_t(hit.object);
+	if (sample == 0) {
+		for (size_t i = 0; i < 3; ++i) {
+			features.normal[i] = object < 0 ? 0.0f : float(hit.normal(i));
 		}
-		display.refresh();
+		features.depth = object < 0 ? 0.0f : float(hit.distance);
+		features.object = object;
+	} else if (object != features.object && features.object >= -1) {
+		features.object = -2 - int32_t(pixel);
 	}
+}
 
-	display.save(filename);
-	display.pause(5);
+Ray Scene::castPrimaryRay(const Camera& camera, unsigned int u, unsigned int v, double offsetU, double offsetV) const {
+	const double w = double(renderWidth);
+	const double h = double(renderHeight);
+	double cu = -1 + (u + offsetU)*(2.0 / w);
+	double cv = -h/w + (v + offsetV)*(2.0 / w);
+	return camera.castRay(cu, cv);
 }
 
 RayIntersection Scene::intersect(const Ray& ray) const {
 	RayIntersection firstHit;
 	firstHit.distance = infinity;
 	std::vector<RayIntersection> hits;
+	const CompiledScene& compiled = this->compiled();
 	
-	for (const auto& obj: objects_) {
-		for (const auto& hit: obj->intersect(ray)) {
+	for (unsigned int ix = 0; ix < objects_.size(); ++ix) {
+		if (!compiled.mayHit(ix, ray)) continue;
+		for (const auto& hit: objects_[ix]->intersect(ray)) {
+			if (epsilon < hit.distance && hit.distance < firstHit.distance) {
+				firstHit = hit;
+				firstHit.object = ix;
+			}
+		}
+	}
+	return firstHit;
+}
+
+RayIntersection Scene::intersect(const Ray& ray, const std::vector<unsigned int>& candidates) const {
+	RayIntersection firstHit;
+	firstHit.distance = infinity;
+	const CompiledScene& compiled = this->compiled();
+
+	for (unsigned int ix : candidates) {
+		if (!compiled.mayHit(ix, ray)) continue;
+		for (const auto& hit: objects_[ix]->intersect(ray)) {
 			if (epsilon < hit.distance && hit.distance < firstHit.distance) {
 				firstHit = hit;
+				firstHit.object = ix;
 			}
 		}
 	}
 	return firstHit;
 }
 
-Colour Scene::computeColour(const Ray& ray, unsigned int rayDepth) const {
-	const RayIntersection hitPoint = intersect(ray);
+RayIntersection Scene::intersectQueued(const RayQueue& rays, size_t ix, const std::vector<unsigned int>* candidates) const {
+	double start[3], direction[3];
+	rays.origin(ix, start);
+	rays.direction(ix, direction);
+	RayIntersection firstHit;
+	firstHit.distance = infinity;
+	const CompiledScene& compiled = this->compiled();
+
+	std::optional<Ray> ray; // Built when first needed, as most bounds tests fail
+	const size_t count = candidates ? candidates->size() : objects_.size();
+	for (size_t c = 0; c < count; ++c) {
+		const unsigned int object = candidates ? (*candidates)[c] : (unsigned int)c;
+		if (!compiled.mayHit(object, start, direction)) continue;
+		if (!ray) ray.emplace(Point(start[0], start[1], start[2]), Direction(direction[0], direction[1], direction[2]));
+		for (const auto& hit: objects_[object]->intersect(*ray)) {
+			if (epsilon < hit.distance && hit.distance < firstHit.distance) {
+				firstHit = hit;
+				firstHit.object = object;
+			}
+		}
+	}
+	return firstHit;
+}
+
+PackedColour Scene::computeColour(const Ray& ray, unsigned int rayDepth, const Colour& throughput, Random& random, RenderStats& stats) const {
+	return computeColour(ray, intersect(ray), rayDepth, throughput, random, stats);
+}
+
+PackedColour Scene::computeColour(const Ray& ray, const RayIntersection& hitPoint, unsigned int rayDepth, const Colour& throughput, Random& random, RenderStats& stats) const {
 	if (hitPoint.distance == infinity) {
-		return backgroundColour;
-	}
-	Colour hitColour(0, 0, 0);
-	for (const auto & light : lights_) {
-		// Compute the influence of this light on the appearance of the hit object.
-		if (light->getDistanceToLight(hitPoint.point) < 0) {
-			// === Ambient Lighting ===
-			hitColour += light->getIlluminationAt(hitPoint.point) * hitPoint.material.ambientColour;
-		} else {
+		return PackedColour(backgroundColour);
+	}
+	PackedColour hitColour(0, 0, 0);
+	const CompiledScene& compiled = this->compiled();
+	// Terms whose Colour is black are skipped, as they would only add zero
+	const unsigned int features = compiled.materialClasses().features(hitPoint.object);
+
+	// === Ambient Lighting ===
+	if (features & AmbientFeature) {
+		for (unsigned int l : compiled.ambientLights()) {
+			hitColour += lights_[l]->getIlluminationAt(hitPoint.point) * PackedColour(hitPoint.material.ambientColour);
+		}
+	}
+
+	// Compute the influence of each direct light on the appearance of the hit object.
+	if (features & (DiffuseFeature | SpecularFeature)) {
+		for (unsigned int l : compiled.directLights()) {
+			const auto& light = lights_[l];
 			// === SHADOWS == 
 			// Do this first, as if a hitPoint is in shadow then we can skip computing lighting
-			Ray shadowRay; // Ray going from hitPoint towards light
-			shadowRay.point = hitPoint.point;
-			shadowRay.direction = -light->getLightDirection(shadowRay.point);
+			Ray shadowRay = computeShadowRay(*light, hitPoint);
+			++stats.shadowRays;
 			double distToLight = light->getDistanceToLight(shadowRay.point);
-			RayIntersection shadowRayHit = this->intersect(shadowRay);
+			RayIntersection shadowRayHit = this->intersect(shadowRay, compiled.shadowCasters().candidates(l, hitPoint.object));
 
 			// Basicly, if something is between the hitPoint and the light, the hitPoint is in shadow
 			if (distToLight >= shadowRayHit.distance) continue;
 
-
 			// === Other lighting: === 
+			addDirectLighting(*light, hitPoint, ray, hitColour);
+		}
+	}
 
-			// Lambda for converting vectors to unit-vectors
-			auto toUnitVector = [](const Vector vec) {
-				Vector resultVector = Vector(vec);
-				double vecLen = vec.norm();
-				if (vecLen != 1) {
-					resultVector(0) = vec(0)/vecLen;
-					resultVector(1) = vec(1)/vecLen;
-					resultVector(2) = vec(2)/vecLen;
-				}
-				return resultVector;
-			};
+	// Compute mirror reflections - only if surface hit is a mirror and we've not reached our rayDepth
+	if (rayDepth > 0 && (features & MirrorFeature)) {
+		// Skip reflections that are too faint to change the final image
+		const PackedColour mirrorColour(hitPoint.material.mirrorColour);
+		PackedColour reflectedColour(0, 0, 0);
+		Colour reflectedThroughput;
+		double weight;
+		if (continuePath(hitPoint.material, rayDepth, throughput, reflectedThroughput, weight, random, stats)) {
+			reflectedColour = (mirrorColour * float(weight)) 
+			                * computeColour(computeReflectedRay(ray, hitPoint), rayDepth - 1, reflectedThroughput, random, stats);
+		}
+
+		// Hit colour is a mix of the current surface and reflected ray
+		hitColour = (PackedColour(1, 1, 1) - mirrorColour) * hitColour + reflectedColour;
+	}
+
+	if (clipsEachBounce()) hitColour.clip();
+	return hitColour;
+}
 
-			Colour lightAtHitPoint = light->getIlluminationAt(hitPoint.point);
-			Vector unitLightDir = toUnitVector(light->getLightDirection(hitPoint.point));
-			
-			// DIFFUSE:
-			Vector hitUnitNormal = toUnitVector(hitPoint.normal);
-			
-			Colour objectDiffuse = hitPoint.material.diffuseColour;
-			Colour diffuseColour = lightAtHitPoint * objectDiffuse * hitUnitNormal.dot(-unitLightDir);
-			
-			if (hitUnitNormal.dot(-unitLightDir) > 0) hitColour += diffuseColour;
+Ray Scene::computeShadowRay(const LightSource& light, const RayIntersection& hitPoint) const {
+	Ray shadowRay; // Ray going from hitPoint towards light
+	shadowRay.point = hitPoint.point;
+	shadowRay.direction = -light.getLightDirection(shadowRay.point);
+	return shadowRay;
+}
 
+template <bool Diffuse, bool Specular, bool FastMath>
+void Scene::directLightingKernel(const LightSource& light, const RayIntersection& hitPoint, const Ray& ray, PackedColour& hitColour) const {
+	auto dot = [](const double a[3], const double b[3]) {
+		return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+	};
 
-			// SPECULAR:
-			Vector dirTowardsViewer = toUnitVector(ray.direction);
-			
-			double objSpecExponent = hitPoint.material.specularExponent;
-			Colour objSpecColour = hitPoint.material.specularColour;
-			
-			Colour specColour = (lightAtHitPoint * objSpecColour) * pow(dirTowardsViewer.dot(-unitLightDir), objSpecExponent);
-			
-			if (unitLightDir.dot(dirTowardsViewer) < 0) hitColour += specColour;
+	const Direction lightDirection = light.getLightDirection(hitPoint.point);
+	const PackedColour lightAtHitPoint = FastMath ? light.getFastIlluminationAt(hitPoint.point, lightDirection) : light.getIlluminationAt(hitPoint.point);
 
-		}		
+	// Light direction, surface Normal, and Ray direction as unit vectors in plain arrays
+	double vectors[3][3];
+	for (size_t i = 0; i < 3; ++i) {
+		vectors[0][i] = lightDirection(i);
+		vectors[1][i] = hitPoint.normal(i);
+		vectors[2][i] = ray.direction(i);
 	}
+	if (FastMath) {
+		// Made unit length together, whether or not they are all needed
+		normalizeThree(vectors);
+	} else {
+		const Vector* sources[3] = { &lightDirection, &hitPoint.normal, &ray.direction };
+		for (size_t v = 0; v < 3; ++v) {
+			// The Normal is only needed for the diffuse term, and the Ray direction for the specular
+			if ((v == 1 && !Diffuse) || (v == 2 && !Specular)) continue;
+			const double vecLen = sources[v]->norm();
+			if (vecLen != 1) {
+				for (size_t i = 0; i < 3; ++i) vectors[v][i] /= vecLen;
+			}
+		}
+	}
+	const double* unitLightDir = vectors[0];
+	const double* hitUnitNormal = vectors[1];
+	const double* dirTowardsViewer = vectors[2];
 
-	// Compute mirror reflections - only if surface hit is a mirror and we've not reached our rayDepth
-	if (rayDepth > 0 && (hitPoint.material.mirrorColour.red > 0 ||
-		                 hitPoint.material.mirrorColour.green > 0 ||
-		                 hitPoint.material.mirrorColour.blue > 0)) {
+	// DIFFUSE:
+	if (Diffuse) {
+		const double normalDotLight = -dot(hitUnitNormal, unitLightDir);
+		if (normalDotLight > 0) {
+			hitColour += lightAtHitPoint * PackedColour(hitPoint.material.diffuseColour) * float(normalDotLight);
+		}
+	}
+
+	// SPECULAR:
+	if (Specular) {
+		const double lightDotViewer = dot(unitLightDir, dirTowardsViewer);
+		if (lightDotViewer < 0) {
+			float specularFactor;
+			if (FastMath) {
+				specularFactor = compiled().specularTables().forObject(hitPoint.object)(float(std::min(1.0, -lightDotViewer)));
+			} else {
+				specularFactor = float(pow(-lightDotViewer, hitPoint.material.specularExponent));
+			}
+			hitColour += (lightAtHitPoint * PackedColour(hitPoint.material.specularColour)) * specularFactor;
+		}
+	}
+}
 
-		// Compute the reflected ray
-		Ray reflectedRay;
+void Scene::addDirectLighting(const LightSource& light, const RayIntersection& hitPoint, const Ray& ray, PackedColour& hitColour, bool useFastMath) const {
+	const unsigned int features = compiled().materialClasses().features(hitPoint.object);
+	const unsigned int kernel = ((features & DiffuseFeature) ? 1 : 0) | ((features & SpecularFeature) ? 2 : 0) | (useFastMath ? 4 : 0);
+	switch (kernel) {
+	case 1: directLightingKernel<true, false, false>(light, hitPoint, ray, hitColour); break;
+	case 2: directLightingKernel<false, true, false>(light, hitPoint, ray, hitColour); break;
+	case 3: directLightingKernel<true, true, false>(light, hitPoint, ray, hitColour); break;
+	case 5: directLightingKernel<true, false, true>(light, hitPoint, ray, hitColour); break;
+	case 6: directLightingKernel<false, true, true>(light, hitPoint, ray, hitColour); break;
+	case 7: directLightingKernel<true, true, true>(light, hitPoint, ray, hitColour); break;
+	default: break; // No direct terms
+	}
+}
 
-		// Surface normal as a unit vector
-		Normal n = hitPoint.normal;
-		n = n / n.norm(); 
+Ray Scene::computeReflectedRay(const Ray& ray, const RayIntersection& hitPoint) const {
+	// Compute the reflected ray
+	Ray reflectedRay;
 
-		// View direction as a unit vector
-		Direction v = -ray.direction;
-		v = v / v.norm(); 
+	// Surface normal as a unit vector
+	Normal n = hitPoint.normal;
+	n = n / n.norm(); 
 
-		// Ray starts at the hit point
-		reflectedRay.point = hitPoint.point;
+	// View direction as a unit vector
+	Direction v = -ray.direction;
+	v = v / v.norm(); 
 
-		// And goes in the reflection of v about n
-		reflectedRay.direction = 2 * (v.dot(n)) * n - v;
+	// Ray starts at the hit point
+	reflectedRay.point = hitPoint.point;
 
-		// Hit colour is a mix of the current surface and reflected ray
-		hitColour = (Colour(1, 1, 1) - hitPoint.material.mirrorColour) * hitColour 
-					+ (hitPoint.material.mirrorColour * computeColour(reflectedRay, rayDepth - 1));
-	}
+	// And goes in the reflection of v about n
+	reflectedRay.direction = 2 * (v.dot(n)) * n - v;
 
-	hitColour.clip();
-	return hitColour;
+	return reflectedRay;
+}
+
+bool Scene::continuePath(const Material& material, unsigned int rayDepth, const Colour& throughput, 
+                         Colour& reflectedThroughput, double& weight, Random& random, RenderStats& stats) const {
+	// The reflected Colour is clipped to [0,1] at each bounce, so throughput bounds its effect on the pixel (unless hdr or russianRoulette is set)
+	reflectedThroughput = throughput * material.mirrorColour;
+	const double maxContribution = std::max({reflectedThroughput.red, reflectedThroughput.green, reflectedThroughput.blue});
+	weight = 1;
+	if (maxContribution < minContribution) {
+		if (russianRoulette && random.uniform() * minContribution < maxContribution) {
+			// Survivors are scaled up to stand in for the paths stopped here, which is only
+			// unbiased because their Colours are not clipped until the end of the path
+			weight = minContribution / maxContribution;
+			reflectedThroughput *= weight;
+			++stats.rouletteSurvivors;
+		} else {
+			++stats.terminatedPaths;
+			stats.bouncesSaved += rayDepth;
+			return false;
+		}
+	}
+	++stats.reflectedRays;
+	return true;
 }
 
 bool Scene::hasCamera() const {
-	return bool(camera_);
+	return bool(camera_) || !views_.empty();
+}
+
+void Scene::addCamera(const std::string& name, std::shared_ptr<Camera> camera, const std::string& viewFilename) {
+	views_.push_back(View{name, camera, viewFilename});
+}
+
+std::vector<Scene::View> Scene::getViews() const {
+	std::vector<View> views;
+	if (camera_) {
+		views.push_back(View{"", camera_, filename});
+	}
+	for (View view : views_) {
+		if (view.filename.empty()) {
+			// render.png -> render_name.png
+			const size_t dot = filename.find_last_of('.');
+			const size_t slash = filename.find_last_of("/\\");
+			if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+				view.filename = filename + "_" + view.name;
+			} else {
+				view.filename = filename.substr(0, dot) + "_" + view.name + filename.substr(dot);
+			}
+		}
+		views.push_back(view);
+	}
+	return views;
+}
+
+const CompiledScene& Scene::freeze() const {
+	std::lock_guard<std::mutex> lock(compiledMutex_);
+	if (!compiled_) {
+		TRACE_SCOPE("scene", "compile scene");
+		const std::unique_ptr<PerfCounters> counters(perfCounters ? new PerfCounters() : nullptr);
+		const AllocationTracker::Phase allocations;
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		const NumaTopology& topology = NumaTopology::system();
+		const bool interleave = numaPlacement == NumaPlacement::Interleave && topology.interleaveAllocations(true);
+		compiled_.reset(new CompiledScene(lights_, objects_, hugePages));
+		if (interleave) topology.interleaveAllocations(false);
+
+		if (numaPlacement == NumaPlacement::Replicate) {
+			// Linux puts each page on the node of the thread that first writes to it, 
+			// so each replica is built by a thread pinned to its node
+			replicas_.resize(topology.numNodes());
+			std::vector<std::thread> builders;
+			for (size_t node = 0; node < topology.numNodes(); ++node) {
+				builders.emplace_back([this, &topology, node] {
+					topology.pinCurrentThread(topology.cpusOf(node).front());
+					TRACE_THREAD_NAME("replica builder " + std::to_string(node));
+					TRACE_SCOPE("scene", "build replica");
+					replicas_[node].reset(new CompiledScene(lights_, objects_, hugePages));
+				});
+			}
+			for (auto& builder : builders) {
+				builder.join();
+			}
+		}
+		buildSeconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (counters) buildCounts_ = counters->read();
+		buildAllocations_ = allocations.counts();
+	}
+	return *compiled_;
+}
+
+std::vector<int> Scene::threadCpus() const {
+	ThreadAffinity affinity = threadAffinity;
+	if (affinity == ThreadAffinity::None && numaPlacement == NumaPlacement::Replicate) {
+		affinity = ThreadAffinity::Scatter;
+	}
+	return NumaTopology::system().cpuOrder(affinity);
 }
@@ -3,18 +3,40 @@
 #ifndef SCENE_H_INCLUDED
 #define SCENE_H_INCLUDED
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "AllocationTracker.h"
 #include "Camera.h"
 #include "Colour.h"
+#include "CompiledScene.h"
+#include "CostHeatmap.h"
+#include "Denoiser.h"
+#include "HugePages.h"
+#include "ImageDisplay.h"
+#include "NumaTopology.h"
+#include "PackedColour.h"
+#include "PerfCounters.h"
 #include "LightSource.h"
 #include "Material.h"
 #include "NonCopyable.h"
 #include "Object.h"
+#include "Random.h"
 #include "Ray.h"
 #include "RayIntersection.h"
+#include "RenderReport.h"
+#include "RenderStats.h"
+#include "ScreenFootprints.h"
+#include "TileOrder.h"
+#include "ToneMapping.h"
+
+class RayQueue;
+
+class ThreadPool;
 
 /** \file
  * \brief Scene class header file.
@@ -65,8 +87,8 @@ public:
 	 *   scene.setCamera(camera);
 	 * \endcode
 	 *
-	 * Note that a Scene has only one Camera, so calling setCamera() will
-	 * replace any existing camera.
+	 * Note that a Scene has only one default Camera, so calling setCamera() will
+	 * replace any existing default camera. Further views can be added with addCamera().
 	 * 
 	 * \param camera The new Camera to add.
 	 */
@@ -74,6 +96,33 @@ public:
 		camera_ = camera;
 	}
 
+	/** \brief Add a named Camera, rendered as a separate view of the Scene.
+	 *
+	 * render() produces one image for the default Camera (if there is one) and one
+	 * for each named Camera, such as the left and right eyes of a stereo pair. The
+	 * views share the Scene's Objects, Materials, and shadow caster lists, which are
+	 * only built once.
+	 *
+	 * \param name The name of the view.
+	 * \param camera The Camera for the view.
+	 * \param viewFilename File to save the view to. If empty, the name is added to the Scene's 
+	 *        filename, so \c render.png becomes \c render_[name].png.
+	 */
+	void addCamera(const std::string& name, std::shared_ptr<Camera> camera, const std::string& viewFilename = "");
+
+	/** \brief A Camera, and where to save the image it sees. */
+	struct View {
+		std::string name;               //!< Name of the view, or empty for the default Camera.
+		std::shared_ptr<Camera> camera; //!< Camera to render the view with.
+		std::string filename;           //!< File to save the view to.
+	};
+
+	/** \brief Every view to render: the default Camera (if any), then the named Cameras.
+	 *
+	 * \return The views, with their filenames filled in.
+	 */
+	std::vector<View> getViews() const;
+
 	/** \brief Add a new Object.
 	 *
 	 * Note that the Scene has a collection of Objects, and there is no 
@@ -82,7 +131,10 @@ public:
 	 * \param object A \c std::shared_ptr to the new Object to add.
 	 */
 	void addObject(std::shared_ptr<Object> object) {
+		std::lock_guard<std::mutex> lock(compiledMutex_);
 		objects_.push_back(object);
+		compiled_.reset();
+		replicas_.clear();
 	}
 
 	/** \brief Add a new LightSource.
@@ -93,9 +145,36 @@ public:
 	 * \param light A \c std::shared_ptr to the new LightSource to add.
 	 */
 	void addLight(std::shared_ptr<LightSource> light) {
+		std::lock_guard<std::mutex> lock(compiledMutex_);
 		lights_.push_back(light);
+		compiled_.reset();
+		replicas_.clear();
 	}
 
+	/** \brief Compile the Objects and LightSources into a CompiledScene, if this has not been done already.
+	 *
+	 * This is called at the start of each render, but can be called as soon as the 
+	 * Scene is complete (for example, once a SceneReader has finished) to do the work 
+	 * up front. Adding an Object or LightSource discards the CompiledScene, and it is
+	 * rebuilt on the next call. The CompiledScene holds data derived from the Objects
+	 * and LightSources, not the Objects themselves, which rendering still intersects.
+	 *
+	 * The numaPlacement and hugePages settings are applied here, so should be set
+	 * before the Scene is frozen. The Scene must not be changed while it is being rendered.
+	 *
+	 * \return The CompiledScene, which stays valid until the Scene is next changed.
+	 */
+	const CompiledScene& freeze() const;
+
+	/** \brief The CPUs to pin render threads to, following threadAffinity.
+	 *
+	 * If numaPlacement is NumaPlacement::Replicate and threadAffinity is None, the
+	 * threads are scattered over the nodes, so that each replica is used.
+	 *
+	 * \return CPUs for the \c cpus argument of the ThreadPool constructor.
+	 */
+	std::vector<int> threadCpus() const;
+
 
 	/** \brief Render an image of the Scene.
 	 * 
@@ -104,9 +183,153 @@ public:
 	 * the Scene's filename property. The format of the file is determined by its
 	 * extension. 
 	 *
+	 * If the wavefront property is set the image is produced by a WavefrontRenderer,
+	 * which traces Rays breadth-first in large batches. The resulting image is the 
+	 * same as with the default, recursive, approach.
+	 *
+	 * The image is rendered by numThreads threads. Every pixel is computed independently
+	 * of the others, so the image does not depend on the number of threads.
+	 *
+	 * If timeBudgetMs is set the image is rendered by renderWithinBudget() instead. With
+	 * several views the budget covers all of them: each view is refined until an equal
+	 * part of the time left when it starts has passed.
+	 *
+	 * If named Cameras have been added, every view is rendered in one pass over the
+	 * ThreadPool and saved to its own file.
+	 *
 	 * Attempts to render a Scene with no Camera will end badly.
+	 *
+	 * \return true if every image (and any CostHeatmap and RenderReport) was saved, false if any could not be.
+	 */
+	bool render() const;
+
+	/** \brief Render an image of the Scene into an ImageDisplay.
+	 *
+	 * This is the core of render(), which does not save the image. The tiles (or, 
+	 * for a WavefrontRenderer, bands of rows) of the image are shared out between
+	 * the threads of a ThreadPool in the given order.
+	 *
+	 * \param display The ImageDisplay to write pixels to. It must be (renderWidth x renderHeight).
+	 * \param pool The ThreadPool to render with.
+	 * \param order The order to hand out tiles in.
+	 * \param orderSeed The seed for TileOrder::Shuffled.
+	 * \return Counters collected while rendering.
+	 */
+	RenderStats renderImage(ImageDisplay& display, ThreadPool& pool, TileOrder order = TileOrder::Scanline, uint64_t orderSeed = 0) const;
+
+	/** \brief Render an image of the Scene, as seen by a given Camera, into an ImageDisplay.
+	 *
+	 * As renderImage(ImageDisplay&, ThreadPool&, TileOrder, uint64_t), but for any Camera
+	 * rather than the first view of the Scene.
+	 *
+	 * \param camera The Camera to render with.
+	 * \param display The ImageDisplay to write pixels to. It must be (renderWidth x renderHeight).
+	 * \param pool The ThreadPool to render with.
+	 * \param order The order to hand out tiles in.
+	 * \param orderSeed The seed for TileOrder::Shuffled.
+	 * \return Counters collected while rendering.
+	 */
+	RenderStats renderImage(const Camera& camera, ImageDisplay& display, ThreadPool& pool, 
+	                        TileOrder order = TileOrder::Scanline, uint64_t orderSeed = 0) const;
+
+	/** \brief Render an image of the Scene, refining it until a deadline.
+	 *
+	 * A coarse preview of the whole image (one Ray per 16x16 block of pixels, with no
+	 * reflections) is rendered first. Further passes then refine it: 8x8 and 4x4 blocks, 
+	 * 2x2 blocks with one reflection, then every pixel with the full maxRayDepth, and
+	 * finally samplesPerPixel samples.
+	 * Within each pass tiles are refined from the centre of the image outwards, and each
+	 * finished tile replaces the coarser version in the ImageDisplay. Once timeBudgetMs 
+	 * has passed no new tiles are started, and tiles already started in the refining
+	 * passes stop before their next row, keeping the coarser version of the rows they
+	 * have not reached. The ImageDisplay always holds the best image finished so far.
+	 *
+	 * The budget can be overrun by at most the time one thread takes to render one row
+	 * of a tile (16 pixels, or one row of pixel blocks) at the quality of the current pass.
+	 * The preview is always completed, even if that takes longer than the budget.
+	 * The recursive renderer is always used, even if the wavefront property is set.
+	 *
+	 * \param display The ImageDisplay to write pixels to. It must be (renderWidth x renderHeight).
+	 * \param pool The ThreadPool to render with.
+	 * \return Counters collected while rendering.
+	 */
+	RenderStats renderWithinBudget(ImageDisplay& display, ThreadPool& pool) const;
+
+	/** \brief Render an image of the Scene, as seen by a given Camera, refining it until a deadline.
+	 *
+	 * \param camera The Camera to render with.
+	 * \param display The ImageDisplay to write pixels to. It must be (renderWidth x renderHeight).
+	 * \param pool The ThreadPool to render with.
+	 * \param heatmap If not \c nullptr, the CostHeatmap to add the cost of each pixel of every pass to.
+	 * \return Counters collected while rendering.
+	 */
+	RenderStats renderWithinBudget(const Camera& camera, ImageDisplay& display, ThreadPool& pool, CostHeatmap* heatmap = nullptr) const;
+
+	/** \brief Render an image of the Scene, as seen by a given Camera, refining it until a given deadline.
+	 *
+	 * As renderWithinBudget(), but the deadline is given rather than being timeBudgetMs
+	 * from now, so that several renders can share one budget.
+	 *
+	 * \param camera The Camera to render with.
+	 * \param display The ImageDisplay to write pixels to. It must be (renderWidth x renderHeight).
+	 * \param pool The ThreadPool to render with.
+	 * \param deadline When to stop refining the image.
+	 * \param heatmap If not \c nullptr, the CostHeatmap to add the cost of each pixel of every pass to.
+	 * \return Counters collected while rendering.
+	 */
+	RenderStats renderUntil(const Camera& camera, ImageDisplay& display, ThreadPool& pool, std::chrono::steady_clock::time_point deadline, 
+	                        CostHeatmap* heatmap = nullptr) const;
+
+	/** \brief Check that the rendered image does not depend on scheduling.
+	 *
+	 * The image is rendered twice: on one thread with tiles in scanline order, and on
+	 * several threads with tiles in a shuffled order. Any pixels that differ are reported.
+	 *
+	 * \return true if the two images are identical, false otherwise.
 	 */
-	void render() const;
+	bool verifyDeterminism() const;
+
+	/** \brief Check that fastMath shading stays within one 8-bit level of the exact shading.
+	 *
+	 * The SpecularTable of each Material is compared with std::pow(), and the image is
+	 * rendered with and without fastMath, which covers the light falloff and normalization
+	 * as well as the tables. The largest differences are reported.
+	 *
+	 * \return true if no pixel value differs by more than one level, false otherwise.
+	 */
+	bool verifyFastMath();
+
+	/** \brief Compare the speed and file size of each ImageFormat on a render of the Scene.
+	 *
+	 * The image is rendered once, then encoded repeatedly in each format by
+	 * benchmarkImageEncoding(), and the results are printed.
+	 *
+	 * \param repeats The number of times to encode the image in each format.
+	 */
+	void benchmarkEncoding(unsigned int repeats) const;
+
+	/** \brief Time the diffuse and specular lighting of the Scene's primary hits.
+	 *
+	 * The primary Rays are intersected once, then every hit is lit by every non-ambient
+	 * LightSource (ignoring shadows) repeatedly, with PackedColour as in rendering and with
+	 * the double precision Colour arithmetic it replaced. The median times, and the largest
+	 * difference between the two, are printed.
+	 *
+	 * \param repeats The number of times to light the hits with each implementation.
+	 */
+	void benchmarkShading(unsigned int repeats) const;
+
+	/** \brief Compare the TileOrders and FramebufferLayouts for speed and cache misses.
+	 *
+	 * The image is rendered in scanline, Morton, and Hilbert tile order into each
+	 * FramebufferLayout, and the median time is printed. The memory touched while
+	 * rendering (the world-space bounds of each candidate Object, and the framebuffer)
+	 * is also replayed, a tile at a time in each order, through simulated 32kB and 1MB
+	 * CacheModels, and the number of misses in each is printed.
+	 *
+	 * \param repeats The number of times to render the image in each order and layout.
+	 */
+	void benchmarkTileOrder(unsigned int repeats);
 
 	Colour backgroundColour; //!< Colour for any Ray that does not hit an Object.
 
@@ -114,6 +337,140 @@ public:
 
 	unsigned int maxRayDepth; //!< Maximum number of reflected Rays to trace.
 
+	/** \brief Smallest contribution a reflected Ray can make and still be traced.
+	 *
+	 * Each reflection is scaled by the mirrorColour of every surface before it, and this product
+	 * (the path throughput) bounds how much the reflected Colour can change the final pixel.
+	 * When no channel of the throughput reaches minContribution the reflection is not traced.
+	 * The default is half of an 8-bit quantum (0.5/255), and 0 traces every reflection.
+	 */
+	double minContribution;
+
+	/** \brief Use Russian roulette rather than simply stopping low-contribution paths.
+	 *
+	 * With Russian roulette, a reflection whose throughput is below minContribution
+	 * is traced with probability (throughput/minContribution), and its contribution
+	 * scaled up to compensate. Clipping a scaled-up survivor would undo this, so Colours
+	 * are then clipped only once the whole path is known, rather than at each bounce.
+	 * The expected Colour of each path is then unchanged, apart from that last clip, which
+	 * can still darken the brightest pixels slightly (set hdr to avoid even this).
+	 */
+	bool russianRoulette;
+
+	/** \brief Keep the full range of light, rather than clipping Colours to [0,1] at each bounce.
+	 *
+	 * The float framebuffer of the ImageDisplay then holds values above 1 where the
+	 * Scene is brighter than white, and toneMapping decides how they are shown. Since
+	 * reflected Colours are no longer bounded by 1, paths stopped by minContribution may
+	 * change a pixel by slightly more than minContribution.
+	 */
+	bool hdr;
+
+	/** \brief How the float framebuffer is turned into 8-bit pixels once an image is rendered.
+	 *
+	 * With the default settings (and hdr off) the pixels written while rendering are
+	 * kept as they are. Otherwise the ImageDisplay is tone mapped after rendering.
+	 */
+	ToneMapping toneMapping;
+
+	/** \brief Filter noise out of the image with a Denoiser once it is rendered.
+	 *
+	 * The Normal, depth, and Object seen through each pixel are kept while rendering, so
+	 * that the Denoiser can tell edges from noise. This is most useful with a few 
+	 * samplesPerPixel, where it smooths the jittered samples of each surface.
+	 */
+	bool denoise;
+
+	/** \brief Shade with fast approximations rather than exact arithmetic.
+	 *
+	 * Vectors are normalized with an approximate reciprocal square root, the falloff of
+	 * a PointLightSource is found from the squared length of the light direction rather than
+	 * its distance (see LightSource::getFastIlluminationAt()), and the specular power is read
+	 * from a SpecularTable for each Material rather than computed with pow().
+	 * For light and Material Colours up to 1, pixels differ from the exact shading by at
+	 * most one 8-bit level (see verifyFastMath()).
+	 */
+	bool fastMath;
+
+	bool wavefront; //!< Render with the WavefrontRenderer rather than by recursive ray tracing.
+
+	/** \brief File descriptor to write telemetry to while rendering, or -1 for none.
+	 *
+	 * A TelemetryReporter writes the progress of each render (pieces of work and pixels
+	 * done, Rays per second, the time left, and memory use) to it as lines of JSON, 
+	 * every telemetryIntervalMs. The Scene does not close it.
+	 */
+	int telemetryFd;
+
+	double telemetryIntervalMs; //!< Time between telemetry samples (and console progress updates), in milliseconds.
+
+	std::string statsFile; //!< File to save a RenderReport to after render(), or empty for none.
+
+	double parseSeconds; //!< Time taken to read the Scene description, for the RenderReport.
+
+	/** \brief Whether to count hardware events with PerfCounters.
+	 *
+	 * The events of building the CompiledScene, rendering, and saving are shown by render()
+	 * and added to the RenderReport, and benchmarkShading() and benchmarkTileOrder() show
+	 * the events of each implementation. Events that cannot be counted are left out.
+	 */
+	bool perfCounters;
+
+	/** \brief Allocations made while reading the Scene description, for render() and the RenderReport.
+	 *
+	 * This is only filled in when the AllocationTracker is enabled. The allocations of
+	 * building the CompiledScene, rendering, and saving are then counted by the Scene.
+	 */
+	AllocationTracker::Counts parseAllocations;
+
+	/** \brief What to measure for a CostHeatmap of each view, or CostMetric::None for no heatmap.
+	 *
+	 * render() saves the heatmap next to each image (\c render.heatmap.png for \c render.png),
+	 * with the total cost of each tile in a CSV file (\c render.heatmap.csv), and summarises
+	 * where the cost is. Pixels are only measured by the recursive renderer, so no heatmap
+	 * is kept when the wavefront property is set (unless rendering within a time budget).
+	 */
+	CostMetric costHeatmap;
+
+	/** \brief The order in which render threads take tiles (or, with wavefront, bands of rows).
+	 *
+	 * The order does not change the image, but a space-filling curve such as 
+	 * TileOrder::Hilbert keeps the tiles being rendered at any time close together,
+	 * so they share more of the Objects they test and of the framebuffer they write.
+	 */
+	TileOrder tileOrder;
+
+	FramebufferLayout framebufferLayout; //!< How ImageDisplays store their pixels while rendering.
+
+	unsigned int numThreads; //!< Number of threads to render with, or 0 for one per hardware thread.
+
+	ThreadAffinity threadAffinity; //!< How render threads are pinned to CPUs.
+
+	/** \brief Where the CompiledScene is placed on a machine with several NUMA nodes.
+	 *
+	 * By default it is built by the thread that calls freeze(), so its memory is on
+	 * that thread's node. It can instead be replicated, with one copy built on each 
+	 * node by a thread pinned there, or have its pages interleaved across the nodes.
+	 * Only the CompiledScene is placed: the Objects and their Transforms, which every
+	 * Ray is still intersected with, are shared by every copy and stay on the node
+	 * where the Scene was read.
+	 */
+	NumaPlacement numaPlacement;
+
+	HugePages hugePages; //!< How large arrays in the CompiledScene are backed.
+
+	/** \brief Number of jittered samples averaged for each pixel.
+	 *
+	 * With one sample (the default) each pixel is sampled at its centre. With more, each
+	 * sample is offset within the pixel by a Random generator seeded from the pixel and
+	 * sample number, so the result does not depend on the order pixels are rendered in.
+	 */
+	unsigned int samplesPerPixel;
+
+	bool showProgress; //!< Show progress on the console while rendering.
+
+	double timeBudgetMs; //!< Time (in milliseconds) to spend refining the image, or 0 to render it in full.
+
 	/** \brief Check if the Scene has a Camera.
 	 *
 	 * To render a scene, a Camera is required. It is possible (although
@@ -131,20 +488,175 @@ public:
 private:
 
 	std::shared_ptr<Camera> camera_;                      //!< Camera to render the image with.
+	std::vector<View> views_;                             //!< Named Cameras, in the order added.
 	std::vector<std::shared_ptr<Object>> objects_;       //!< Collection of Objects in the Scene.
 	std::vector<std::shared_ptr<LightSource>> lights_;   //!< Collection of LightSources in the Scene.
 
+	mutable std::mutex compiledMutex_;                  //!< Protects compiled_ and replicas_ while they are built or discarded.
+	mutable std::unique_ptr<CompiledScene> compiled_;   //!< Derived data shared by all views and threads, built by freeze().
+	mutable double buildSeconds_;                       //!< Time freeze() took to build compiled_ (and any replicas).
+	mutable PerfCounters::Counts buildCounts_;          //!< Hardware events while freeze() built compiled_, if perfCounters.
+	mutable AllocationTracker::Counts buildAllocations_; //!< Allocations while freeze() built compiled_, if they are tracked.
+	mutable std::vector<std::unique_ptr<CompiledScene>> replicas_; //!< Copy of compiled_ on each NUMA node, if replicated.
+
+	/** \brief The CompiledScene for the calling thread.
+	 *
+	 * \return The replica on the thread's NUMA node, if there is one, or compiled_.
+	 */
+	const CompiledScene& compiled() const {
+		if (replicas_.empty()) return *compiled_;
+		return *replicas_[NumaTopology::currentNode() % replicas_.size()];
+	}
+
+	friend class WavefrontRenderer; // Shares the shading helpers below, so both paths give the same image.
+
+	/** \brief Find the first intersection of a Ray in a RayQueue with the Scene, reading the queue directly.
+	 *
+	 * The bounds of each Object are tested against the queue's arrays, and a Ray object is
+	 * only built once a Ray meets some Object's bounds, for the Object's own intersect().
+	 * The result is the same as that of intersect() on the same Ray.
+	 *
+	 * \param rays The queue holding the Ray.
+	 * \param ix The position of the Ray in the queue.
+	 * \param candidates The Objects which the Ray might hit, or \c nullptr for all of them.
+	 * \return The first intersection of the Ray with the Objects.
+	 */
+	RayIntersection intersectQueued(const RayQueue& rays, size_t ix, const std::vector<unsigned int>* candidates) const;
+
+	/** \brief How much effort to put into each pixel. */
+	struct Quality {
+		unsigned int pixelStep; //!< Trace one pixel in each (pixelStep x pixelStep) block, and fill the block with it.
+		unsigned int rayDepth;  //!< Maximum number of reflected Rays to trace.
+		unsigned int samples;   //!< Number of jittered samples per traced pixel.
+	};
+
+	/** \brief Start the RenderReport of a render, with everything known before the views are rendered.
+	 *
+	 * This must be called after freeze(), as it describes the CompiledScene.
+	 *
+	 * \param views The number of views rendered.
+	 * \param threads The number of render threads.
+	 * \return The report, for render() to add the times and counts of rendering and saving to.
+	 */
+	RenderReport startReport(unsigned int views, unsigned int threads) const;
+
+	/** \brief Generate the primary Ray for a pixel.
+	 *
+	 * Pixel co-ordinates are converted to image plane co-ordinates, with the
+	 * ray passing through the given point in the pixel (by default its centre), 
+	 * and cast from the Camera.
+	 *
+	 * \param u The column of the pixel.
+	 * \param v The row of the pixel.
+	 * \param offsetU Horizontal position within the pixel, from 0 to 1.
+	 * \param offsetV Vertical position within the pixel, from 0 to 1.
+	 * \return The Ray from the Camera through pixel (u,v).
+	 */
+	Ray castPrimaryRay(const Camera& camera, unsigned int u, unsigned int v, double offsetU = 0.5, double offsetV = 0.5) const;
+
+	/** \brief Render several views of the Scene into ImageDisplays, sharing one ThreadPool.
+	 *
+	 * The tiles of all of the views are handed out as a single loop, so threads
+	 * move straight on to the next view rather than waiting at the end of each one.
+	 *
+	 * \param cameras The Camera for each view.
+	 * \param displays The ImageDisplay for each view, each (renderWidth x renderHeight).
+	 * \param pool The ThreadPool to render with.
+	 * \param order The order to hand out tiles within each view.
+	 * \param orderSeed The seed for TileOrder::Shuffled.
+	 * \param heatmaps The CostHeatmap for each view, or none to measure nothing. They are not
+	 *                 filled in by the WavefrontRenderer.
+	 * \return Counters collected while rendering, summed over the views.
+	 */
+	RenderStats renderViews(const std::vector<const Camera*>& cameras, const std::vector<ImageDisplay*>& displays, 
+	                        ThreadPool& pool, TileOrder order, uint64_t orderSeed, 
+	                        const std::vector<CostHeatmap*>& heatmaps = std::vector<CostHeatmap*>()) const;
+
 	/** \brief Intersect a Ray with the Objects in a Scene
 	 *
 	 * This intersects the Ray with all of the Objects in the Scene and returns
 	 * the first hit. If there is no hit, then a RayIntersection with infinite distance
-	 * is returned.
+	 * is returned. Objects whose bounds the Ray misses (see CompiledScene::mayHit()) 
+	 * are skipped, so freeze() must have been called.
 	 *
 	 * \param ray The Ray to intersect with the Objects.
 	 * \return The first intersection of the Ray with the Scene.
 	 */
 	RayIntersection intersect(const Ray& ray) const;
 
+	/** \brief Intersect a Ray with some of the Objects in a Scene
+	 *
+	 * This is the same as intersect(const Ray&) const, but only the listed Objects
+	 * are tested. It is used for primary Rays, which can only hit the Objects
+	 * whose ScreenFootprints overlap their pixel.
+	 *
+	 * \param ray The Ray to intersect with the Objects.
+	 * \param candidates The indices of the Objects to test, in order.
+	 * \return The first intersection of the Ray with the candidate Objects.
+	 */
+	RayIntersection intersect(const Ray& ray, const std::vector<unsigned int>& candidates) const;
+
+	/** \brief Render one tile of the image.
+	 *
+	 * Primary Rays in the tile are only tested against the Objects whose footprints
+	 * overlap the tile. If there are no such Objects, the tile is filled with the
+	 * backgroundColour without tracing any Rays.
+	 *
+	 * \param display The ImageDisplay to write pixels to.
+	 * \param footprints The Objects which can be seen in each tile.
+	 * \param tileX The column of the tile.
+	 * \param tileY The row of the tile.
+	 * \param stats Counters to update.
+	 * \param heatmap If not \c nullptr, the CostHeatmap to add the cost of each pixel to.
+	 */
+	void renderTile(ImageDisplay& display, const ScreenFootprints& footprints, unsigned int tileX, unsigned int tileY, RenderStats& stats, 
+	                CostHeatmap* heatmap = nullptr) const;
+
+	/** \brief Render one tile of the image at a given Quality.
+	 *
+	 * \param display The ImageDisplay to write pixels to.
+	 * \param footprints The Objects which can be seen in each tile.
+	 * \param tileX The column of the tile.
+	 * \param tileY The row of the tile.
+	 * \param quality How much effort to put into each pixel.
+	 * \param stats Counters to update.
+	 * \param heatmap If not \c nullptr, the CostHeatmap to add the cost of each pixel to.
+	 * \param deadline When to stop. It is checked before each row (or row of pixel blocks), and
+	 *                 the rows not reached are left as they were in the display.
+	 * \return The number of rows of the tile written to the display.
+	 */
+	unsigned int renderTile(ImageDisplay& display, const ScreenFootprints& footprints, unsigned int tileX, unsigned int tileY, 
+	                        const Quality& quality, RenderStats& stats, CostHeatmap* heatmap = nullptr, 
+	                        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max()) const;
+
+	/** \brief Compute the Colour of one pixel (or block of pixels), averaging over its samples.
+	 *
+	 * \param camera The Camera to cast primary Rays from.
+	 * \param u The column of the pixel.
+	 * \param v The row of the pixel.
+	 * \param candidates The Objects which primary Rays through the pixel can hit.
+	 * \param quality How much effort to put into the pixel. With a pixelStep above 1 the
+	 *                Rays sample the whole block of pixels starting at (u,v).
+	 * \param stats Counters to update.
+	 * \param features If not \c nullptr, set to what the primary Rays through the pixel hit.
+	 * \return The Colour of pixel (u,v).
+	 */
+	Colour renderPixel(const Camera& camera, unsigned int u, unsigned int v, const std::vector<unsigned int>& candidates, const Quality& quality, 
+	                   RenderStats& stats, PixelFeatures* features = nullptr) const;
+
+	/** \brief Add one sample's primary Ray to the PixelFeatures of a pixel.
+	 *
+	 * The Normal and depth are those of the first sample. If later samples hit a different
+	 * Object (or miss), the pixel straddles an edge, and is given an object index of its own
+	 * so that the Denoiser leaves it alone.
+	 *
+	 * \param features The PixelFeatures of the pixel, which are replaced by the first sample.
+	 * \param hit The intersection of the sample's primary Ray, which may be a miss.
+	 * \param sample The sample number.
+	 * \param pixel The index (row by row) of the pixel in the image.
+	 */
+	static void addSampleFeatures(PixelFeatures& features, const RayIntersection& hit, unsigned int sample, size_t pixel);
+
 	/** \brief Compute the Colour seen by a Ray in the Scene.
 	 * 
 	 * The Colour seen by a Ray depends on the ligthing, the first Object that it
@@ -166,9 +678,118 @@ private:
 	 * 
 	 * \param ray The Ray to intersect with the Objects in the Scene.
 	 * \param rayDepth The maximum number of reflection Rays that can be cast.
+	 * \param throughput The product of the mirror Colours along the path so far.
+	 * \param random The random number generator for this pixel (used for Russian roulette).
+	 * \param stats Counters to update.
 	 * \return The Colour observed by the viewRay.
 	 */
-	Colour computeColour(const Ray& ray, unsigned int rayDepth = 0) const;
+	PackedColour computeColour(const Ray& ray, unsigned int rayDepth, const Colour& throughput, Random& random, RenderStats& stats) const;
+
+	/** \brief Compute the Colour seen by a Ray whose first hit is already known.
+	 *
+	 * \param ray The Ray that has been intersected with the Scene.
+	 * \param hitPoint The first intersection of the Ray with the Scene.
+	 * \param rayDepth The maximum number of reflection Rays that can be cast.
+	 * \param throughput The product of the mirror Colours along the path so far.
+	 * \param random The random number generator for this pixel (used for Russian roulette).
+	 * \param stats Counters to update.
+	 * \return The Colour observed by the Ray.
+	 * \sa computeColour(const Ray&, unsigned int, const Colour&, Random&, RenderStats&) const
+	 */
+	PackedColour computeColour(const Ray& ray, const RayIntersection& hitPoint, unsigned int rayDepth, const Colour& throughput, Random& random, RenderStats& stats) const;
+
+	/** \brief Decide whether to trace the reflection from a mirror hit.
+	 *
+	 * \param material The Material of the mirror that was hit.
+	 * \param rayDepth The number of reflection Rays that can still be cast.
+	 * \param throughput The path throughput up to the mirror.
+	 * \param reflectedThroughput Set to the path throughput of the reflected Ray.
+	 * \param weight Set to the factor the reflected Colour must be scaled by (1 unless Russian roulette applies).
+	 * \param random The random number generator for this pixel.
+	 * \param stats Counters to update.
+	 * \return true if the reflected Ray should be traced.
+	 * \sa minContribution, russianRoulette
+	 */
+	bool continuePath(const Material& material, unsigned int rayDepth, const Colour& throughput, 
+	                  Colour& reflectedThroughput, double& weight, Random& random, RenderStats& stats) const;
+
+	/** \brief Whether Colours are clipped to [0,1] at each bounce.
+	 *
+	 * \return true unless hdr is set, or russianRoulette is (whose paths are clipped by finishPath()).
+	 */
+	bool clipsEachBounce() const {
+		return !hdr && !russianRoulette;
+	}
+
+	/** \brief Clip the Colour of a whole path, if it was not clipped at each bounce.
+	 *
+	 * \param colour The Colour observed by a primary Ray.
+	 * \return The Colour to add to its pixel.
+	 */
+	PackedColour finishPath(PackedColour colour) const {
+		if (!hdr && russianRoulette) colour.clip();
+		return colour;
+	}
+
+	/** \brief Compute the Ray used to test whether a hit point is in shadow.
+	 *
+	 * The shadow Ray starts at the hit point and heads towards the LightSource.
+	 * The point is in shadow if the first hit along this Ray is no further away
+	 * than the LightSource itself.
+	 *
+	 * \param light The (non-ambient) LightSource to cast towards.
+	 * \param hitPoint The intersection being shaded.
+	 * \return The shadow Ray.
+	 */
+	Ray computeShadowRay(const LightSource& light, const RayIntersection& hitPoint) const;
+
+	/** \brief Add the diffuse and specular contributions of a visible LightSource.
+	 *
+	 * The work is done by the directLightingKernel() for the terms of the hit Object's
+	 * Material (see MaterialClasses). freeze() must have been called.
+	 *
+	 * \param light The (non-ambient) LightSource illuminating the hit point.
+	 * \param hitPoint The intersection being shaded.
+	 * \param ray The Ray which produced the intersection.
+	 * \param hitColour The Colour to add the contributions to.
+	 */
+	void addDirectLighting(const LightSource& light, const RayIntersection& hitPoint, const Ray& ray, PackedColour& hitColour) const {
+		addDirectLighting(light, hitPoint, ray, hitColour, fastMath);
+	}
+
+	/** \brief Add the diffuse and specular contributions of a visible LightSource, with or without fastMath.
+	 *
+	 * \param light The (non-ambient) LightSource illuminating the hit point.
+	 * \param hitPoint The intersection being shaded.
+	 * \param ray The Ray which produced the intersection.
+	 * \param hitColour The Colour to add the contributions to.
+	 * \param useFastMath Whether to use the fastMath approximations.
+	 */
+	void addDirectLighting(const LightSource& light, const RayIntersection& hitPoint, const Ray& ray, PackedColour& hitColour, bool useFastMath) const;
+
+	/** \brief Shading kernel for one combination of Material terms.
+	 *
+	 * Each instantiation computes only the terms it is compiled for, so matte
+	 * Materials skip the specular term (and the view direction it needs) entirely.
+	 *
+	 * \tparam Diffuse Whether to add the diffuse term.
+	 * \tparam Specular Whether to add the specular term.
+	 * \tparam FastMath Whether to use the fastMath approximations.
+	 * \param light The (non-ambient) LightSource illuminating the hit point.
+	 * \param hitPoint The intersection being shaded.
+	 * \param ray The Ray which produced the intersection.
+	 * \param hitColour The Colour to add the contributions to.
+	 */
+	template <bool Diffuse, bool Specular, bool FastMath>
+	void directLightingKernel(const LightSource& light, const RayIntersection& hitPoint, const Ray& ray, PackedColour& hitColour) const;
+
+	/** \brief Compute the mirror reflection of a Ray about the surface Normal at a hit point.
+	 *
+	 * \param ray The Ray which produced the intersection.
+	 * \param hitPoint The intersection being reflected from.
+	 * \return The reflected Ray, starting at the hit point.
+	 */
+	Ray computeReflectedRay(const Ray& ray, const RayIntersection& hitPoint) const;
 
 };
 
@@ -0,0 +1,116 @@
+#include "SceneJob.h"
+
+#include "SceneReader.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+SceneJob::SceneJob(int line) :
+	sceneFiles(), width(0), height(0), samples(0), rayDepth(-1), line(line), settings() {
+
+}
+
+std::vector<SceneJob> SceneJob::readList(const std::string& filename, const std::string& description, const std::vector<std::string>& keys) {
+	std::ifstream fin(filename);
+	if (!fin) {
+		std::cerr << "Could not read " << description << " " << filename << std::endl;
+		exit(-1);
+	}
+
+	std::vector<SceneJob> jobs;
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(fin, line)) {
+		++lineNumber;
+		SceneJob job(lineNumber);
+		bool hasSettings = false;
+		std::stringstream strstream(line);
+		std::string token;
+		while (strstream >> token) {
+			if (token[0] == '#') {
+				// A comment - skip the rest of the line
+				break;
+			}
+			const size_t equals = token.find('=');
+			if (equals == std::string::npos) {
+				job.sceneFiles.push_back(token);
+				continue;
+			}
+			hasSettings = true;
+			const std::string key = toUpper(token.substr(0, equals));
+			const std::string value = token.substr(equals + 1);
+			std::istringstream valueStream(value);
+			char x = 0;
+			bool valid = !value.empty();
+			if (key == "SIZE") {
+				valid = (valueStream >> job.width >> x >> job.height) && (x == 'x' || x == 'X') && job.width > 0 && job.height > 0;
+			} else if (key == "SAMPLES") {
+				valid = (valueStream >> job.samples) && job.samples > 0;
+			} else if (key == "RAYDEPTH") {
+				valid = (valueStream >> job.rayDepth) && job.rayDepth >= 0;
+			} else if (std::find(keys.begin(), keys.end(), key) != keys.end()) {
+				job.settings[key] = value;
+			} else {
+				valid = false;
+			}
+			if (!valid) {
+				std::cerr << "Unexpected setting '" << token << "' on line " << lineNumber << " of " << filename << std::endl;
+				exit(-1);
+			}
+		}
+		if (!job.sceneFiles.empty()) {
+			jobs.push_back(job);
+		} else if (hasSettings) {
+			std::cerr << "No scene files given on line " << lineNumber << " of " << filename << std::endl;
+			exit(-1);
+		}
+	}
+	return jobs;
+}
+
+bool SceneJob::load(Scene& scene, const SceneSetup& setup, const std::string& directory, std::string& error) const {
+	setup(scene);
+	scene.showProgress = false;
+	try {
+		SceneReader reader(&scene, false);
+		for (const std::string& sceneFile : sceneFiles) {
+			std::ifstream fin(relativeTo(directory, sceneFile));
+			if (!fin) {
+				throw std::runtime_error("could not read " + sceneFile);
+			}
+			reader.read(fin, sceneFile);
+		}
+	} catch (const std::runtime_error& readError) {
+		error = readError.what();
+		return false;
+	}
+	if (width > 0) {
+		scene.renderWidth = width;
+		scene.renderHeight = height;
+	}
+	if (samples > 0) scene.samplesPerPixel = samples;
+	if (rayDepth >= 0) scene.maxRayDepth = (unsigned int)rayDepth;
+	if (!scene.hasCamera()) {
+		error = "cannot render a scene with no camera";
+		return false;
+	}
+	if (scene.renderWidth == 0 || scene.renderHeight == 0) {
+		error = "cannot render an empty image";
+		return false;
+	}
+	return true;
+}
+
+std::string SceneJob::setting(const std::string& key) const {
+	const auto found = settings.find(key);
+	return found == settings.end() ? std::string() : found->second;
+}
+
+std::string SceneJob::relativeTo(const std::string& directory, const std::string& filename) {
+	return filename.empty() || filename[0] == '/' ? filename : directory + filename;
+}
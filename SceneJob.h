@@ -0,0 +1,90 @@
+#pragma once
+
+#ifndef SCENE_JOB_H_INCLUDED
+#define SCENE_JOB_H_INCLUDED
+
+#include "Scene.h"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+/** \file
+ * \brief SceneJob class header file.
+ */
+
+/** \brief A function to apply default settings to each Scene before it is read. */
+typedef std::function<void(Scene&)> SceneSetup;
+
+/**
+ * \brief One line of a list of scenes to render, as used by BatchRenderer and RegressionSuite.
+ *
+ * Each line lists one or more scene files (combined into one Scene, as on the command
+ * line), followed by settings of the form <tt>key=value</tt>. The settings every list
+ * allows are:
+ * - <tt>size=[width]x[height]</tt>: Set the Scene's \c renderWidth and \c renderHeight.
+ * - <tt>samples=[count]</tt>: Set the Scene's \c samplesPerPixel.
+ * - <tt>raydepth=[depth]</tt>: Set the Scene's \c maxRayDepth.
+ *
+ * Each kind of list names any others it allows, which are kept in \c settings for it
+ * to interpret. Blank lines, and anything after a \c #, are ignored.
+ */
+class SceneJob {
+
+public:
+
+	/** \brief SceneJob constructor, with no scene files and no settings.
+	 *
+	 * \param line The line of the list the job is on.
+	 */
+	explicit SceneJob(int line = 0);
+
+	/** \brief Read the jobs from a list.
+	 *
+	 * If the list cannot be read, or has errors, the program is terminated.
+	 *
+	 * \param filename The name of the list file.
+	 * \param description What the list is, for error messages, such as "batch manifest".
+	 * \param keys The upper case names of the settings allowed besides size, samples, and raydepth.
+	 * \return The jobs, in the order listed.
+	 */
+	static std::vector<SceneJob> readList(const std::string& filename, const std::string& description, const std::vector<std::string>& keys);
+
+	/** \brief Read the job's scene files into a Scene, and apply its settings.
+	 *
+	 * The Scene is given its defaults by setup first, and does not show its progress.
+	 *
+	 * \param scene The Scene to read into, which should be newly constructed.
+	 * \param setup Function to apply default settings to the Scene.
+	 * \param directory The directory that scene file names are relative to, ending in a \c /, or empty.
+	 * \param error Set to what went wrong, if the Scene cannot be rendered.
+	 * \return true if the Scene was read and can be rendered, false otherwise.
+	 */
+	bool load(Scene& scene, const SceneSetup& setup, const std::string& directory, std::string& error) const;
+
+	/** \brief The value of one of the other settings.
+	 *
+	 * \param key The upper case name of the setting.
+	 * \return Its value, or an empty string if it was not given.
+	 */
+	std::string setting(const std::string& key) const;
+
+	/** \brief A file name relative to a directory, unless it is absolute.
+	 *
+	 * \param directory The directory, ending in a \c /, or empty.
+	 * \param filename The file name.
+	 * \return The file name, relative to the directory.
+	 */
+	static std::string relativeTo(const std::string& directory, const std::string& filename);
+
+	std::vector<std::string> sceneFiles;         //!< Scene files to read, in order.
+	unsigned int width;                          //!< Width override, or 0 for none.
+	unsigned int height;                         //!< Height override, or 0 for none.
+	unsigned int samples;                        //!< Samples per pixel override, or 0 for none.
+	int rayDepth;                                //!< Ray depth override, or -1 for none.
+	int line;                                    //!< Line of the list the job is on.
+	std::map<std::string, std::string> settings; //!< The other settings, by upper case name.
+};
+
+#endif // SCENE_JOB_H_INCLUDED
@@ -19,15 +19,19 @@
 #include "Sphere.h"
 #include "Tube.h"
 
+#include "Trace.h"
+
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <memory>
 #include <queue>
 #include <sstream>
+#include <stdexcept>
 
 
-SceneReader::SceneReader(Scene* scene) :
-scene_(scene), startLine_(0) {
+SceneReader::SceneReader(Scene* scene, bool exitOnError) :
+scene_(scene), exitOnError_(exitOnError), startLine_(0) {
 
 }
 
@@ -36,8 +40,7 @@ SceneReader::~SceneReader() {
 }
 
 void SceneReader::parseTokenBlock(std::queue<std::string>& tokenBlock) {
-	std::string blockType = toUpper(tokenBlock.front());
-	tokenBlock.pop();
+	std::string blockType = toUpper(nextToken(tokenBlock));
 	if (blockType == "SCENE") {
 		parseSceneBlock(tokenBlock);
 	} else if (blockType == "CAMERA") {
@@ -49,8 +52,7 @@ void SceneReader::parseTokenBlock(std::queue<std::string>& tokenBlock) {
 	} else if (blockType == "MATERIAL") {
 		parseMaterialBlock(tokenBlock);
 	} else {
-		std::cerr << "Unexpected block type '" << blockType << "' starting on line " << startLine_ << std::endl;
-		exit(-1);
+		fail("Unexpected block type '" + blockType + "' starting on line " + std::to_string(startLine_));
 	}
 }
 
@@ -59,12 +61,19 @@ void SceneReader::read(const std::string& filename) {
 	std::cout << "Reading scene from " << filename << std::endl;
 
 	std::ifstream fin(filename);
+	read(fin, filename);
+	fin.close();
+
+}
+
+void SceneReader::read(std::istream& in, const std::string& name) {
 
+	TRACE_SCOPE("scene", "SceneReader::read");
 	std::string line;
 	int lineNumber = 0;
 	startLine_ = 0;
 	std::queue<std::string> tokenBlock;
-	while (std::getline(fin, line)) {
+	while (std::getline(in, line)) {
 		++lineNumber;
 		std::stringstream strstream(line);
 		std::string token;
@@ -84,19 +93,32 @@ void SceneReader::read(const std::string& filename) {
 	}
 
 	if (tokenBlock.size() > 0) {
-		std::cerr << "Unexpected end of file in " << filename << std::endl;
-		exit(-1);
+		fail("Unexpected end of file in " + name);
 	}
 
-	fin.close();
+}
 
+void SceneReader::fail(const std::string& message) const {
+	if (!exitOnError_) {
+		throw std::runtime_error(message);
+	}
+	std::cerr << message << std::endl;
+	exit(-1);
+}
+
+std::string SceneReader::nextToken(std::queue<std::string>& tokenBlock) const {
+	if (tokenBlock.empty()) {
+		fail("Unexpected end of block starting on line " + std::to_string(startLine_));
+	}
+	std::string token = tokenBlock.front();
+	tokenBlock.pop();
+	return token;
 }
 
 
 void SceneReader::parseSceneBlock(std::queue<std::string>& tokenBlock)  {
 	while (tokenBlock.size() > 0) {
-		std::string token = toUpper(tokenBlock.front());
-		tokenBlock.pop();
+		std::string token = toUpper(nextToken(tokenBlock));
 		if (token == "AMBIENTLIGHT") {
 			scene_->ambientLight = parseColour(tokenBlock);
 		} else if (token == "BACKGROUNDCOLOUR") {
@@ -105,27 +127,54 @@ void SceneReader::parseSceneBlock(std::queue<std::string>& tokenBlock)  {
 			scene_->renderWidth = int(parseNumber(tokenBlock));
 			scene_->renderHeight = int(parseNumber(tokenBlock));
 		} else if (token == "FILENAME") {
-			scene_->filename = tokenBlock.front();
-			tokenBlock.pop();
+			scene_->filename = nextToken(tokenBlock);
 			std::string& fname = scene_->filename;
 			std::transform(fname.begin(), fname.end(), fname.begin(), tolower);
 		} else if (token == "RAYDEPTH") {
 			scene_->maxRayDepth = int(parseNumber(tokenBlock));
+		} else if (token == "SAMPLES") {
+			scene_->samplesPerPixel = std::max(1, int(parseNumber(tokenBlock)));
+		} else if (token == "HDR") {
+			scene_->hdr = true;
+		} else if (token == "DENOISE") {
+			scene_->denoise = true;
+		} else if (token == "FASTMATH") {
+			scene_->fastMath = true;
+		} else if (token == "EXPOSURE") {
+			scene_->toneMapping.exposure = parseNumber(tokenBlock);
+		} else if (token == "GAMMA") {
+			scene_->toneMapping.gamma = parseNumber(tokenBlock);
+			if (scene_->toneMapping.gamma <= 0) {
+				fail("Gamma must be positive in block starting on line " + std::to_string(startLine_));
+			}
+		} else if (token == "TONECURVE") {
+			scene_->toneMapping.curve = parseToneCurve(nextToken(tokenBlock));
+		} else if (token == "SRGB") {
+			scene_->toneMapping.srgb = true;
+		} else if (token == "DITHER") {
+			scene_->toneMapping.dither = true;
 		} else {
-			std::cerr << "Unexpected token '" << token << "' in block starting on line " << startLine_ << std::endl;
-			exit(-1);
+			fail("Unexpected token '" + token + "' in block starting on line " + std::to_string(startLine_));
 		}
 	}
 }
 
+ToneMapping::Curve SceneReader::parseToneCurve(const std::string& name) const {
+	const std::string curve = toUpper(name);
+	if (curve == "CLAMP") {
+		return ToneMapping::Curve::Clamp;
+	} else if (curve == "REINHARD") {
+		return ToneMapping::Curve::Reinhard;
+	}
+	fail("Unexpected tone curve '" + name + "' in block starting on line " + std::to_string(startLine_));
+}
+
 double SceneReader::parseNumber(std::queue<std::string>& tokenBlock) {
-	std::string token = tokenBlock.front();
-	tokenBlock.pop();
+	std::string token = nextToken(tokenBlock);
 	char *endPtr;
 	double result = strtod(token.c_str(), &endPtr);
 	if (endPtr != token.c_str()+token.length()) {
-		std::cerr << "Expected a number but found '" << token << "' in block starting on line " << startLine_ << std::endl;
-		exit(-1);
+		fail("Expected a number but found '" + token + "' in block starting on line " + std::to_string(startLine_));
 	} 
 	return result;
 }
@@ -140,25 +189,26 @@ Colour SceneReader::parseColour(std::queue<std::string>& tokenBlock) {
 
 void SceneReader::parseCameraBlock(std::queue<std::string>& tokenBlock){
 	// Make a new camera
-	std::string cameraType = toUpper(tokenBlock.front());
-	tokenBlock.pop();
+	std::string cameraType = toUpper(nextToken(tokenBlock));
 	std::shared_ptr<Camera> camera;
 	if (cameraType == "PINHOLECAMERA") {
 		double focalLength = parseNumber(tokenBlock);
 		camera = std::shared_ptr<PinholeCamera>(new PinholeCamera(focalLength));
-		scene_->setCamera(camera);
 	} else {
-		std::cerr << "Unexpected camera type '" << cameraType << "' in block starting on line " << startLine_ << std::endl;
-		exit(-1);
+		fail("Unexpected camera type '" + cameraType + "' in block starting on line " + std::to_string(startLine_));
 	}
 
 	// Parse camera details
+	std::string name;
+	std::string filename;
 	while (tokenBlock.size() > 0) {
-		std::string token = toUpper(tokenBlock.front());
-		tokenBlock.pop();
-		if (token == "ROTATE") {
-			std::string axis = toUpper(tokenBlock.front()); 
-			tokenBlock.pop();
+		std::string token = toUpper(nextToken(tokenBlock));
+		if (token == "NAME") {
+			name = nextToken(tokenBlock);
+		} else if (token == "FILENAME") {
+			filename = nextToken(tokenBlock);
+		} else if (token == "ROTATE") {
+			std::string axis = toUpper(nextToken(tokenBlock));
 			double angle = parseNumber(tokenBlock);
 			if (axis == "X") {
 				camera->transform.rotateX(angle);
@@ -167,8 +217,7 @@ void SceneReader::parseCameraBlock(std::queue<std::string>& tokenBlock){
 			} else if (axis == "Z") {
 				camera->transform.rotateZ(angle);
 			} else {
-				std::cerr << "Unexpected axis '" << axis << "' in block starting on line " << startLine_ << std::endl;
-				exit(-1);
+				fail("Unexpected axis '" + axis + "' in block starting on line " + std::to_string(startLine_));
 			}
 		} else if (token == "TRANSLATE") {
 			double tx = parseNumber(tokenBlock);
@@ -184,26 +233,31 @@ void SceneReader::parseCameraBlock(std::queue<std::string>& tokenBlock){
 			double sz = parseNumber(tokenBlock);
 			camera->transform.scale(sx, sy, sz);
 		} else {
-			std::cerr << "Unexpected token '" << token << "' in block starting on line " << startLine_ << std::endl;
-			exit(-1);
+			fail("Unexpected token '" + token + "' in block starting on line " + std::to_string(startLine_));
 		}
 
 	}
 
+	if (!name.empty()) {
+		scene_->addCamera(name, camera, filename);
+	} else if (!filename.empty()) {
+		fail("A Camera with a Filename must also have a Name, in block starting on line " + std::to_string(startLine_));
+	} else {
+		scene_->setCamera(camera);
+	}
+
 }
 
 void SceneReader::parseLightBlock(std::queue<std::string>& tokenBlock) {
 
-	std::string lightType = toUpper(tokenBlock.front());
-	tokenBlock.pop();
+	std::string lightType = toUpper(nextToken(tokenBlock));
 	Point location;
 	Colour colour;
 	Direction direction;
 	double angle = 0;
 
 	while (tokenBlock.size() > 0) {
-		std::string token = toUpper(tokenBlock.front());
-		tokenBlock.pop();
+		std::string token = toUpper(nextToken(tokenBlock));
 		if (token == "LOCATION") {
 			location(0) = parseNumber(tokenBlock);
 			location(1) = parseNumber(tokenBlock);
@@ -215,8 +269,7 @@ void SceneReader::parseLightBlock(std::queue<std::string>& tokenBlock) {
 			direction(1) = parseNumber(tokenBlock);
 			direction(2) = parseNumber(tokenBlock);
 		} else {
-			std::cerr << "Unexpected token '" << token << "' in block starting on line " << startLine_ << std::endl;
-			exit(-1);
+			fail("Unexpected token '" + token + "' in block starting on line " + std::to_string(startLine_));
 		}
 	}
 
@@ -228,8 +281,7 @@ void SceneReader::parseLightBlock(std::queue<std::string>& tokenBlock) {
 	} else if (lightType == "DIRECTIONALLIGHT" ){
 		light = std::shared_ptr<DirectionalLightSource>(new DirectionalLightSource(colour, direction));
 	} else {
-		std::cerr << "Unexpected light type '" << lightType << "' in block starting on line " << startLine_ << std::endl;
-		exit(-1);
+		fail("Unexpected light type '" + lightType + "' in block starting on line " + std::to_string(startLine_));
 	}
 	scene_->addLight(light);
 
@@ -237,8 +289,7 @@ void SceneReader::parseLightBlock(std::queue<std::string>& tokenBlock) {
 }
 
 std::shared_ptr<Object> SceneReader::parseObjectBlock(std::queue<std::string>& tokenBlock) {
-	std::string objectType = toUpper(tokenBlock.front());
-	tokenBlock.pop();
+	std::string objectType = toUpper(nextToken(tokenBlock));
 	std::shared_ptr<Object> object;
 	if (objectType == "SPHERE") {
 		object = std::shared_ptr<Sphere>(new Sphere());
@@ -252,18 +303,15 @@ std::shared_ptr<Object> SceneReader::parseObjectBlock(std::queue<std::string>& t
 		double ratio = parseNumber(tokenBlock);
 		object = std::shared_ptr<Tube>(new Tube(ratio));
 	} else {
-		std::cerr << "Unexpected object type '" << objectType << "' in block starting on line " << startLine_ << std::endl;
-		exit(-1);
+		fail("Unexpected object type '" + objectType + "' in block starting on line " + std::to_string(startLine_));
 	}
 	scene_->addObject(object);
 
 	// Parse object details
 	while (tokenBlock.size() > 0) {
-		std::string token = toUpper(tokenBlock.front());
-		tokenBlock.pop();
+		std::string token = toUpper(nextToken(tokenBlock));
 		if (token == "ROTATE") {
-			std::string axis = toUpper(tokenBlock.front()); 
-			tokenBlock.pop();
+			std::string axis = toUpper(nextToken(tokenBlock));
 			double angle = parseNumber(tokenBlock);
 			if (axis == "X") {
 				object->transform.rotateX(angle);
@@ -272,8 +320,7 @@ std::shared_ptr<Object> SceneReader::parseObjectBlock(std::queue<std::string>& t
 			} else if (axis == "Z") {
 				object->transform.rotateZ(angle);
 			} else {
-				std::cerr << "Unexpected axis '" << axis << "' in block starting on line " << startLine_ << std::endl;
-				exit(-1);
+				fail("Unexpected axis '" + axis + "' in block starting on line " + std::to_string(startLine_));
 			}
 		} else if (token == "TRANSLATE") {
 			double tx = parseNumber(tokenBlock);
@@ -289,12 +336,10 @@ std::shared_ptr<Object> SceneReader::parseObjectBlock(std::queue<std::string>& t
 			double sz = parseNumber(tokenBlock);
 			object->transform.scale(sx, sy, sz);
 		} else if (token == "MATERIAL") {
-			std::string materialName = tokenBlock.front();
-			tokenBlock.pop();
+			std::string materialName = nextToken(tokenBlock);
 			auto material = materials_.find(materialName);
 			if (material == materials_.end()) {
-				std::cerr << "Undefined material '" << materialName << "' in block starting on line " << startLine_ << std::endl;
-				exit(1);
+				fail("Undefined material '" + materialName + "' in block starting on line " + std::to_string(startLine_));
 			} else {
 				object->material = material->second;
 			}
@@ -312,8 +357,7 @@ std::shared_ptr<Object> SceneReader::parseObjectBlock(std::queue<std::string>& t
 		} else if (token == "MIRROR") {
 			object->material.mirrorColour = parseColour(tokenBlock);
 		} else {
-			std::cerr << "Unexpected token '" << token << "' in block starting on line " << startLine_ << std::endl;
-			exit(-1);
+			fail("Unexpected token '" + token + "' in block starting on line " + std::to_string(startLine_));
 		}
 
 	}
@@ -321,8 +365,7 @@ std::shared_ptr<Object> SceneReader::parseObjectBlock(std::queue<std::string>& t
 }
 
 void SceneReader::parseMaterialBlock(std::queue<std::string>& tokenBlock) {
-	std::string materialName = tokenBlock.front();
-	tokenBlock.pop();
+	std::string materialName = nextToken(tokenBlock);
 	if (materials_.find(materialName) == materials_.end()) {
 		materials_[materialName] = Material();
 	} else {
@@ -331,8 +374,7 @@ void SceneReader::parseMaterialBlock(std::queue<std::string>& tokenBlock) {
 	Material& material = materials_.find(materialName)->second;
 
 	while (tokenBlock.size() > 0) {
-		std::string token = toUpper(tokenBlock.front());
-		tokenBlock.pop();
+		std::string token = toUpper(nextToken(tokenBlock));
 		if (token == "COLOUR") {
 			Colour objColour = parseColour(tokenBlock);
 			material.ambientColour = objColour;
@@ -347,8 +389,7 @@ void SceneReader::parseMaterialBlock(std::queue<std::string>& tokenBlock) {
 		} else if (token == "MIRROR") {
 			material.mirrorColour = parseColour(tokenBlock);
 		} else {
-			std::cerr << "Unexpected token '" << token << "' in block starting on line " << startLine_ << std::endl;
-			exit(-1);
+			fail("Unexpected token '" + token + "' in block starting on line " + std::to_string(startLine_));
 		}
 
 	}
@@ -9,6 +9,7 @@
 #include "Material.h"
 #include "Scene.h"
 
+#include <istream>
 #include <map>
 #include <queue>
 #include <string>
@@ -51,8 +52,18 @@
  * Allowed elements within a Scene block are:
  * - <tt>renderSize [width] [height]</tt>: Set the Scene's \c renderWidth and \c renderHeight properties to the given values.
  * - <tt>backgroundColour [red] [green] [blue]</tt>: Set the Scene's \c backgroundColour property to the given Colour.
- * - <tt>filename [file]</tt>: Set the Scene's \c filename property to the given value.
+ * - <tt>filename [file]</tt>: Set the Scene's \c filename property to the given value. The image format is chosen by
+ *   the extension: \c .qoi, \c .tga, \c .ppm, or \c .pfm (linear floating point), and PNG for anything else.
  * - <tt>rayDepth [number]</tt>: Set the Scene's \c rayDepth property to the given value.
+ * - <tt>samples [number]</tt>: Set the Scene's \c samplesPerPixel property to the given value.
+ * - <tt>hdr</tt>: Set the Scene's \c hdr property, so Colours are not clipped at each bounce.
+ * - <tt>denoise</tt>: Set the Scene's \c denoise property, so the image is filtered once it is rendered.
+ * - <tt>fastMath</tt>: Set the Scene's \c fastMath property, so shading uses fast approximations.
+ * - <tt>exposure [stops]</tt>: Set the exposure adjustment of the Scene's \c toneMapping.
+ * - <tt>gamma [value]</tt>: Set the display gamma of the Scene's \c toneMapping.
+ * - <tt>toneCurve [curve]</tt>: Set the tone curve of the Scene's \c toneMapping, either \c clamp or \c reinhard.
+ * - <tt>srgb</tt>: Encode pixels with the sRGB transfer curve rather than the gamma.
+ * - <tt>dither</tt>: Add an ordered dither to pixels before they are quantized.
  *
  * <b>Camera Blocks</b>
  *
@@ -71,6 +82,10 @@ End
  * - <tt>Translate [x] [y] [z]</tt>: Apply the specified translation to the Camera.
  * - <tt>Scale [s]</tt>: Apply a uniform scaling by the given value to the Camera.
  * - <tt>Scale3 [sx] [sy] [sz]</tt>: Apply different scaling factors along the three axes to the Camera.
+ * - <tt>Name [name]</tt>: Add the Camera as a named view, rather than replacing the Scene's default Camera.
+ *   Every view is rendered, so a pair of named Cameras can give the left and right images of a stereo pair.
+ * - <tt>Filename [file]</tt>: The file to save a named view to. By default the name is added to the 
+ *   Scene's filename, so \c render.png becomes \c render_[name].png.
  *
  * <b>Light Blocks</b>
  *
@@ -155,8 +170,10 @@ public:
 	/** \brief SceneReader constructor. 
 	 * 
 	 * \param scene A pointer to the Scene which data will be read into.
+	 * \param exitOnError If true (the default) errors in the input terminate the program,
+	 *                    otherwise they are reported by throwing a \c std::runtime_error.
 	 */
-	SceneReader(Scene* scene);
+	SceneReader(Scene* scene, bool exitOnError = true);
 
 	/** \brief SceneReader destructor. */
 	~SceneReader();
@@ -167,14 +184,43 @@ public:
 	 * It adds information to the Scene linked to this SceneReader, and so 
 	 * multiple files can be combined into one Scene.
 	 *
-	 * If an error is encountered parsing the file, the program is terminated.
+	 * If an error is encountered parsing the file, it is reported as described in SceneReader().
 	 *
 	 * \param filename The name of the file to read.
 	 */
 	void read(const std::string& filename);
 
+	/** \brief Read Scene data from a stream.
+	 *
+	 * This is the same as read(const std::string&), but reads from a stream
+	 * that is already open, such as a \c std::istringstream holding a scene
+	 * received from elsewhere.
+	 *
+	 * \param in The stream to read from.
+	 * \param name A name for the stream, used in error messages.
+	 */
+	void read(std::istream& in, const std::string& name);
+
 private:
 
+	/** \brief Report an error in the input.
+	 *
+	 * Depending on how the SceneReader was constructed, this either prints the
+	 * message and terminates the program, or throws a \c std::runtime_error.
+	 *
+	 * \param message A description of the error.
+	 */
+	[[noreturn]] void fail(const std::string& message) const;
+
+	/** \brief Take the next token from a block of tokens.
+	 *
+	 * If the block is empty this is an error, and fail() is called.
+	 *
+	 * \param tokenBlock A sequence of tokens.
+	 * \return The first token in the block, which is removed from the block.
+	 */
+	std::string nextToken(std::queue<std::string>& tokenBlock) const;
+
 	/** \brief Parse a block of tokens. 
 	 *
 	 * When reading a file, it is separated into a squence of tokens (words and numbers)
@@ -210,6 +256,15 @@ private:
 	 */
 	double parseNumber(std::queue<std::string>& tokenBlock);
 
+	/** \brief Interpret the name of a ToneMapping::Curve.
+	 *
+	 * If the name is not recognised, fail() is called.
+	 *
+	 * \param name The name of the curve (\c clamp or \c reinhard, in any case).
+	 * \return The curve.
+	 */
+	ToneMapping::Curve parseToneCurve(const std::string& name) const;
+
 	/** \brief Parse a block of tokens representing a Scene. 
 	 *
 	 * This method reads Scene information from a block of tokens.
@@ -261,6 +316,7 @@ private:
 	void parseMaterialBlock(std::queue<std::string>& tokenBlock);
 
 	Scene* scene_; //!< The Scene which information is read to.
+	bool exitOnError_; //!< Whether errors terminate the program, rather than throwing.
 	int startLine_; //!< The first line of the current block being parsed, for error reporting.
 	std::map<std::string, Material> materials_; //!< A dictionary of Material types that have been read, and which can be used for subsequent Object properties.
 };
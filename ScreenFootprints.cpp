@@ -0,0 +1,51 @@
+#include "ScreenFootprints.h"
+
+#include "utility.h"
+
+#include <cmath>
+
+ScreenFootprints::ScreenFootprints(const Camera& camera, const std::vector<std::shared_ptr<Object>>& objects,
+                                   unsigned int width, unsigned int height, unsigned int tileSize) :
+	camera_(camera),
+	tileSize_(tileSize), 
+	tilesX_((width + tileSize - 1) / tileSize), 
+	tilesY_((height + tileSize - 1) / tileSize), 
+	candidates_(size_t(tilesX_) * tilesY_) {
+
+	if (width == 0 || height == 0) return;
+
+	const double w = double(width);
+	const double h = double(height);
+
+	for (unsigned int ix = 0; ix < objects.size(); ++ix) {
+		// Pixel range of the footprint (inclusive), defaulting to the whole image
+		long minU = 0, minV = 0, maxU = long(width) - 1, maxV = long(height) - 1;
+
+		double minX, minY, maxX, maxY;
+		if (camera.projectBounds(objects[ix]->getBounds(), minX, minY, maxX, maxY)) {
+			if (minX > maxX || minY > maxY) continue; // Cannot be seen at all
+
+			// Invert the image plane co-ordinates used by Scene::castPrimaryRay(), with a pixel of padding
+			const double lowU = std::floor((minX + 1) * w/2 - 0.5) - 1;
+			const double highU = std::ceil((maxX + 1) * w/2 - 0.5) + 1;
+			const double lowV = std::floor((minY + h/w) * w/2 - 0.5) - 1;
+			const double highV = std::ceil((maxY + h/w) * w/2 - 0.5) + 1;
+			if (highU < 0 || highV < 0 || lowU >= w || lowV >= h) continue; // Off screen
+
+			minU = long(std::max(lowU, 0.0));
+			minV = long(std::max(lowV, 0.0));
+			maxU = long(std::min(highU, w - 1));
+			maxV = long(std::min(highV, h - 1));
+		}
+
+		for (long ty = minV / tileSize_; ty <= maxV / long(tileSize_); ++ty) {
+			for (long tx = minU / tileSize_; tx <= maxU / long(tileSize_); ++tx) {
+				candidates_[ty*tilesX_ + tx].push_back(ix);
+			}
+		}
+	}
+}
+
+ScreenFootprints::~ScreenFootprints() {
+
+}
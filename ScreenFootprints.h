@@ -0,0 +1,103 @@
+#pragma once
+
+#ifndef SCREEN_FOOTPRINTS_H_INCLUDED
+#define SCREEN_FOOTPRINTS_H_INCLUDED
+
+#include "Camera.h"
+#include "NonCopyable.h"
+#include "Object.h"
+
+#include <memory>
+#include <vector>
+
+/** \file
+ * \brief ScreenFootprints class header file.
+ */
+
+/**
+ * \brief Lists of the Objects that primary Rays can hit, per image tile.
+ *
+ * The image is divided into square tiles, and the BoundingBox of each Object is 
+ * projected through the Camera to find the part of the image it can appear in 
+ * (its footprint). Each tile then keeps a list of the Objects whose footprint 
+ * overlaps it. A primary Ray through a pixel in the tile can only hit those
+ * Objects, so the others need not be tested, and a tile with no Objects at all
+ * shows only the background.
+ *
+ * The footprints are conservative: they are padded by a pixel, and any Object
+ * which the Camera cannot project is listed in every tile.
+ */
+class ScreenFootprints : private NonCopyable {
+
+public:
+
+	static const unsigned int defaultTileSize = 16; //!< The width and height of tiles unless another size is given.
+
+	/** \brief Build the tile lists for a Camera and a set of Objects.
+	 *
+	 * \param camera The Camera that primary Rays are cast from.
+	 * \param objects The Objects to sort into tiles. Indices in the tile lists refer to this vector.
+	 * \param width The width of the image in pixels.
+	 * \param height The height of the image in pixels.
+	 * \param tileSize The width and height of each tile in pixels.
+	 */
+	ScreenFootprints(const Camera& camera, const std::vector<std::shared_ptr<Object>>& objects,
+	                 unsigned int width, unsigned int height, unsigned int tileSize = defaultTileSize);
+
+	/** \brief ScreenFootprints destructor. */
+	~ScreenFootprints();
+
+	/** \brief The Camera that the tile lists were built for.
+	 *
+	 * \return The Camera, which must outlive the ScreenFootprints.
+	 */
+	const Camera& camera() const { return camera_; }
+
+	/** \brief The width and height of each tile in pixels.
+	 *
+	 * \return The tile size.
+	 */
+	unsigned int tileSize() const { return tileSize_; }
+
+	/** \brief The number of columns of tiles.
+	 *
+	 * \return The number of tiles across the image.
+	 */
+	unsigned int numTilesX() const { return tilesX_; }
+
+	/** \brief The number of rows of tiles.
+	 *
+	 * \return The number of tiles down the image.
+	 */
+	unsigned int numTilesY() const { return tilesY_; }
+
+	/** \brief The Objects which primary Rays in a tile can hit.
+	 *
+	 * \param tileX The column of the tile.
+	 * \param tileY The row of the tile.
+	 * \return The indices of the Objects, in their original order.
+	 */
+	const std::vector<unsigned int>& candidates(unsigned int tileX, unsigned int tileY) const {
+		return candidates_[tileY*tilesX_ + tileX];
+	}
+
+	/** \brief The Objects which the primary Ray through a pixel can hit.
+	 *
+	 * \param u The column of the pixel.
+	 * \param v The row of the pixel.
+	 * \return The indices of the Objects, in their original order.
+	 */
+	const std::vector<unsigned int>& candidatesAt(unsigned int u, unsigned int v) const {
+		return candidates(u / tileSize_, v / tileSize_);
+	}
+
+private:
+
+	const Camera& camera_;  //!< Camera that primary Rays are cast from.
+	unsigned int tileSize_; //!< Width and height of each tile in pixels.
+	unsigned int tilesX_;   //!< Number of columns of tiles.
+	unsigned int tilesY_;   //!< Number of rows of tiles.
+	std::vector<std::vector<unsigned int>> candidates_; //!< Object indices for each tile, row by row.
+};
+
+#endif // SCREEN_FOOTPRINTS_H_INCLUDED
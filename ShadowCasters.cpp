@@ -0,0 +1,44 @@
+#include "ShadowCasters.h"
+
+ShadowCasters::ShadowCasters(const std::vector<std::shared_ptr<LightSource>>& lights, const std::vector<std::shared_ptr<Object>>& objects) :
+	numObjects_(objects.size()), candidates_(), allObjects_() {
+
+	if (objects.size() > maxObjects) {
+		// Too many lists to build and keep, so every Object is tested
+		for (unsigned int object = 0; object < objects.size(); ++object) {
+			allObjects_.push_back(object);
+		}
+		return;
+	}
+
+	candidates_.resize(lights.size() * objects.size());
+	std::vector<BoundingBox> bounds;
+	for (const auto& object : objects) {
+		bounds.push_back(object->getBounds());
+	}
+
+	for (size_t l = 0; l < lights.size(); ++l) {
+		for (unsigned int receiver = 0; receiver < objects.size(); ++receiver) {
+			std::vector<unsigned int>& list = candidates_[l*numObjects_ + receiver];
+			for (unsigned int caster = 0; caster < objects.size(); ++caster) {
+				// An Object can shadow itself, and its bounds always meet the shadow region
+				if (caster == receiver || lights[l]->mayBeShadowedBy(bounds[caster], bounds[receiver])) {
+					list.push_back(caster);
+				}
+			}
+		}
+	}
+}
+
+ShadowCasters::~ShadowCasters() {
+
+}
+
+double ShadowCasters::density() const {
+	if (candidates_.empty() || numObjects_ == 0) return 1;
+	size_t total = 0;
+	for (const auto& list : candidates_) {
+		total += list.size();
+	}
+	return double(total) / (double(candidates_.size()) * numObjects_);
+}
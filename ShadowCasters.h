@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef SHADOW_CASTERS_H_INCLUDED
+#define SHADOW_CASTERS_H_INCLUDED
+
+#include "LightSource.h"
+#include "NonCopyable.h"
+#include "Object.h"
+
+#include <memory>
+#include <vector>
+
+/** \file
+ * \brief ShadowCasters class header file.
+ */
+
+/**
+ * \brief Lists of the Objects that shadow Rays can hit, per LightSource and receiving Object.
+ *
+ * A shadow Ray runs from a point on one Object (the receiver) towards a LightSource.
+ * It can only be blocked by an Object whose BoundingBox meets the region swept out
+ * between the receiver's BoundingBox and the light, as tested by 
+ * LightSource::mayBeShadowedBy(). The other Objects need not be tested.
+ *
+ * These lists depend only on the Objects and LightSources, not on the Camera, so
+ * they are built once and shared by every view of a Scene.
+ *
+ * There is a list for every (light, receiver) pair, each up to the number of Objects
+ * long, so building them takes time and memory in proportion to the number of lights
+ * times the square of the number of Objects. Above maxObjects they are not built at all,
+ * and every Object is a candidate for every shadow Ray.
+ */
+class ShadowCasters : private NonCopyable {
+
+public:
+
+	static const size_t maxObjects = 1024; //!< Most Objects for which the lists are built, at most 4MB per light.
+
+	/** \brief Build the shadow caster lists for a set of LightSources and Objects.
+	 *
+	 * \param lights The LightSources which cast shadows. Light indices refer to this vector.
+	 * \param objects The Objects in the Scene. Object indices refer to this vector.
+	 */
+	ShadowCasters(const std::vector<std::shared_ptr<LightSource>>& lights, const std::vector<std::shared_ptr<Object>>& objects);
+
+	/** \brief ShadowCasters destructor. */
+	~ShadowCasters();
+
+	/** \brief The Objects which might block light reaching a receiving Object.
+	 *
+	 * \param light The index of the LightSource.
+	 * \param receiver The index of the Object which the shadow Ray starts from.
+	 * \return The indices of the Objects which might block the shadow Ray, in increasing order.
+	 */
+	const std::vector<unsigned int>& candidates(size_t light, unsigned int receiver) const {
+		return candidates_.empty() ? allObjects_ : candidates_[light*numObjects_ + receiver];
+	}
+
+	/** \brief The fraction of (light, receiver, caster) combinations which need testing.
+	 *
+	 * \return A number from 0 to 1, where 1 means no shadow tests are saved.
+	 */
+	double density() const;
+
+private:
+
+	size_t numObjects_; //!< Number of Objects in the Scene.
+	std::vector<std::vector<unsigned int>> candidates_; //!< Object indices for each light and receiver, light-major, or empty if there are too many Objects.
+	std::vector<unsigned int> allObjects_;              //!< The index of every Object, for when candidates_ is not built.
+};
+
+#endif // SHADOW_CASTERS_H_INCLUDED
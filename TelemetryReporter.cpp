@@ -0,0 +1,102 @@
+#include "TelemetryReporter.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <unistd.h>
+
+TelemetryReporter::TelemetryReporter(const RenderProgress& progress, int fd, bool console, double intervalMs) :
+	progress_(progress), fd_(fd), console_(console), 
+	interval_(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(std::max(1.0, intervalMs)))),
+	start_(Clock::now()), lastSample_(start_), lastRays_(0), mutex_(), wake_(), stopping_(false), thread_() {
+	if (fd_ >= 0 || console_) {
+		thread_ = std::thread(&TelemetryReporter::run, this);
+	}
+}
+
+TelemetryReporter::~TelemetryReporter() {
+	if (!thread_.joinable()) return;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	thread_.join();
+	report(true);
+}
+
+unsigned long long TelemetryReporter::residentBytes() {
+#ifdef __linux__
+	// The second field of statm is the resident set size in pages
+	std::ifstream statm("/proc/self/statm");
+	unsigned long long size = 0, resident = 0;
+	if (statm >> size >> resident) {
+		return resident * (unsigned long long)sysconf(_SC_PAGESIZE);
+	}
+#endif
+	return 0;
+}
+
+void TelemetryReporter::run() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (!wake_.wait_for(lock, interval_, [this] { return stopping_; })) {
+		lock.unlock();
+		report(false);
+		lock.lock();
+	}
+}
+
+void TelemetryReporter::report(bool finished) {
+	const Clock::time_point now = Clock::now();
+	const double elapsed = std::chrono::duration<double>(now - start_).count();
+	const double sinceLast = std::chrono::duration<double>(now - lastSample_).count();
+	const unsigned long long unitsDone = progress_.unitsDone.load(std::memory_order_relaxed);
+	const unsigned long long pixelsDone = progress_.pixelsDone.load(std::memory_order_relaxed);
+	const unsigned long long rays = progress_.rays.load(std::memory_order_relaxed);
+
+	// Rays per second over the last interval, and the time left at the average rate so far,
+	// or until the deadline if that is sooner, as a render with a time budget stops there
+	const double raysPerSecond = finished ? (elapsed > 0 ? rays / elapsed : 0) : (sinceLast > 0 ? (rays - lastRays_) / sinceLast : 0);
+	const bool haveDeadline = progress_.deadline != Clock::time_point::max();
+	const bool haveRate = pixelsDone > 0 && pixelsDone <= progress_.pixelsTotal;
+	const bool haveEta = haveRate || haveDeadline;
+	double eta = haveRate ? elapsed * (progress_.pixelsTotal - pixelsDone) / pixelsDone : 0;
+	if (haveDeadline) {
+		const double untilDeadline = std::max(0.0, std::chrono::duration<double>(progress_.deadline - now).count());
+		eta = haveRate ? std::min(eta, untilDeadline) : untilDeadline;
+	}
+	if (finished) eta = 0;
+	lastSample_ = now;
+	lastRays_ = rays;
+
+	if (fd_ >= 0) {
+		std::ostringstream line;
+		line << "{\"event\":\"" << (finished ? "done" : "progress") << "\",\"elapsed_s\":" << elapsed 
+		     << ",\"unit\":\"" << progress_.unit << "\",\"units_done\":" << unitsDone << ",\"units_total\":" << progress_.unitsTotal
+		     << ",\"pixels_done\":" << pixelsDone << ",\"pixels_total\":" << progress_.pixelsTotal
+		     << ",\"rays\":" << rays << ",\"rays_per_s\":" << (unsigned long long)raysPerSecond << ",\"eta_s\":";
+		if (haveEta) {
+			line << eta;
+		} else {
+			line << "null";
+		}
+		line << ",\"rss_bytes\":" << residentBytes() << "}\n";
+		const std::string text = line.str();
+		// One write per line, so that lines from several renders are not mixed
+		size_t written = 0;
+		while (written < text.size()) {
+			const ssize_t result = ::write(fd_, text.data() + written, text.size() - written);
+			if (result <= 0) break;
+			written += size_t(result);
+		}
+	}
+
+	if (console_) {
+		std::cout << "Rendered " << unitsDone << " of " << progress_.unitsTotal << " " << progress_.unit << "s, " 
+		          << (unsigned long long)raysPerSecond << " rays/s";
+		if (haveEta && !finished) std::cout << ", " << eta << "s left";
+		std::cout << "        \r" << std::flush;
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#ifndef TELEMETRY_REPORTER_H_INCLUDED
+#define TELEMETRY_REPORTER_H_INCLUDED
+
+#include "NonCopyable.h"
+#include "RenderProgress.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/** \file
+ * \brief TelemetryReporter class header file.
+ */
+
+/**
+ * \brief Reports the progress of a render from a background thread.
+ *
+ * A TelemetryReporter samples a RenderProgress at a fixed interval, so render
+ * threads never write any output themselves. Each sample can be written as one 
+ * line of JSON to a file descriptor, for another program to follow, such as
+ *
+ *     {"event":"progress","elapsed_s":2.5,"unit":"tile","units_done":912,"units_total":1900,
+ *      "pixels_done":233472,"pixels_total":480000,"rays":1523781,"rays_per_s":611204,
+ *      "eta_s":2.64,"rss_bytes":48234496}
+ *
+ * (on a single line), and/or shown on the console as a single line that is 
+ * overwritten by each sample. The \c "eta_s" is the time left at the average rate
+ * so far, but no later than the RenderProgress::deadline of a render with a time
+ * budget, which stops then whether or not all its passes are done. A last sample,
+ * with \c "event":"done", is reported when the TelemetryReporter is destroyed.
+ */
+class TelemetryReporter : private NonCopyable {
+
+public:
+
+	/** \brief TelemetryReporter constructor.
+	 *
+	 * Starts the background thread, unless there is nowhere to report to.
+	 *
+	 * \param progress The counters to report. These must outlive the TelemetryReporter.
+	 * \param fd The file descriptor to write JSON lines to, or -1 for none. It is not closed.
+	 * \param console Whether to show the progress on \c std::cout.
+	 * \param intervalMs The time between samples, in milliseconds.
+	 */
+	TelemetryReporter(const RenderProgress& progress, int fd, bool console, double intervalMs);
+
+	/** \brief TelemetryReporter destructor.
+	 *
+	 * Stops the background thread, and reports the final sample.
+	 */
+	~TelemetryReporter();
+
+	/** \brief The memory used by this process.
+	 *
+	 * \return The resident set size in bytes, or 0 if it cannot be found.
+	 */
+	static unsigned long long residentBytes();
+
+private:
+
+	typedef std::chrono::steady_clock Clock; //!< Clock used to time the samples.
+
+	/** \brief The main loop of the background thread. */
+	void run();
+
+	/** \brief Sample the progress and report it.
+	 *
+	 * \param finished true for the final sample.
+	 */
+	void report(bool finished);
+
+	const RenderProgress& progress_;    //!< The counters to report.
+	int fd_;                            //!< Where to write JSON lines, or -1.
+	bool console_;                      //!< Whether to show progress on std::cout.
+	Clock::duration interval_;          //!< Time between samples.
+	Clock::time_point start_;           //!< When reporting started.
+	Clock::time_point lastSample_;      //!< When the last sample was taken.
+	unsigned long long lastRays_;       //!< Rays traced at the last sample.
+	std::mutex mutex_;                  //!< Protects stopping_.
+	std::condition_variable wake_;      //!< Signalled when stopping_ is set.
+	bool stopping_;                     //!< Set when the background thread should exit.
+	std::thread thread_;                //!< The background thread.
+};
+
+#endif // TELEMETRY_REPORTER_H_INCLUDED
@@ -0,0 +1,79 @@
+#include "ThreadPool.h"
+
+#include "NumaTopology.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <string>
+
+ThreadPool::ThreadPool(unsigned int numThreads, const std::vector<int>& cpus) : 
+	workers_(), nodes_(), mutex_(), wake_(), jobs_(), stopping_(false) {
+	if (numThreads == 0) {
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (unsigned int i = 0; i < numThreads; ++i) {
+		const int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+		nodes_.push_back(cpu < 0 ? 0 : NumaTopology::system().nodeOf(cpu));
+	}
+	for (unsigned int i = 0; i < numThreads; ++i) {
+		workers_.emplace_back(&ThreadPool::work, this, i, cpus.empty() ? -1 : cpus[i % cpus.size()]);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	for (auto& worker : workers_) {
+		worker.join();
+	}
+}
+
+unsigned int ThreadPool::size() const {
+	return (unsigned int)workers_.size();
+}
+
+void ThreadPool::parallelFor(size_t count, const Task& task) {
+	if (count == 0) return;
+
+	Job job;
+	job.task = &task;
+	job.count = count;
+	job.next = 0;
+	job.remaining = count;
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	jobs_.push_back(&job);
+	wake_.notify_all();
+	job.finished.wait(lock, [&job] { return job.remaining == 0; });
+}
+
+void ThreadPool::work(unsigned int worker, int cpu) {
+	if (cpu >= 0) {
+		NumaTopology::system().pinCurrentThread(cpu);
+	}
+	TRACE_THREAD_NAME("worker " + std::to_string(worker));
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		wake_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+		if (jobs_.empty()) return; // Stopping, and nothing left to do
+
+		// Claim the next iteration of the oldest loop
+		Job* job = jobs_.front();
+		const size_t iteration = job->next++;
+		if (job->next == job->count) {
+			jobs_.pop_front();
+		}
+
+		lock.unlock();
+		(*job->task)(iteration, worker);
+		lock.lock();
+
+		if (--job->remaining == 0) {
+			job->finished.notify_all();
+		}
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#ifndef THREAD_POOL_H_INCLUDED
+#define THREAD_POOL_H_INCLUDED
+
+#include "NonCopyable.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** \file
+ * \brief ThreadPool class header file.
+ */
+
+/**
+ * \brief A fixed set of worker threads which share out loops.
+ *
+ * Starting threads is relatively expensive, so a ThreadPool starts its workers 
+ * once and keeps them waiting for work. Work is given to the pool as a loop with
+ * parallelFor(), and each iteration of the loop is run by whichever worker is 
+ * free next. Iterations should be reasonably large (a tile of an image, say) 
+ * since handing out each one takes a lock.
+ *
+ * Several threads may call parallelFor() on the same pool at once, and their 
+ * loops are run in the order they were submitted. A task run by the pool must
+ * not itself call parallelFor() on the same pool.
+ */
+class ThreadPool : private NonCopyable {
+
+public:
+
+	/** \brief The type of a loop body.
+	 *
+	 * The first argument is the iteration number, and the second is the index
+	 * (from 0 to size()-1) of the worker running it. No two iterations of the
+	 * same loop are ever run by the same worker at the same time, so the worker
+	 * index can be used to select per-thread storage.
+	 */
+	typedef std::function<void(size_t, unsigned int)> Task;
+
+	/** \brief ThreadPool constructor.
+	 *
+	 * \param numThreads The number of worker threads. If this is 0, one thread is 
+	 *                   started for each hardware thread.
+	 * \param cpus CPUs to pin the workers to (see NumaTopology::cpuOrder()). Worker i
+	 *             is pinned to cpus[i % cpus.size()]. If this is empty, the workers
+	 *             are not pinned.
+	 */
+	explicit ThreadPool(unsigned int numThreads = 0, const std::vector<int>& cpus = std::vector<int>());
+
+	/** \brief ThreadPool destructor.
+	 *
+	 * Waits for any outstanding loops to finish, then stops the workers.
+	 */
+	~ThreadPool();
+
+	/** \brief The number of worker threads.
+	 *
+	 * \return The number of worker threads in the pool.
+	 */
+	unsigned int size() const;
+
+	/** \brief The NUMA node a worker thread runs on.
+	 *
+	 * \param worker The index of the worker.
+	 * \return The index of the node (see NumaTopology) of the worker's CPU, or 0 if
+	 *         the workers are not pinned.
+	 */
+	size_t nodeOf(unsigned int worker) const {
+		return nodes_[worker];
+	}
+
+	/** \brief Run a loop on the worker threads.
+	 *
+	 * Runs \c task(i, worker) for each i from 0 to count-1, and returns once 
+	 * they have all finished.
+	 *
+	 * \param count The number of iterations.
+	 * \param task The loop body.
+	 */
+	void parallelFor(size_t count, const Task& task);
+
+private:
+
+	/** \brief A loop submitted to the pool. */
+	struct Job {
+		const Task* task;  //!< The loop body.
+		size_t count;      //!< The number of iterations.
+		size_t next;       //!< The next iteration to hand out.
+		size_t remaining;  //!< The number of iterations not yet finished.
+		std::condition_variable finished; //!< Signalled when remaining reaches zero.
+	};
+
+	/** \brief The main loop of each worker thread.
+	 *
+	 * \param worker The index of the worker.
+	 */
+	void work(unsigned int worker, int cpu);
+
+	std::vector<std::thread> workers_; //!< The worker threads.
+	std::vector<size_t> nodes_;        //!< The NUMA node of each worker.
+	std::mutex mutex_;                 //!< Protects jobs_, stopping_, and the Job counters.
+	std::condition_variable wake_;     //!< Signalled when work arrives or the pool is stopping.
+	std::deque<Job*> jobs_;            //!< Loops with iterations still to be handed out.
+	bool stopping_;                    //!< Set when the workers should exit.
+};
+
+#endif // THREAD_POOL_H_INCLUDED
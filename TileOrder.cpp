@@ -0,0 +1,72 @@
+#include "TileOrder.h"
+
+#include "Random.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <utility>
+
+uint64_t hilbertIndex(uint32_t n, uint32_t x, uint32_t y) {
+	uint64_t index = 0;
+	for (uint32_t s = n / 2; s > 0; s /= 2) {
+		const uint32_t rx = (x & s) ? 1 : 0;
+		const uint32_t ry = (y & s) ? 1 : 0;
+		index += uint64_t(s) * s * ((3 * rx) ^ ry);
+		// Rotate the quadrant so the curve within it starts and ends in the right corners
+		if (ry == 0) {
+			if (rx == 1) {
+				x = n - 1 - x;
+				y = n - 1 - y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return index;
+}
+
+std::vector<unsigned int> orderTiles(TileOrder order, unsigned int tilesX, unsigned int tilesY, uint64_t seed) {
+	std::vector<unsigned int> tiles(size_t(tilesX) * tilesY);
+	std::iota(tiles.begin(), tiles.end(), 0u);
+
+	switch (order) {
+	case TileOrder::Scanline:
+		break;
+	case TileOrder::Shuffled: {
+		// Fisher-Yates shuffle, using our own generator so the order is the same on every platform
+		Random random(seed);
+		for (size_t i = tiles.size(); i > 1; --i) {
+			std::swap(tiles[i - 1], tiles[size_t(random.next() % i)]);
+		}
+		break;
+	}
+	case TileOrder::CentreOut: {
+		// Sort on squared distance (in tiles, doubled to keep it integral) from the centre of the image
+		auto distance = [tilesX, tilesY](unsigned int tile) {
+			long long dx = 2*static_cast<long long>(tile % tilesX) + 1 - tilesX;
+			long long dy = 2*static_cast<long long>(tile / tilesX) + 1 - tilesY;
+			return dx*dx + dy*dy;
+		};
+		std::stable_sort(tiles.begin(), tiles.end(), [&distance](unsigned int a, unsigned int b) {
+			return distance(a) < distance(b);
+		});
+		break;
+	}
+	case TileOrder::Morton:
+	case TileOrder::Hilbert: {
+		uint32_t n = 1;
+		while (n < tilesX || n < tilesY) n *= 2;
+		std::vector<uint64_t> keys(tiles.size());
+		for (unsigned int tile : tiles) {
+			const uint32_t x = tile % tilesX;
+			const uint32_t y = tile / tilesX;
+			keys[tile] = order == TileOrder::Morton ? mortonCode(uint16_t(x), uint16_t(y)) : hilbertIndex(n, x, y);
+		}
+		std::sort(tiles.begin(), tiles.end(), [&keys](unsigned int a, unsigned int b) {
+			return keys[a] < keys[b];
+		});
+		break;
+	}
+	}
+	return tiles;
+}
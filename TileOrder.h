@@ -0,0 +1,74 @@
+#pragma once
+
+#ifndef TILE_ORDER_H_INCLUDED
+#define TILE_ORDER_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+/** \file
+ * \brief Tile ordering header file.
+ */
+
+/**
+ * \brief Orders in which the tiles of an image can be rendered.
+ *
+ * The order that tiles are handed to render threads does not change the image,
+ * since every pixel is computed independently (see Scene::verifyDeterminism()).
+ */
+enum class TileOrder {
+	Scanline,  //!< Left to right, then top to bottom.
+	Shuffled,  //!< A pseudo-random permutation, determined by a seed.
+	CentreOut, //!< Nearest the centre of the image first, where detail is usually most noticed.
+	Morton,    //!< Along a Z-order curve, so that tiles close in the order are close in the image.
+	Hilbert    //!< Along a Hilbert curve, whose consecutive tiles always share an edge.
+};
+
+/**
+ * \brief The position of a point along a Z-order (Morton) curve.
+ *
+ * The bits of the two co-ordinates are interleaved, with x in the even bits, so
+ * each aligned 2x2 block of points is numbered before the next, and likewise each 
+ * aligned 4x4 block and so on.
+ *
+ * \param x The x co-ordinate.
+ * \param y The y co-ordinate.
+ * \return The Morton code of (x, y).
+ */
+inline uint32_t mortonCode(uint16_t x, uint16_t y) {
+	auto spread = [](uint32_t v) {
+		v = (v | (v << 8)) & 0x00FF00FFu;
+		v = (v | (v << 4)) & 0x0F0F0F0Fu;
+		v = (v | (v << 2)) & 0x33333333u;
+		v = (v | (v << 1)) & 0x55555555u;
+		return v;
+	};
+	return spread(x) | (spread(y) << 1);
+}
+
+/**
+ * \brief The position of a point along a Hilbert curve.
+ *
+ * \param n The width and height of the square covered by the curve, which must be a power of two.
+ * \param x The x co-ordinate, from 0 to n-1.
+ * \param y The y co-ordinate, from 0 to n-1.
+ * \return The distance of (x, y) along the curve, from 0 to n*n-1.
+ */
+uint64_t hilbertIndex(uint32_t n, uint32_t x, uint32_t y);
+
+/**
+ * \brief List the tiles of an image in a given order.
+ *
+ * Tiles are numbered row by row, so tile (x, y) has index \c y*tilesX+x. The
+ * space-filling curves are laid over the smallest power-of-two square holding
+ * every tile, and tiles outside the image are skipped.
+ *
+ * \param order The order to list the tiles in.
+ * \param tilesX The number of columns of tiles.
+ * \param tilesY The number of rows of tiles.
+ * \param seed The seed for TileOrder::Shuffled (ignored otherwise).
+ * \return The index of every tile, each exactly once, in the requested order.
+ */
+std::vector<unsigned int> orderTiles(TileOrder order, unsigned int tilesX, unsigned int tilesY, uint64_t seed = 0);
+
+#endif // TILE_ORDER_H_INCLUDED
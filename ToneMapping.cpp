@@ -0,0 +1,119 @@
+#include "ToneMapping.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+	const size_t gammaTableSize = 65536; // Steps from 0 to 1 in the gamma lookup table
+
+	const unsigned int bayer[4][4] = { // 4x4 ordered dither matrix
+		{  0,  8,  2, 10 },
+		{ 12,  4, 14,  6 },
+		{  3, 11,  1,  9 },
+		{ 15,  7, 13,  5 }
+	};
+
+	/** \brief The sRGB encoding of a linear value from 0 to 1. */
+	double encodeSRGB(double v) {
+		return v <= 0.0031308 ? 12.92 * v : 1.055 * std::pow(v, 1 / 2.4) - 0.055;
+	}
+
+}
+
+ToneMapper::ToneMapper(const ToneMapping& toneMapping) :
+	scale_(float(std::exp2(toneMapping.exposure))), reinhard_(toneMapping.curve == ToneMapping::Curve::Reinhard), 
+	dither_(toneMapping.dither), gammaTable_() {
+	if (toneMapping.gamma != 1 || toneMapping.srgb) {
+		gammaTable_.resize(gammaTableSize);
+		for (size_t ix = 0; ix < gammaTableSize; ++ix) {
+			const double v = double(ix) / (gammaTableSize - 1);
+			const double encoded = toneMapping.srgb ? encodeSRGB(v) : std::pow(v, 1 / toneMapping.gamma);
+			gammaTable_[ix] = uint16_t(256.0 * (255 * encoded));
+		}
+	}
+}
+
+ToneMapper::~ToneMapper() {
+
+}
+
+void ToneMapper::apply(const float* radiance, unsigned char* pixels, size_t count, size_t x, size_t y) const {
+	// Values are scaled to 0-255 (or to an index into the gamma table) and truncated
+	const float top = gammaTable_.empty() ? 255.0f : float(gammaTableSize - 1);
+
+	// Dither thresholds for 28 values from the start of a group of four pixels, so that those
+	// of any 16 consecutive values can be read from one offset (the pattern repeats every 12)
+	float thresholds[28];
+	uint16_t tableThresholds[28];
+	if (dither_) {
+		for (size_t k = 0; k < 28; ++k) {
+			const unsigned int b = bayer[y & 3][(x + k/3) & 3];
+			thresholds[k] = (b + 0.5f) / 16;
+			tableThresholds[k] = uint16_t(16*b + 8);
+		}
+	}
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128 scale = _mm_set1_ps(scale_);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 topV = _mm_set1_ps(top);
+	for (; i + 16 <= count; i += 16) {
+		const size_t phase = i % 12;
+		__m128i quantized[4];
+		for (int k = 0; k < 4; ++k) {
+			// max() comes first so that NaNs become 0
+			__m128 v = _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(radiance + i + 4*k), scale), zero);
+			if (reinhard_) {
+				v = _mm_div_ps(v, _mm_add_ps(one, v));
+			}
+			v = _mm_min_ps(v, one);
+			v = _mm_mul_ps(v, topV);
+			if (dither_ && gammaTable_.empty()) {
+				v = _mm_add_ps(v, _mm_loadu_ps(thresholds + phase + 4*k));
+			}
+			quantized[k] = _mm_cvttps_epi32(v);
+		}
+		if (gammaTable_.empty()) {
+			// Saturating packs clamp dithered values just above 255
+			const __m128i low = _mm_packs_epi32(quantized[0], quantized[1]);
+			const __m128i high = _mm_packs_epi32(quantized[2], quantized[3]);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), _mm_packus_epi16(low, high));
+		} else {
+			alignas(16) int32_t index[16];
+			for (int k = 0; k < 4; ++k) {
+				_mm_store_si128(reinterpret_cast<__m128i*>(index + 4*k), quantized[k]);
+			}
+			for (int k = 0; k < 16; ++k) {
+				const int32_t threshold = dither_ ? tableThresholds[phase + k] : 0;
+				pixels[i + k] = (unsigned char)std::min(255, (gammaTable_[index[k]] + threshold) >> 8);
+			}
+		}
+	}
+#endif
+
+	// The same operations, in the same order, one value at a time
+	for (; i < count; ++i) {
+		float v = radiance[i] * scale_;
+		v = v > 0.0f ? v : 0.0f;
+		if (reinhard_) {
+			v = v / (1.0f + v);
+		}
+		v = std::min(v, 1.0f);
+		v = v * top;
+		if (gammaTable_.empty()) {
+			if (dither_) v = v + thresholds[i % 12];
+			pixels[i] = (unsigned char)std::min(255, int32_t(v));
+		} else {
+			const int32_t threshold = dither_ ? tableThresholds[i % 12] : 0;
+			pixels[i] = (unsigned char)std::min(255, (gammaTable_[int32_t(v)] + threshold) >> 8);
+		}
+	}
+}
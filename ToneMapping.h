@@ -0,0 +1,106 @@
+#pragma once
+
+#ifndef TONE_MAPPING_H_INCLUDED
+#define TONE_MAPPING_H_INCLUDED
+
+#include "NonCopyable.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** \file
+ * \brief ToneMapping and ToneMapper classes header file.
+ */
+
+/**
+ * \brief Settings for turning linear Colour values into 8-bit pixel values.
+ *
+ * Each channel is scaled by the exposure, passed through a tone curve which brings
+ * it into the range [0,1], gamma (or sRGB) encoded, and quantized to 8 bits. The default
+ * settings (no exposure change, a clamping curve, a gamma of 1, and no dithering) 
+ * simply clamp and truncate each value.
+ */
+class ToneMapping {
+
+public:
+
+	/** \brief Curves for bringing linear values into the range [0,1]. */
+	enum class Curve {
+		Clamp,   //!< Values above 1 are clamped to 1.
+		Reinhard //!< x/(1+x), which compresses bright values rather than clipping them.
+	};
+
+	/** \brief ToneMapping default constructor, which leaves pixel values unchanged. */
+	ToneMapping() : exposure(0), curve(Curve::Clamp), gamma(1), srgb(false), dither(false) {
+
+	}
+
+	/** \brief Whether these settings simply clamp and truncate each value.
+	 *
+	 * \return true if the exposure is 0, the curve is Curve::Clamp, the gamma is 1, and neither srgb nor dither is set.
+	 */
+	bool isIdentity() const {
+		return exposure == 0 && curve == Curve::Clamp && gamma == 1 && !srgb && !dither;
+	}
+
+	double exposure; //!< Exposure adjustment in stops, so each channel is multiplied by 2 to the power of this.
+	Curve curve;     //!< Tone curve to apply after the exposure adjustment.
+	double gamma;    //!< Display gamma. Values are raised to the power of 1/gamma before quantization.
+	bool srgb;       //!< Encode with the sRGB transfer curve (a linear toe and a 2.4 power) instead of the gamma.
+
+	/** \brief Add a 4x4 ordered (Bayer) dither before quantization.
+	 *
+	 * Each pixel's values are offset by a threshold between 0 and 1 of an 8-bit step 
+	 * which depends on the pixel's position, so that smooth gradients become a fine
+	 * pattern rather than visible bands.
+	 */
+	bool dither;
+};
+
+/**
+ * \brief Applies a ToneMapping to a float framebuffer.
+ *
+ * The exposure and tone curve are applied four values at a time with SSE instructions
+ * (where available), and gamma or sRGB encoding is done with a lookup table built when
+ * the ToneMapper is created. The table holds 8-bit values with 8 more bits of fraction, 
+ * so that dithering can be added after it. A ToneMapper can be shared between threads, 
+ * each mapping a different part of an image.
+ */
+class ToneMapper : private NonCopyable {
+
+public:
+
+	/** \brief ToneMapper constructor.
+	 *
+	 * \param toneMapping The settings to apply.
+	 */
+	explicit ToneMapper(const ToneMapping& toneMapping);
+
+	/** \brief ToneMapper destructor. */
+	~ToneMapper();
+
+	/** \brief Tone map a run of values.
+	 *
+	 * The channels of each pixel are treated alike, so any run of interleaved
+	 * red, green, and blue values can be mapped. When dithering, the run must start
+	 * at the red value of a pixel and must not cross from one row of the image to
+	 * the next, so that each value's threshold can be found from its position.
+	 *
+	 * \param radiance The linear values to map.
+	 * \param pixels The 8-bit pixel values to write.
+	 * \param count The number of values to map.
+	 * \param x The column of the pixel that the run starts at.
+	 * \param y The row of the image that the run is in.
+	 */
+	void apply(const float* radiance, unsigned char* pixels, size_t count, size_t x = 0, size_t y = 0) const;
+
+private:
+
+	float scale_;    //!< Multiplier for the exposure adjustment.
+	bool reinhard_;  //!< Whether to apply the Reinhard curve.
+	bool dither_;    //!< Whether to add an ordered dither.
+	std::vector<uint16_t> gammaTable_; //!< 256 times the pixel value for each of gammaTable_.size() steps from 0 to 1, or empty for a linear encoding.
+};
+
+#endif // TONE_MAPPING_H_INCLUDED
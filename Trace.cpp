@@ -0,0 +1,153 @@
+#include "Trace.h"
+
+#ifdef RAYTRACER_TRACE
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+	const size_t eventsReserved = 4096; // Events each thread has room for before its buffer grows
+
+	/** \brief The events recorded by one thread. */
+	struct ThreadBuffer {
+		int tid;                          //!< The thread's number in the trace.
+		std::string name;                 //!< The thread's name, or empty for none.
+		std::vector<Trace::Event> events; //!< Events in the order they finished.
+	};
+
+	/** \brief Every thread's buffer, which outlive the threads so they can be saved at exit. */
+	struct Registry {
+		std::mutex mutex;                                   //!< Guards adding buffers, once per thread.
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers; //!< One buffer per thread that has recorded anything.
+		std::string filename;                               //!< Where to save the trace at exit.
+		std::chrono::steady_clock::time_point origin;       //!< Time zero of the trace.
+	};
+
+	Registry& registry() {
+		static Registry registry;
+		return registry;
+	}
+
+	thread_local ThreadBuffer* threadBuffer = nullptr;
+
+	/** \brief The calling thread's buffer, added to the Registry the first time it is needed. */
+	ThreadBuffer& ownBuffer() {
+		if (!threadBuffer) {
+			Registry& all = registry();
+			std::lock_guard<std::mutex> lock(all.mutex);
+			all.buffers.emplace_back(new ThreadBuffer{int(all.buffers.size()) + 1, std::string(), std::vector<Trace::Event>()});
+			threadBuffer = all.buffers.back().get();
+			threadBuffer->events.reserve(eventsReserved);
+		}
+		return *threadBuffer;
+	}
+
+	void saveAtExit() {
+		Trace::save(registry().filename);
+	}
+
+	/** \brief Write a string as JSON, escaping the characters that need it. */
+	void writeString(std::ostream& out, const std::string& text) {
+		out << '"';
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				out << '\\' << c;
+			} else if ((unsigned char)c < 0x20) {
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int)c);
+				out << escaped;
+			} else {
+				out << c;
+			}
+		}
+		out << '"';
+	}
+
+}
+
+std::atomic<bool> Trace::enabled_(false);
+
+void Trace::start(const std::string& filename) {
+	Registry& all = registry();
+	if (enabled()) {
+		all.filename = filename;
+		return;
+	}
+	all.filename = filename;
+	all.origin = std::chrono::steady_clock::now();
+	enabled_.store(true);
+	nameThread("main");
+	std::atexit(saveAtExit);
+}
+
+int64_t Trace::now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - registry().origin).count();
+}
+
+void Trace::record(const Event& event) {
+	ownBuffer().events.push_back(event);
+}
+
+void Trace::nameThread(const std::string& name) {
+	ownBuffer().name = name;
+}
+
+bool Trace::save(const std::string& filename) {
+	std::ofstream out(filename);
+	if (!out) {
+		std::cerr << "Could not save trace to " << filename << std::endl;
+		return false;
+	}
+
+	Registry& all = registry();
+	std::lock_guard<std::mutex> lock(all.mutex);
+	size_t numEvents = 0;
+	char times[64];
+	out << "{\"traceEvents\":[\n";
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"rayTracer\"}}";
+	for (const auto& buffer : all.buffers) {
+		if (!buffer->name.empty()) {
+			out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{\"name\":";
+			writeString(out, buffer->name);
+			out << "}}";
+		}
+		for (const Event& event : buffer->events) {
+			// Times are in microseconds, kept to the nanosecond
+			std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", event.startNs / 1000.0, event.durationNs / 1000.0);
+			out << ",\n{\"name\":";
+			writeString(out, event.name);
+			out << ",\"cat\":";
+			writeString(out, event.category);
+			out << ",\"ph\":\"X\"," << times << ",\"pid\":1,\"tid\":" << buffer->tid;
+			if (event.argNames[0]) {
+				out << ",\"args\":{";
+				writeString(out, event.argNames[0]);
+				out << ":" << event.args[0];
+				if (event.argNames[1]) {
+					out << ",";
+					writeString(out, event.argNames[1]);
+					out << ":" << event.args[1];
+				}
+				out << "}";
+			}
+			out << "}";
+			++numEvents;
+		}
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	if (!out) {
+		std::cerr << "Could not save trace to " << filename << std::endl;
+		return false;
+	}
+	std::cout << "Saved " << numEvents << " trace events from " << all.buffers.size() << " thread"
+	          << (all.buffers.size() == 1 ? "" : "s") << " to " << filename << std::endl;
+	return true;
+}
+
+#endif // RAYTRACER_TRACE
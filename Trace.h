@@ -0,0 +1,153 @@
+#pragma once
+
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+/** \file
+ * \brief Scoped timing events, saved in Chrome's trace-event format.
+ *
+ * Tracing is built only when \c RAYTRACER_TRACE is defined, which CMake does
+ * with <tt>-DRAYTRACER_TRACE=ON</tt>. Otherwise TRACE_SCOPE(), TRACE_SCOPE_XY()
+ * and TRACE_THREAD_NAME() expand to nothing, and none of the code below is compiled.
+ *
+ * When it is built, nothing is recorded until Trace::start() is called. Each thread
+ * then appends its events to its own buffer, which only that thread writes to, so
+ * recording takes no locks. The buffers are saved when the program exits, as
+ *
+ *     {"traceEvents":[
+ *     {"name":"tile","cat":"render","ph":"X","ts":10512.250,"dur":812.125,"pid":1,"tid":2,"args":{"x":3,"y":0}},
+ *     ...]}
+ *
+ * which can be loaded into \c chrome://tracing or https://ui.perfetto.dev to see
+ * which thread did what, and when.
+ */
+
+#ifdef RAYTRACER_TRACE
+
+#include "NonCopyable.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * \brief Records timed events on each thread, and saves them as a Chrome trace.
+ */
+class Trace {
+
+public:
+
+	/** \brief One completed span of time on one thread. */
+	struct Event {
+		const char* name;        //!< What was done. This must be a string literal.
+		const char* category;    //!< The part of the program that did it. This must be a string literal.
+		int64_t startNs;         //!< When it started, in nanoseconds since Trace::start().
+		int64_t durationNs;      //!< How long it took, in nanoseconds.
+		const char* argNames[2]; //!< Names of up to two integer arguments, or \c nullptr for none.
+		long long args[2];       //!< Values of the arguments.
+	};
+
+	/** \brief Start recording, and save the trace to a file when the program exits.
+	 *
+	 * \param filename The JSON file to save, which is replaced.
+	 */
+	static void start(const std::string& filename);
+
+	/** \brief Whether events are being recorded.
+	 *
+	 * \return true between Trace::start() and the end of the program.
+	 */
+	static bool enabled() {
+		return enabled_.load(std::memory_order_relaxed);
+	}
+
+	/** \brief The time now.
+	 *
+	 * \return Nanoseconds since Trace::start().
+	 */
+	static int64_t now();
+
+	/** \brief Add an event to the calling thread's buffer.
+	 *
+	 * \param event The event to add.
+	 */
+	static void record(const Event& event);
+
+	/** \brief Name the calling thread in the trace.
+	 *
+	 * \param name The name to show for the thread's row of events.
+	 */
+	static void nameThread(const std::string& name);
+
+	/** \brief Save the events recorded so far.
+	 *
+	 * No other thread may be recording while the trace is saved.
+	 *
+	 * \param filename The JSON file to save, which is replaced.
+	 * \return true if the file was saved.
+	 */
+	static bool save(const std::string& filename);
+
+	/**
+	 * \brief Records an Event covering its own lifetime.
+	 */
+	class Scope : private NonCopyable {
+
+	public:
+
+		/** \brief Scope constructor, which starts timing if tracing is enabled.
+		 *
+		 * \param category The part of the program. This must be a string literal.
+		 * \param name What is being done. This must be a string literal.
+		 * \param argName0 The name of the first argument, or \c nullptr for none.
+		 * \param arg0 The value of the first argument.
+		 * \param argName1 The name of the second argument, or \c nullptr for none.
+		 * \param arg1 The value of the second argument.
+		 */
+		Scope(const char* category, const char* name, const char* argName0 = nullptr, long long arg0 = 0,
+		      const char* argName1 = nullptr, long long arg1 = 0) :
+			event_{name, category, enabled() ? now() : -1, 0, {argName0, argName1}, {arg0, arg1}} {
+		}
+
+		/** \brief Scope destructor, which records the Event. */
+		~Scope() {
+			if (event_.startNs < 0) return;
+			event_.durationNs = now() - event_.startNs;
+			record(event_);
+		}
+
+	private:
+
+		Event event_; //!< The Event to record, with a negative start time if tracing was off.
+	};
+
+private:
+
+	static std::atomic<bool> enabled_; //!< Whether Trace::start() has been called.
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+/** \brief Time the rest of the enclosing block as an event. */
+#define TRACE_SCOPE(category, name) \
+	Trace::Scope TRACE_CONCAT(traceScope_, __LINE__)(category, name)
+
+/** \brief Time the rest of the enclosing block as an event with two integer arguments, such as tile coordinates. */
+#define TRACE_SCOPE_XY(category, name, xName, x, yName, y) \
+	Trace::Scope TRACE_CONCAT(traceScope_, __LINE__)(category, name, xName, (long long)(x), yName, (long long)(y))
+
+/** \brief Name the calling thread's row in the trace. */
+#define TRACE_THREAD_NAME(name) \
+	do { if (Trace::enabled()) Trace::nameThread(name); } while (0)
+
+#else
+
+#define TRACE_SCOPE(category, name) do {} while (0)
+#define TRACE_SCOPE_XY(category, name, xName, x, yName, y) do {} while (0)
+#define TRACE_THREAD_NAME(name) do {} while (0)
+
+#endif // RAYTRACER_TRACE
+
+#endif // TRACE_H_INCLUDED
@@ -3,12 +3,12 @@
 
 Transform::Transform() :
 T_(Matrix::identity(4,4)), Tinv_(Matrix::identity(4,4)) {
-
+	flatten();
 }
 
 Transform::Transform(const Transform& transform) :
 T_(transform.T_), Tinv_(transform.Tinv_) {
-
+	flatten();
 }
 
 Transform::~Transform() {
@@ -19,50 +19,36 @@ Transform& Transform::operator=(const Transform& transform) {
 	if (this != &transform) {
 		T_ = transform.T_;
 		Tinv_ = transform.Tinv_;
+		flatten();
 	}
 	return *this;
 }
 
 
+// The sums below are taken in the same order as the Matrix product, so the results are identical
+
 Point Transform::apply(const Point& point) const {
-	Vector v(4);
-	v(0) = point(0);
-	v(1) = point(1);
-	v(2) = point(2);
-	v(3) = 1;
-	v = T_*v;
 	Point result;
-	result(0) = v(0)/v(3);
-	result(1) = v(1)/v(3);
-	result(2) = v(2)/v(3);
+	for (size_t r = 0; r < 3; ++r) {
+		result(r) = forward_[r][0]*point(0) + forward_[r][1]*point(1) + forward_[r][2]*point(2) + forward_[r][3];
+	}
 	return result;
 }
 
 Direction Transform::apply(const Direction& direction) const {
-	Vector v(4);
-	v(0) = direction(0);
-	v(1) = direction(1);
-	v(2) = direction(2);
-	v(3) = 0;
-	v = T_*v;
 	Direction result;
-	result(0) = v(0);
-	result(1) = v(1);
-	result(2) = v(2);
+	for (size_t r = 0; r < 3; ++r) {
+		result(r) = forward_[r][0]*direction(0) + forward_[r][1]*direction(1) + forward_[r][2]*direction(2);
+	}
 	return result;
 }
 
 Normal Transform::apply(const Normal& normal) const {
-	Vector v(4);
-	v(0) = normal(0);
-	v(1) = normal(1);
-	v(2) = normal(2);
-	v(3) = 0;
-	v = Tinv_.transpose()*v;
+	// Normals are transformed by the transpose of the inverse
 	Normal result;
-	result(0) = v(0);
-	result(1) = v(1);
-	result(2) = v(2);
+	for (size_t c = 0; c < 3; ++c) {
+		result(c) = inverse_[0][c]*normal(0) + inverse_[1][c]*normal(1) + inverse_[2][c]*normal(2);
+	}
 	return result;
 }
 
@@ -74,44 +60,26 @@ Ray Transform::apply(const Ray& ray) const {
 }
 
 Point Transform::applyInverse(const Point& point) const {
-	Vector v(4);
-	v(0) = point(0);
-	v(1) = point(1);
-	v(2) = point(2);
-	v(3) = 1;
-	v = Tinv_*v;
 	Point result;
-	result(0) = v(0)/v(3);
-	result(1) = v(1)/v(3);
-	result(2) = v(2)/v(3);
+	for (size_t r = 0; r < 3; ++r) {
+		result(r) = inverse_[r][0]*point(0) + inverse_[r][1]*point(1) + inverse_[r][2]*point(2) + inverse_[r][3];
+	}
 	return result;
 }
 
 Direction Transform::applyInverse(const Direction& direction) const {
-	Vector v(4);
-	v(0) = direction(0);
-	v(1) = direction(1);
-	v(2) = direction(2);
-	v(3) = 0;
-	v = Tinv_*v;
 	Direction result;
-	result(0) = v(0);
-	result(1) = v(1);
-	result(2) = v(2);
+	for (size_t r = 0; r < 3; ++r) {
+		result(r) = inverse_[r][0]*direction(0) + inverse_[r][1]*direction(1) + inverse_[r][2]*direction(2);
+	}
 	return result;
 }
 
 Normal Transform::applyInverse(const Normal& normal) const {
-	Vector v(4);
-	v(0) = normal(0);
-	v(1) = normal(1);
-	v(2) = normal(2);
-	v(3) = 0;
-	v = T_.transpose()*v;
 	Normal result;
-	result(0) = v(0);
-	result(1) = v(1);
-	result(2) = v(2);
+	for (size_t c = 0; c < 3; ++c) {
+		result(c) = forward_[0][c]*normal(0) + forward_[1][c]*normal(1) + forward_[2][c]*normal(2);
+	}
 	return result;
 }
 
@@ -132,6 +100,7 @@ void Transform::rotateX(double rx) {
 
 	T_ = R*T_;
 	Tinv_ = Tinv_*R.transpose();
+	flatten();
 }
 
 void Transform::rotateY(double ry) {
@@ -144,6 +113,7 @@ void Transform::rotateY(double ry) {
 
 	T_ = R*T_;
 	Tinv_ = Tinv_*R.transpose();
+	flatten();
 }
 
 void Transform::rotateZ(double rz) {
@@ -156,6 +126,7 @@ void Transform::rotateZ(double rz) {
 
 	T_ = R*T_;
 	Tinv_ = Tinv_*R.transpose();
+	flatten();
 }
 
 void Transform::scale(double s) {
@@ -168,6 +139,7 @@ void Transform::scale(double s) {
 	S(0,0) = S(1,1) = S(2,2) = 1/s;
 
 	Tinv_ = Tinv_*S;
+	flatten();
 }
 
 void Transform::scale(double sx, double sy, double sz) {
@@ -184,6 +156,7 @@ void Transform::scale(double sx, double sy, double sz) {
 	S(2,2) = 1/sz;
 
 	Tinv_ = Tinv_*S;
+	flatten();
 }
 
 void Transform::translate(double tx, double ty, double tz) {
@@ -200,8 +173,22 @@ void Transform::translate(double tx, double ty, double tz) {
 	T(2,3) = -tz;
 
 	Tinv_ = Tinv_*T;
+	flatten();
 }
 
 void Transform::translate(const Direction& direction) {
 	translate(direction(0), direction(1), direction(2));
-}
\ No newline at end of file
+}
+
+size_t Transform::memoryBytes() const {
+	return sizeof(Transform) + (T_.numElements() + Tinv_.numElements()) * sizeof(double);
+}
+
+void Transform::flatten() {
+	for (size_t r = 0; r < 3; ++r) {
+		for (size_t c = 0; c < 4; ++c) {
+			forward_[r][c] = T_(r,c);
+			inverse_[r][c] = Tinv_(r,c);
+		}
+	}
+}
@@ -201,11 +201,29 @@ public:
 	 */
 	void translate(const Direction& direction);
 
+	/** \brief Estimate the memory used by the Transform.
+	 *
+	 * \return The size of the Transform and of the elements of its Matrices, in bytes.
+	 */
+	size_t memoryBytes() const;
+
 private:
 
+	/** \brief Copy the top three rows of T_ and Tinv_ into forward_ and inverse_.
+	 *
+	 * This must be called whenever T_ or Tinv_ changes.
+	 */
+	void flatten();
+
 	Matrix T_;    //!< The 4x4 homogeneous transformation matrix.
 	Matrix Tinv_; //!< The 4x4 inverse transformation matrix.
 
+	// Every transformation is affine, so the bottom row of both matrices is (0, 0, 0, 1)
+	// and only the top three rows are needed to apply them. Keeping those as flat arrays 
+	// means apply() and applyInverse() need no Matrix or Vector temporaries.
+	double forward_[3][4]; //!< The top three rows of T_.
+	double inverse_[3][4]; //!< The top three rows of Tinv_.
+
 };
 
 #endif
\ No newline at end of file
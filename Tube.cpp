@@ -22,6 +22,10 @@ Tube& Tube::operator=(const Tube& tube) {
 	return *this;
 }
 
+size_t Tube::memoryBytes() const {
+	return Object::memoryBytes() + sizeof(Tube) - sizeof(Object);
+}
+
 std::vector<RayIntersection> Tube::intersect(const Ray& ray) const {
 
 	std::vector<RayIntersection> result;
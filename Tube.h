@@ -67,6 +67,12 @@ public:
 	 */
 	std::vector<RayIntersection> intersect(const Ray& ray) const;
 
+	/** \brief Estimate the memory used by the Tube.
+	 *
+	 * \return The number of bytes used, including the Tube's ratio.
+	 */
+	size_t memoryBytes() const;
+
 private:
 
 	double ratio_;
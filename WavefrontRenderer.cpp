@@ -0,0 +1,238 @@
+#include "WavefrontRenderer.h"
+
+#include "utility.h"
+
+#include <algorithm>
+
+WavefrontRenderer::WavefrontRenderer(const Scene& scene, const ScreenFootprints& footprints, size_t batchSize) :
+	scene_(scene), footprints_(footprints), firstRow_(0), batchSize_(batchSize), samplesPerPixel_(std::max(1u, scene.samplesPerPixel)), numPaths_(0), numBounces_(scene.maxRayDepth + 1),
+	rays_(), shadowRays_(), hits_(), hitRays_(), shadowHits_(), shadowLights_(), lit_(),
+	state_(), localColour_(), mirrorColour_(), mirrorWeight_(), throughput_(), random_(), pixels_() {
+
+}
+
+WavefrontRenderer::~WavefrontRenderer() {
+
+}
+
+unsigned int WavefrontRenderer::rowsPerBatch() const {
+	// Each wavefront covers whole rows, so that progress can be reported by row
+	const size_t pathsPerRow = size_t(scene_.renderWidth) * samplesPerPixel_;
+	if (pathsPerRow == 0) return 1;
+	return std::max(1u, (unsigned int)(batchSize_ / pathsPerRow));
+}
+
+void WavefrontRenderer::renderRows(ImageDisplay& display, unsigned int firstRow, unsigned int endRow, RenderStats& stats) {
+	if (scene_.renderWidth == 0 || firstRow >= endRow) return;
+
+	firstRow_ = firstRow;
+	numPaths_ = size_t(endRow - firstRow) * scene_.renderWidth * samplesPerPixel_;
+	state_.assign(numBounces_ * numPaths_, NotTraced);
+	localColour_.resize(numBounces_ * numPaths_);
+	mirrorColour_.resize(numBounces_ * numPaths_);
+	mirrorWeight_.resize(numBounces_ * numPaths_);
+	throughput_.assign(numPaths_, Colour(1, 1, 1));
+	random_.resize(numPaths_);
+
+	generatePrimaryRays(firstRow, endRow);
+	stats.primaryRays += rays_.size();
+	for (unsigned int bounce = 0; bounce < numBounces_ && rays_.size() > 0; ++bounce) {
+		extend(bounce, display);
+		traceShadowRays();
+		stats.shadowRays += shadowRays_.size();
+		shade(bounce);
+		emitReflectedRays(bounce, stats);
+	}
+
+	resolve(display, firstRow, endRow);
+}
+
+void WavefrontRenderer::generatePrimaryRays(unsigned int firstRow, unsigned int endRow) {
+	rays_.clear();
+	rays_.reserve(numPaths_);
+	unsigned int path = 0;
+	for (unsigned int v = firstRow; v < endRow; ++v) {
+		for (unsigned int u = 0; u < scene_.renderWidth; ++u) {
+			const bool empty = footprints_.candidatesAt(u, v).empty();
+			for (unsigned int sample = 0; sample < samplesPerPixel_; ++sample) {
+				// Jitter is drawn first, as in Scene::renderPixel(), so both give the same samples
+				Ray ray;
+				if (samplesPerPixel_ == 1) {
+					random_[path] = Random::forPixel(u, v);
+					if (!empty) ray = scene_.castPrimaryRay(footprints_.camera(), u, v);
+				} else {
+					random_[path] = Random::forPixel(u, v, sample);
+					double offsetU = random_[path].uniform();
+					double offsetV = random_[path].uniform();
+					if (!empty) ray = scene_.castPrimaryRay(footprints_.camera(), u, v, offsetU, offsetV);
+				}
+				if (empty) {
+					// Nothing can be seen in this tile, so there is no need to trace a Ray
+					state_[path++] = Missed;
+				} else {
+					rays_.push(ray, path++);
+				}
+			}
+		}
+	}
+}
+
+void WavefrontRenderer::extend(unsigned int bounce, ImageDisplay& display) {
+	hits_.clear();
+	hitRays_.clear();
+	const unsigned int width = scene_.renderWidth;
+	const bool recordFeatures = display.hasFeatures();
+	PixelFeatures features = { { 0, 0, 0 }, 0, -1 };
+	for (size_t i = 0; i < rays_.size(); ++i) {
+		RayIntersection hit;
+		if (bounce == 0) {
+			// Primary Rays only need to be tested against the Objects in their tile
+			const unsigned int path = rays_.path[i];
+			const size_t pixel = path / samplesPerPixel_;
+			hit = scene_.intersectQueued(rays_, i, &footprints_.candidatesAt(pixel % width, firstRow_ + pixel / width));
+			if (recordFeatures) {
+				// All of the samples of a pixel are queued together, in order
+				const unsigned int sample = path % samplesPerPixel_;
+				Scene::addSampleFeatures(features, hit, sample, size_t(firstRow_)*width + pixel);
+				if (sample + 1 == samplesPerPixel_) {
+					display.setFeatures(int(pixel % width), int(firstRow_ + pixel / width), features);
+				}
+			}
+		} else {
+			hit = scene_.intersectQueued(rays_, i, nullptr);
+		}
+		if (hit.distance == infinity) {
+			state_[bounce*numPaths_ + rays_.path[i]] = Missed;
+		} else {
+			state_[bounce*numPaths_ + rays_.path[i]] = Hit;
+			hits_.push_back(hit);
+			hitRays_.push_back(i);
+		}
+	}
+}
+
+void WavefrontRenderer::traceShadowRays() {
+	const auto& lights = scene_.lights_;
+
+	// Emit one shadow Ray for each hit with direct lighting terms and each LightSource that can cast shadows
+	const CompiledScene& compiled = scene_.compiled();
+	shadowRays_.clear();
+	shadowHits_.clear();
+	shadowLights_.clear();
+	lit_.assign(hits_.size() * lights.size(), 0);
+	for (size_t h = 0; h < hits_.size(); ++h) {
+		if (!(compiled.materialClasses().features(hits_[h].object) & (DiffuseFeature | SpecularFeature))) continue;
+		for (unsigned int l : compiled.directLights()) {
+			shadowRays_.push(scene_.computeShadowRay(*lights[l], hits_[h]), rays_.path[hitRays_[h]]);
+			shadowHits_.push_back((unsigned int)h);
+			shadowLights_.push_back(l);
+		}
+	}
+
+	// Trace them, and record which lights reach each hit
+	for (size_t i = 0; i < shadowRays_.size(); ++i) {
+		const LightSource& light = *lights[shadowLights_[i]];
+		double distToLight = light.getDistanceToLight(Point(shadowRays_.originX[i], shadowRays_.originY[i], shadowRays_.originZ[i]));
+		const std::vector<unsigned int>& casters = compiled.shadowCasters().candidates(shadowLights_[i], hits_[shadowHits_[i]].object);
+		if (distToLight < scene_.intersectQueued(shadowRays_, i, &casters).distance) {
+			lit_[shadowHits_[i] * lights.size() + shadowLights_[i]] = 1;
+		}
+	}
+}
+
+void WavefrontRenderer::shade(unsigned int bounce) {
+	const auto& lights = scene_.lights_;
+	const CompiledScene& compiled = scene_.compiled();
+	for (size_t h = 0; h < hits_.size(); ++h) {
+		const RayIntersection& hitPoint = hits_[h];
+		const Ray ray = rays_.ray(hitRays_[h]);
+		const unsigned int features = compiled.materialClasses().features(hitPoint.object);
+
+		// Lights are visited in the same order as Scene::computeColour, so the sums agree exactly
+		PackedColour hitColour(0, 0, 0);
+		if (features & AmbientFeature) {
+			for (unsigned int l : compiled.ambientLights()) {
+				hitColour += lights[l]->getIlluminationAt(hitPoint.point) * PackedColour(hitPoint.material.ambientColour);
+			}
+		}
+		for (unsigned int l : compiled.directLights()) {
+			if (lit_[h * lights.size() + l]) {
+				scene_.addDirectLighting(*lights[l], hitPoint, ray, hitColour);
+			}
+		}
+
+		const size_t ix = bounce*numPaths_ + rays_.path[hitRays_[h]];
+		localColour_[ix] = hitColour;
+		mirrorColour_[ix] = PackedColour(hitPoint.material.mirrorColour);
+	}
+}
+
+void WavefrontRenderer::emitReflectedRays(unsigned int bounce, RenderStats& stats) {
+	RayQueue reflectedRays;
+	const MaterialClasses& classes = scene_.compiled().materialClasses();
+	if (bounce + 1 < numBounces_) {
+		const unsigned int rayDepth = (unsigned int)(numBounces_ - 1 - bounce);
+		for (size_t h = 0; h < hits_.size(); ++h) {
+			if (classes.features(hits_[h].object) & MirrorFeature) {
+				const unsigned int path = rays_.path[hitRays_[h]];
+				const size_t ix = bounce*numPaths_ + path;
+				if (scene_.continuePath(hits_[h].material, rayDepth, throughput_[path], throughput_[path], 
+				                        mirrorWeight_[ix], random_[path], stats)) {
+					reflectedRays.push(scene_.computeReflectedRay(rays_.ray(hitRays_[h]), hits_[h]), path);
+					state_[ix] = Reflected;
+				} else {
+					state_[ix] = Terminated;
+				}
+			}
+		}
+	}
+	std::swap(rays_, reflectedRays);
+}
+
+void WavefrontRenderer::resolve(ImageDisplay& display, unsigned int firstRow, unsigned int endRow) {
+	const unsigned int width = scene_.renderWidth;
+	const size_t numPixels = size_t(endRow - firstRow) * width;
+	pixels_.resize(numPixels);
+	for (size_t pixel = 0; pixel < numPixels; ++pixel) {
+		if (samplesPerPixel_ == 1) {
+			pixels_[pixel] = resolvePath(pixel).toColour();
+			continue;
+		}
+		// Samples are summed in the same order as in Scene::renderPixel()
+		Colour sum(0, 0, 0);
+		for (unsigned int sample = 0; sample < samplesPerPixel_; ++sample) {
+			sum += resolvePath(pixel*samplesPerPixel_ + sample).toColour();
+		}
+		pixels_[pixel] = sum / samplesPerPixel_;
+	}
+	display.setTile(0, int(firstRow), width, endRow - firstRow, pixels_.data());
+}
+
+PackedColour WavefrontRenderer::resolvePath(size_t path) const {
+	// Work back up the path, mixing each bounce with the one reflected into it
+	const PackedColour background(scene_.backgroundColour);
+	PackedColour colour = background;
+	for (size_t bounce = numBounces_; bounce-- > 0; ) {
+		const size_t ix = bounce*numPaths_ + path;
+		switch (state_[ix]) {
+		case NotTraced:
+			break;
+		case Missed:
+			colour = background;
+			break;
+		case Hit:
+			colour = localColour_[ix];
+			if (scene_.clipsEachBounce()) colour.clip();
+			break;
+		case Reflected:
+			colour = (PackedColour(1, 1, 1) - mirrorColour_[ix]) * localColour_[ix] + (mirrorColour_[ix] * float(mirrorWeight_[ix])) * colour;
+			if (scene_.clipsEachBounce()) colour.clip();
+			break;
+		case Terminated:
+			colour = (PackedColour(1, 1, 1) - mirrorColour_[ix]) * localColour_[ix] + PackedColour(0, 0, 0);
+			if (scene_.clipsEachBounce()) colour.clip();
+			break;
+		}
+	}
+	return scene_.finishPath(colour);
+}
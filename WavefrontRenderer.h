@@ -0,0 +1,168 @@
+#pragma once
+
+#ifndef WAVEFRONT_RENDERER_H_INCLUDED
+#define WAVEFRONT_RENDERER_H_INCLUDED
+
+#include "Colour.h"
+#include "ImageDisplay.h"
+#include "NonCopyable.h"
+#include "PackedColour.h"
+#include "RayIntersection.h"
+#include "RayQueue.h"
+#include "Scene.h"
+#include "ScreenFootprints.h"
+
+#include <vector>
+
+/** \file
+ * \brief WavefrontRenderer class header file.
+ */
+
+/**
+ * \brief Breadth-first renderer for a Scene.
+ *
+ * Scene::computeColour() follows each pixel depth-first: the camera Ray, then its
+ * shadow Rays, then its reflections, and so on recursively. The WavefrontRenderer
+ * produces the same image, but processes a large batch of pixels (paths) one stage
+ * at a time:
+ * - <b>generate</b>: create the primary Ray for every pixel in the batch;
+ * - <b>extend</b>: intersect every queued Ray with the Scene;
+ * - <b>shadow</b>: emit and trace a shadow Ray for every hit and direct LightSource;
+ * - <b>shade</b>: combine ambient and visible direct lighting at every hit;
+ * - <b>reflect</b>: emit a reflected Ray for every mirror hit, forming the next queue.
+ *
+ * With several samples per pixel, each sample is a separate path, and the paths
+ * for a pixel are averaged once they are resolved.
+ *
+ * As in Scene::render(), primary Rays are only tested against the Objects whose
+ * ScreenFootprints overlap their pixel, and no Rays are traced in empty tiles.
+ *
+ * The extend, shadow, and shade stages repeat for each bounce, up to the Scene's
+ * maxRayDepth. Each stage is a single loop over a RayQueue, so the same code and
+ * data stay hot for thousands of Rays in a row.
+ *
+ * Because Scene::computeColour() clips the Colour at every bounce, the results of 
+ * each bounce are stored per path and folded back together (deepest first) once 
+ * all of the queues are empty.
+ */
+class WavefrontRenderer : private NonCopyable {
+
+public:
+
+	/** \brief WavefrontRenderer constructor.
+	 *
+	 * \param scene The Scene to render.
+	 * \param footprints The Objects which primary Rays can hit in each tile of the image.
+	 * \param batchSize The (approximate) number of pixels to trace in each wavefront.
+	 */
+	WavefrontRenderer(const Scene& scene, const ScreenFootprints& footprints, size_t batchSize = 65536);
+
+	/** \brief WavefrontRenderer destructor. */
+	~WavefrontRenderer();
+
+	/** \brief The number of rows of the image traced in each wavefront.
+	 *
+	 * \return The number of rows to pass to each call of renderRows().
+	 */
+	unsigned int rowsPerBatch() const;
+
+	/** \brief Render a band of rows of the Scene into an ImageDisplay.
+	 *
+	 * Different WavefrontRenderers may render different bands of the same image at
+	 * the same time, but each WavefrontRenderer must only be used by one thread at a time.
+	 *
+	 * \param display The ImageDisplay to write pixels to. It must be the Scene's render size.
+	 * \param firstRow The first row of the band.
+	 * \param endRow One past the last row of the band.
+	 * \param stats Counters to update.
+	 */
+	void renderRows(ImageDisplay& display, unsigned int firstRow, unsigned int endRow, RenderStats& stats);
+
+private:
+
+	/** \brief What happened to a path at a particular bounce. */
+	enum PathState : unsigned char {
+		NotTraced, //!< No Ray was traced for this bounce.
+		Missed,    //!< The Ray left the Scene, and sees the backgroundColour.
+		Hit,       //!< The Ray hit an Object, and was not reflected.
+		Reflected, //!< The Ray hit a mirror Object and a reflected Ray was traced.
+		Terminated //!< The Ray hit a mirror Object, but the reflection was too faint to trace.
+	};
+
+	/** \brief Fill the Ray queue with primary Rays for a band of rows.
+	 *
+	 * \param firstRow The first row of the band.
+	 * \param endRow One past the last row of the band.
+	 */
+	void generatePrimaryRays(unsigned int firstRow, unsigned int endRow);
+
+	/** \brief Intersect each queued Ray with the Scene, recording hits and misses.
+	 *
+	 * If the ImageDisplay keeps PixelFeatures, those of the first sample of each pixel
+	 * are written to it when the primary Rays are intersected.
+	 *
+	 * \param bounce The bounce (0 for primary Rays) that the queued Rays belong to.
+	 * \param display The ImageDisplay being rendered to.
+	 */
+	void extend(unsigned int bounce, ImageDisplay& display);
+
+	/** \brief Emit and trace a shadow Ray for each hit and direct LightSource. */
+	void traceShadowRays();
+
+	/** \brief Compute the local (unreflected) Colour at each hit.
+	 *
+	 * \param bounce The bounce that the hits belong to.
+	 */
+	void shade(unsigned int bounce);
+
+	/** \brief Replace the Ray queue with the reflections of the mirror hits.
+	 *
+	 * Reflections are subject to the same early termination as in Scene::computeColour().
+	 *
+	 * \param bounce The bounce that the hits belong to.
+	 * \param stats Counters to update.
+	 */
+	void emitReflectedRays(unsigned int bounce, RenderStats& stats);
+
+	/** \brief Fold each path's bounces into a final Colour and write the pixels.
+	 *
+	 * \param display The ImageDisplay to write pixels to.
+	 * \param firstRow The first row of the band.
+	 * \param endRow One past the last row of the band.
+	 */
+	void resolve(ImageDisplay& display, unsigned int firstRow, unsigned int endRow);
+
+	/** \brief Fold one path's bounces into its final Colour.
+	 *
+	 * \param path The path to resolve.
+	 * \return The Colour seen along the path.
+	 */
+	PackedColour resolvePath(size_t path) const;
+
+	const Scene& scene_;  //!< The Scene being rendered.
+	const ScreenFootprints& footprints_; //!< The Objects which primary Rays can hit in each tile.
+	unsigned int firstRow_; //!< The first row of the current wavefront.
+	size_t batchSize_;    //!< Approximate number of paths in each wavefront.
+	unsigned int samplesPerPixel_; //!< Number of paths traced for each pixel.
+	size_t numPaths_;     //!< Number of paths in the current wavefront.
+	size_t numBounces_;   //!< Number of bounces per path (maxRayDepth + 1).
+
+	RayQueue rays_;        //!< Rays to be extended for the current bounce.
+	RayQueue shadowRays_;  //!< Shadow Rays for the current bounce.
+
+	std::vector<RayIntersection> hits_;   //!< Intersections found by the extend stage.
+	std::vector<size_t> hitRays_;         //!< Position in rays_ of the Ray for each hit.
+	std::vector<unsigned int> shadowHits_; //!< The hit that each shadow Ray was cast from.
+	std::vector<size_t> shadowLights_;    //!< The LightSource that each shadow Ray was cast towards.
+	std::vector<unsigned char> lit_;      //!< Per hit and LightSource, whether the light reaches the hit.
+
+	std::vector<unsigned char> state_;    //!< PathState per bounce and path (bounce-major).
+	std::vector<PackedColour> localColour_;  //!< Unreflected Colour per bounce and path.
+	std::vector<PackedColour> mirrorColour_; //!< Mirror Colour per bounce and path.
+	std::vector<double> mirrorWeight_;    //!< Weight of the reflected Colour per bounce and path.
+	std::vector<Colour> throughput_;      //!< Current throughput of each path.
+	std::vector<Random> random_;          //!< Random number generator for each path.
+	std::vector<Colour> pixels_;          //!< Resolved Colour of each pixel in the wavefront.
+};
+
+#endif // WAVEFRONT_RENDERER_H_INCLUDED
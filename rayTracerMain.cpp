@@ -1,5 +1,22 @@
+#include "AllocationTracker.h"
+#include "BatchRenderer.h"
+#include "RegressionSuite.h"
+#include "RenderServer.h"
 #include "Scene.h"
 #include "SceneReader.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
 
 /**
  * \mainpage COSC 342 Ray Tracer 2021.
@@ -33,6 +50,81 @@
  * arguments. Multiple scene files can be specified, and they are read
  * in the order provided.
  *
+ * Arguments starting with \c -- are options rather than scene files:
+ * - <tt>--wavefront</tt>: render with the WavefrontRenderer instead of recursive ray tracing.
+ * - <tt>--min-contribution [value]</tt>: stop tracing reflections that cannot change a pixel by more than this (default 0.5/255).
+ * - <tt>--russian-roulette</tt>: randomly continue low-contribution reflections instead of stopping them.
+ *   Colours are then clipped only at the end of each path, so that the survivors are not clipped.
+ * - <tt>--threads [count]</tt>: number of threads to render with (default: one per hardware thread).
+ * - <tt>--tile-order [scanline|shuffled|centre-out|morton|hilbert]</tt>: order in which threads take
+ *   tiles of the image (default: scanline).
+ * - <tt>--morton-framebuffer</tt>: store the image in Morton-ordered tiles while rendering, and
+ *   rearrange it row by row only when it is saved.
+ * - <tt>--affinity [none|compact|scatter]</tt>: pin render threads to CPUs, filling one NUMA node
+ *   at a time (compact) or dealing them out to the nodes in turn (scatter). The default is none.
+ * - <tt>--numa [local|replicate|interleave]</tt>: build the compiled scene on the main thread's node
+ *   (local, the default), build a copy on every node for the threads there (replicate), or spread 
+ *   its pages over all of the nodes (interleave). Only the compiled scene (bounds, lights, materials,
+ *   and the tables built from them) is placed; the objects and their transforms are not copied.
+ * - <tt>--huge-pages [none|transparent|explicit]</tt>: back large compiled scene arrays with
+ *   transparent huge pages, or with pages from the reserved huge page pool.
+ * - <tt>--samples [count]</tt>: number of jittered samples per pixel, overriding the scene file.
+ * - <tt>--telemetry [file|fd:N]</tt>: write the progress of each render as lines of JSON to a file
+ *   (which is replaced) or to an open file descriptor, such as \c fd:3.
+ * - <tt>--telemetry-interval-ms [ms]</tt>: time between telemetry lines and console progress updates (default 1000).
+ * - <tt>--stats [file.json]</tt>: after rendering, save a JSON report of the time taken by each phase,
+ *   the Rays traced, the acceleration structures, memory, thread utilization, and tile times.
+ * - <tt>--perf-counters</tt>: count CPU cycles, instructions, cache misses, and branch misses with
+ *   Linux's perf_event_open while building, rendering, and saving, and in the benchmarks and \c --stats
+ *   report. Counters the system does not provide are left out.
+ * - <tt>--alloc-stats</tt>: count the heap allocations, bytes, and peak live memory of parsing,
+ *   building, rendering (also per Ray), and saving, and estimate the memory of each type of Object.
+ *   These are printed after rendering and added to the \c --stats report. This needs a build
+ *   configured with <tt>-DRAYTRACER_ALLOC_STATS=ON</tt>.
+ * - <tt>--heatmap [time|rays]</tt>: measure the time taken by, or the Rays traced for, each pixel, and
+ *   save them as a false colour image next to the render (\c render.heatmap.png for \c render.png), with
+ *   the total of each tile in a CSV file (\c render.heatmap.csv).
+ * - <tt>--trace [file.json]</tt>: record when each thread parsed, compiled, rendered each tile, and saved,
+ *   and save it in Chrome's trace-event format for \c chrome://tracing or Perfetto. This needs a build
+ *   configured with <tt>-DRAYTRACER_TRACE=ON</tt>.
+ * - <tt>--time-budget-ms [ms]</tt>: render a coarse preview, then refine it until the time is up, 
+ *   and save the best image finished by then.
+ * - <tt>--verify-determinism</tt>: render twice with different thread counts and tile orders, 
+ *   report any pixels that differ, and exit with a non-zero status if there are any.
+ * - <tt>--fast-math</tt>: shade with fast approximations, which change pixels by at most one 8-bit level.
+ * - <tt>--verify-fast-math</tt>: render with and without \c --fast-math, report how much the pixels
+ *   differ, and exit with a non-zero status if any differ by more than one level.
+ * - <tt>--hdr</tt>: keep the full range of light in the float framebuffer, rather than clipping at each bounce.
+ * - <tt>--denoise</tt>: filter noise out of the float framebuffer with an edge-aware Denoiser before tone mapping.
+ * - <tt>--exposure [stops]</tt>, <tt>--gamma [value]</tt>, <tt>--tone-curve [clamp|reinhard]</tt>, 
+ *   <tt>--srgb</tt>, <tt>--dither</tt>: how the float framebuffer is tone mapped to 8-bit pixels, 
+ *   overriding the scene file.
+ * - <tt>--regrade [file.pfm]</tt>: instead of rendering, tone map a saved PFM file (with the settings
+ *   above) and save it to the Scene's filename.
+ * - <tt>--benchmark-shading [repeats]</tt>: report the time taken to light the primary hits of
+ *   the scene with PackedColour, with fast math, and with the double precision Colour arithmetic, 
+ *   instead of rendering it.
+ * - <tt>--benchmark-tile-order [repeats]</tt>: report the time taken to render the scene, and the
+ *   simulated cache misses, for each tile order and framebuffer layout, instead of saving it.
+ * - <tt>--benchmark-encode [repeats]</tt>: render the scene, then report the time taken to encode it
+ *   and the size of the file in each image format, instead of saving it.
+ *
+ * - <tt>--serve [socket]</tt>: run a RenderServer on a UNIX domain socket instead of rendering
+ *   the scene files. The other options are applied to each scene the server receives.
+ * - <tt>--connections [count]</tt>: number of requests a server handles at once (default 4).
+ * - <tt>--max-queue [count]</tt>: number of requests a server queues before turning them away (default 16).
+ * - <tt>--batch [manifest]</tt>: render each job listed in a manifest as a separate scene with a
+ *   BatchRenderer, instead of rendering the scene files. The other options are applied to each job.
+ * - <tt>--batch-jobs [count]</tt>: number of batch jobs to render at once (default 1).
+ * - <tt>--batch-report [file]</tt>: write per-job batch timings to a CSV file.
+ * - <tt>--benchmark-suite [suite]</tt>: render each scene in a RegressionSuite several times, compare
+ *   the images with their references and the median times with the baseline (if it was measured
+ *   with the same build type and number of threads), and exit with a non-zero status if any fail.
+ *   The other options are applied to each scene.
+ * - <tt>--suite-repeats [count]</tt>: number of times to render each suite scene (default 5).
+ * - <tt>--suite-threshold [fraction]</tt>: how much slower than the baseline a suite scene may be (default 0.1).
+ * - <tt>--update-suite</tt>: save new reference images and baseline times for the suite instead of checking them.
+ *
  * The scene is then rendered and saved to file, as long as there
  * is a Camera specified.
  * 
@@ -42,15 +134,309 @@ int main (int argc, char *argv[]) {
 	Scene scene;
 	
 	SceneReader reader(&scene);
+
+	bool wavefront = false;
+	double minContribution = scene.minContribution;
+	bool russianRoulette = false;
+	unsigned int numThreads = 0;
+	ThreadAffinity threadAffinity = ThreadAffinity::None;
+	NumaPlacement numaPlacement = NumaPlacement::Local;
+	HugePages hugePages = HugePages::None;
+	int samples = 0;
+	bool verifyDeterminism = false;
+	bool fastMath = false;
+	bool verifyFastMath = false;
+	unsigned int encodeRepeats = 0;
+	unsigned int shadingRepeats = 0;
+	unsigned int tileOrderRepeats = 0;
+	std::string tileOrder;
+	bool mortonFramebuffer = false;
+	bool hdr = false;
+	bool denoise = false;
+	std::vector<std::function<void(ToneMapping&)>> toneMappingOverrides;
+	std::string regradeFile;
+	double timeBudgetMs = 0;
+	int telemetryFd = -1;
+	std::string statsFile;
+	bool perfCounters = false;
+	CostMetric costHeatmap = CostMetric::None;
+	double parseSeconds = 0;
+	double telemetryIntervalMs = scene.telemetryIntervalMs;
+	std::string serverSocket;
+	unsigned int maxConnections = 4;
+	size_t maxQueued = 16;
+	std::string batchManifest;
+	unsigned int batchJobs = 1;
+	std::string batchReport;
+	std::string benchmarkSuite;
+	unsigned int suiteRepeats = 5;
+	double suiteThreshold = 0.1;
+	bool updateSuite = false;
+
+	// Tracing and allocation counting start before anything else, so that they cover the scene files wherever they are given
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (arg == "--alloc-stats") {
+#ifdef RAYTRACER_ALLOC_STATS
+			AllocationTracker::enable();
+#else
+			std::cerr << "Allocation counting is not built in. Configure with -DRAYTRACER_ALLOC_STATS=ON to use --alloc-stats" << std::endl;
+			return -1;
+#endif
+		} else if (arg == "--trace" && i + 1 < argc) {
+#ifdef RAYTRACER_TRACE
+			Trace::start(argv[i + 1]);
+#else
+			std::cerr << "Tracing is not built in. Configure with -DRAYTRACER_TRACE=ON to use --trace" << std::endl;
+			return -1;
+#endif
+		}
+	}
+	const AllocationTracker::Phase parsePhase;
 	
 	for (int i = 1; i < argc; ++i) {
-		reader.read(argv[i]);
+		std::string arg = argv[i];
+		if (arg == "--wavefront") {
+			wavefront = true;
+		} else if (arg == "--min-contribution" && i + 1 < argc) {
+			minContribution = atof(argv[++i]);
+		} else if (arg == "--russian-roulette") {
+			russianRoulette = true;
+		} else if (arg == "--threads" && i + 1 < argc) {
+			numThreads = (unsigned int)std::max(0, atoi(argv[++i]));
+		} else if (arg == "--affinity" && i + 1 < argc) {
+			const std::string affinity = toUpper(argv[++i]);
+			if (affinity == "NONE") {
+				threadAffinity = ThreadAffinity::None;
+			} else if (affinity == "COMPACT") {
+				threadAffinity = ThreadAffinity::Compact;
+			} else if (affinity == "SCATTER") {
+				threadAffinity = ThreadAffinity::Scatter;
+			} else {
+				std::cerr << "Unknown thread affinity '" << argv[i] << "'" << std::endl;
+				return -1;
+			}
+		} else if (arg == "--numa" && i + 1 < argc) {
+			const std::string placement = toUpper(argv[++i]);
+			if (placement == "LOCAL") {
+				numaPlacement = NumaPlacement::Local;
+			} else if (placement == "REPLICATE") {
+				numaPlacement = NumaPlacement::Replicate;
+			} else if (placement == "INTERLEAVE") {
+				numaPlacement = NumaPlacement::Interleave;
+			} else {
+				std::cerr << "Unknown NUMA placement '" << argv[i] << "'" << std::endl;
+				return -1;
+			}
+		} else if (arg == "--huge-pages" && i + 1 < argc) {
+			const std::string pages = toUpper(argv[++i]);
+			if (pages == "NONE") {
+				hugePages = HugePages::None;
+			} else if (pages == "TRANSPARENT") {
+				hugePages = HugePages::Transparent;
+			} else if (pages == "EXPLICIT") {
+				hugePages = HugePages::Explicit;
+			} else {
+				std::cerr << "Unknown huge page mode '" << argv[i] << "'" << std::endl;
+				return -1;
+			}
+		} else if (arg == "--samples" && i + 1 < argc) {
+			samples = std::max(1, atoi(argv[++i]));
+		} else if (arg == "--telemetry" && i + 1 < argc) {
+			const std::string target = argv[++i];
+			if (target.compare(0, 3, "fd:") == 0) {
+				telemetryFd = atoi(target.c_str() + 3);
+			} else {
+				telemetryFd = open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			}
+			if (telemetryFd < 0) {
+				std::cerr << "Cannot write telemetry to '" << target << "'" << std::endl;
+				return -1;
+			}
+		} else if (arg == "--stats" && i + 1 < argc) {
+			statsFile = argv[++i];
+		} else if (arg == "--alloc-stats") {
+			// Already started above
+		} else if (arg == "--perf-counters") {
+			perfCounters = true;
+		} else if (arg == "--heatmap" && i + 1 < argc) {
+			const std::string metric = toUpper(argv[++i]);
+			if (metric == "TIME") {
+				costHeatmap = CostMetric::Time;
+			} else if (metric == "RAYS") {
+				costHeatmap = CostMetric::Rays;
+			} else {
+				std::cerr << "Unknown heatmap metric '" << argv[i] << "'" << std::endl;
+				return -1;
+			}
+		} else if (arg == "--trace" && i + 1 < argc) {
+			++i; // Already started above
+		} else if (arg == "--telemetry-interval-ms" && i + 1 < argc) {
+			telemetryIntervalMs = std::max(1.0, atof(argv[++i]));
+		} else if (arg == "--time-budget-ms" && i + 1 < argc) {
+			timeBudgetMs = atof(argv[++i]);
+		} else if (arg == "--serve" && i + 1 < argc) {
+			serverSocket = argv[++i];
+		} else if (arg == "--connections" && i + 1 < argc) {
+			maxConnections = (unsigned int)std::max(1, atoi(argv[++i]));
+		} else if (arg == "--max-queue" && i + 1 < argc) {
+			maxQueued = (size_t)std::max(0, atoi(argv[++i]));
+		} else if (arg == "--batch" && i + 1 < argc) {
+			batchManifest = argv[++i];
+		} else if (arg == "--batch-jobs" && i + 1 < argc) {
+			batchJobs = (unsigned int)std::max(1, atoi(argv[++i]));
+		} else if (arg == "--batch-report" && i + 1 < argc) {
+			batchReport = argv[++i];
+		} else if (arg == "--benchmark-suite" && i + 1 < argc) {
+			benchmarkSuite = argv[++i];
+		} else if (arg == "--suite-repeats" && i + 1 < argc) {
+			suiteRepeats = (unsigned int)std::max(1, atoi(argv[++i]));
+		} else if (arg == "--suite-threshold" && i + 1 < argc) {
+			suiteThreshold = std::max(0.0, atof(argv[++i]));
+		} else if (arg == "--update-suite") {
+			updateSuite = true;
+		} else if (arg == "--verify-determinism") {
+			verifyDeterminism = true;
+		} else if (arg == "--fast-math") {
+			fastMath = true;
+		} else if (arg == "--verify-fast-math") {
+			verifyFastMath = true;
+		} else if (arg == "--hdr") {
+			hdr = true;
+		} else if (arg == "--denoise") {
+			denoise = true;
+		} else if (arg == "--exposure" && i + 1 < argc) {
+			const double exposure = atof(argv[++i]);
+			toneMappingOverrides.push_back([=](ToneMapping& toneMapping) { toneMapping.exposure = exposure; });
+		} else if (arg == "--gamma" && i + 1 < argc) {
+			const double gamma = atof(argv[++i]);
+			if (gamma <= 0) {
+				std::cerr << "Gamma must be positive" << std::endl;
+				return -1;
+			}
+			toneMappingOverrides.push_back([=](ToneMapping& toneMapping) { toneMapping.gamma = gamma; });
+		} else if (arg == "--tone-curve" && i + 1 < argc) {
+			const std::string curve = toUpper(argv[++i]);
+			if (curve != "CLAMP" && curve != "REINHARD") {
+				std::cerr << "Unknown tone curve '" << argv[i] << "'" << std::endl;
+				return -1;
+			}
+			toneMappingOverrides.push_back([=](ToneMapping& toneMapping) { 
+				toneMapping.curve = curve == "REINHARD" ? ToneMapping::Curve::Reinhard : ToneMapping::Curve::Clamp; 
+			});
+		} else if (arg == "--srgb") {
+			toneMappingOverrides.push_back([](ToneMapping& toneMapping) { toneMapping.srgb = true; });
+		} else if (arg == "--dither") {
+			toneMappingOverrides.push_back([](ToneMapping& toneMapping) { toneMapping.dither = true; });
+		} else if (arg == "--regrade" && i + 1 < argc) {
+			regradeFile = argv[++i];
+		} else if (arg == "--benchmark-shading" && i + 1 < argc) {
+			shadingRepeats = (unsigned int)std::max(1, atoi(argv[++i]));
+		} else if (arg == "--benchmark-tile-order" && i + 1 < argc) {
+			tileOrderRepeats = (unsigned int)std::max(1, atoi(argv[++i]));
+		} else if (arg == "--tile-order" && i + 1 < argc) {
+			tileOrder = toUpper(argv[++i]);
+			if (tileOrder != "SCANLINE" && tileOrder != "SHUFFLED" && tileOrder != "CENTRE-OUT" && tileOrder != "MORTON" && tileOrder != "HILBERT") {
+				std::cerr << "Unknown tile order '" << argv[i] << "'" << std::endl;
+				return -1;
+			}
+		} else if (arg == "--morton-framebuffer") {
+			mortonFramebuffer = true;
+		} else if (arg == "--benchmark-encode" && i + 1 < argc) {
+			encodeRepeats = (unsigned int)std::max(1, atoi(argv[++i]));
+		} else if (arg.compare(0, 2, "--") == 0) {
+			std::cerr << "Unknown option '" << arg << "'" << std::endl;
+			return -1;
+		} else {
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			reader.read(arg);
+			parseSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
 	}
 
-	if (scene.hasCamera()) {
-		scene.render();
-	} else {
+	auto setup = [=](Scene& scene) {
+		scene.wavefront = wavefront;
+		scene.minContribution = minContribution;
+		scene.russianRoulette = russianRoulette;
+		scene.numThreads = numThreads;
+		scene.threadAffinity = threadAffinity;
+		scene.numaPlacement = numaPlacement;
+		scene.hugePages = hugePages;
+		if (tileOrder == "SCANLINE") scene.tileOrder = TileOrder::Scanline;
+		if (tileOrder == "SHUFFLED") scene.tileOrder = TileOrder::Shuffled;
+		if (tileOrder == "CENTRE-OUT") scene.tileOrder = TileOrder::CentreOut;
+		if (tileOrder == "MORTON") scene.tileOrder = TileOrder::Morton;
+		if (tileOrder == "HILBERT") scene.tileOrder = TileOrder::Hilbert;
+		if (mortonFramebuffer) scene.framebufferLayout = FramebufferLayout::MortonTiles;
+		scene.timeBudgetMs = timeBudgetMs;
+		scene.telemetryFd = telemetryFd;
+		scene.statsFile = statsFile;
+		scene.perfCounters = perfCounters;
+		scene.costHeatmap = costHeatmap;
+		scene.telemetryIntervalMs = telemetryIntervalMs;
+		scene.hdr = scene.hdr || hdr;
+		scene.denoise = scene.denoise || denoise;
+		scene.fastMath = scene.fastMath || fastMath;
+		for (const auto& toneMappingOverride : toneMappingOverrides) {
+			toneMappingOverride(scene.toneMapping);
+		}
+		if (samples > 0) {
+			scene.samplesPerPixel = (unsigned int)samples;
+		}
+	};
+
+	setup(scene);
+	scene.parseSeconds = parseSeconds;
+	scene.parseAllocations = parsePhase.counts();
+
+	if (!serverSocket.empty()) {
+		RenderServer server(serverSocket, numThreads, maxConnections, maxQueued, setup, scene.threadCpus());
+		server.run();
+		return 0;
+	}
+
+	if (!batchManifest.empty()) {
+		BatchRenderer batch(numThreads, batchJobs, setup, scene.threadCpus());
+		return batch.run(batchManifest, batchReport) == 0 ? 0 : 1;
+	}
+
+	if (!benchmarkSuite.empty()) {
+		RegressionSuite suite(numThreads, setup, scene.threadCpus());
+		return suite.run(benchmarkSuite, suiteRepeats, suiteThreshold, updateSuite) ? 0 : 1;
+	}
+
+	if (!regradeFile.empty()) {
+		// Only the tone mapping needs redoing, so no Rays are traced
+		ImageDisplay display("Regrade", 0, 0);
+		if (!display.loadPFM(regradeFile)) {
+			std::cerr << "Could not read PFM file " << regradeFile << std::endl;
+			return -1;
+		}
+		ThreadPool pool(numThreads, scene.threadCpus());
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		display.toneMap(scene.toneMapping, &pool);
+		std::cout << "Tone mapped " << display.width() << "x" << display.height() << " image in " 
+		          << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << "ms" << std::endl;
+		return display.save(scene.filename, &pool) ? 0 : 1;
+	}
+
+	// The scene is complete, so work out everything that depends on all of it once
+	scene.freeze();
+
+	if (!scene.hasCamera()) {
 		std::cerr << "Cannot render a scene with no camera!" << std::endl;
+	} else if (verifyDeterminism) {
+		return scene.verifyDeterminism() ? 0 : 1;
+	} else if (verifyFastMath) {
+		return scene.verifyFastMath() ? 0 : 1;
+	} else if (shadingRepeats > 0) {
+		scene.benchmarkShading(shadingRepeats);
+	} else if (tileOrderRepeats > 0) {
+		scene.benchmarkTileOrder(tileOrderRepeats);
+	} else if (encodeRepeats > 0) {
+		scene.benchmarkEncoding(encodeRepeats);
+	} else {
+		return scene.render() ? 0 : 1;
 	}
 
 	return 0;